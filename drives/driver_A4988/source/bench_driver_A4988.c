@@ -0,0 +1,1502 @@
+/*! ---------------------------------------------------------------------
+ * @file    bench_driver_A4988.c
+ * @date    10-16-2026
+ * @name    Ulrich Buettemeier
+ * @brief   measurements of the step engine
+ *          usage: bench_driver_A4988 [all|jitter|motors|ctrl|api|gpio|sim|hist|line|ramp|queue|mdload|stream|mdpool|ms|tele|snap|wake|done|log|rt] [wiringpi|mem|emu|chardev|sim]
+ *          without parameter all measurements are executed.
+ *          "all" executes all measurements, e.g. bench_driver_A4988 all emu.
+ *          The second parameter selects the gpio access (default: wiringpi, 
+ *          with target = amd64 sim).
+ */
+
+#define _GNU_SOURCE                         /* F_SETPIPE_SZ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <malloc.h>
+#include <poll.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include "driver_A4988.h"
+#include "../../../tools/rpi_tools/rpi_tools.h"
+#include "../../../tools/gpio/gpio_mem.h"
+#include "../../../tools/gpio/gpio_sim.h"
+#include "../../../tools/rt_log/rt_log.h"
+
+#define ENABLE_PIN_M1 25     /* GPIO.25  PIN 37 */
+#define STEP_PIN_M1   24     /* GPIO.24  PIN 35 */
+#define DIR_PIN_M1    23     /* GPIO.23  PIN 33 */
+
+#define ENABLE_PIN_M2 29     /* GPIO.29  PIN 40 */
+#define STEP_PIN_M2   28     /* GPIO.28  PIN 38 */
+#define DIR_PIN_M2    27     /* GPIO.27  PIN 36 */
+
+#define ENABLE_PIN_M3 22     /* GPIO.22  PIN 31 */
+#define STEP_PIN_M3   21     /* GPIO.21  PIN 29 */
+#define DIR_PIN_M3    26     /* GPIO.26  PIN 32 */
+
+#define MS1_PIN        0     /* GPIO.0   PIN 11 */
+#define MS2_PIN        2     /* GPIO.2   PIN 13 */
+#define MS3_PIN        3     /* GPIO.3   PIN 15 */
+
+#define STEPS_PER_TURN 400
+
+/*! --------------------------------------------------------------------
+ * @return  user + system time of the process [us]
+ */
+static uint64_t cpu_time (void)
+{
+    struct rusage ru;
+
+    getrusage (RUSAGE_SELF, &ru);
+    return (uint64_t)difference_micro (&(struct timeval){0, 0}, &ru.ru_utime) +
+           (uint64_t)difference_micro (&(struct timeval){0, 0}, &ru.ru_stime);
+}
+/*! --------------------------------------------------------------------
+ * @brief   wait for the end of the job
+ */
+static void wait_job (struct _mot_ctl_ *mc)
+{
+    mot_wait_job (mc, 0);
+}
+/*! --------------------------------------------------------------------
+ * @brief   the loop of the driver before the deadlines (baseline): the 
+ *           thread polls gettimeofday() and steps, if the time since the 
+ *           previous step is steptime minus the lateness of the previous
+ *           step. lateness = time since the previous step - steptime.
+ *           Only the timing, no pins. used by bench_jitter()
+ */
+struct _gtod_loop_ {
+    uint64_t steps;
+    uint32_t steptime;                  /* [us] */
+    struct _mot_hist_ late;             /* [ns] */
+    int64_t sum, max;                   /* lateness [us] */
+    int64_t runtime;                    /* first to last step [us] */
+};
+
+static void *gtod_loop (void *data)
+{
+    struct _gtod_loop_ *g = (struct _gtod_loop_ *)data;
+    struct timeval start, stop, run_start;
+    int64_t timediff, latency = 0;
+    uint64_t i = 0;
+
+    gettimeofday (&start, NULL);
+    run_start = start;
+    while (i < g->steps) {
+        gettimeofday (&stop, NULL);
+        if ((timediff = difference_micro (&start, &stop)) >= (int64_t)g->steptime - latency) {
+            gettimeofday (&start, NULL);
+            latency = timediff - (int64_t)g->steptime;
+            g->sum += latency;
+            if (latency > g->max)
+                g->max = latency;
+            if (latency >= 0)
+                mot_hist_add (&g->late, (uint64_t)latency * 1000);
+            i++;
+        }
+    }
+    g->runtime = difference_micro (&run_start, &stop);
+
+    return NULL;
+}
+/*! --------------------------------------------------------------------
+ * @brief   step jitter and cpu load of the baseline loop (gtod, see: 
+ *           gtod_loop()), MOT_SCHED_BUSY and MOT_SCHED_SLEEP.
+ *           One motor runs with constant speed. The gtod loop runs in a
+ *           thread with the policy of the driver thread.
+ *           lateness: gtod = to the previous step + steptime, busy/sleep =
+ *           to the absolute deadline. drift = runtime - steps * steptime.
+ */
+static void bench_jitter (void)
+{
+    const uint64_t steps = 4000;
+    const uint32_t steptime = 500;                          /* [us] */
+    const char *name[2] = {"busy ", "sleep"};
+    static struct _mot_hist_ late;
+    static struct _gtod_loop_ g;
+    struct _mot_thread_cfg_ cfg;
+    struct sched_param param;
+    struct _mot_snapshot_ s;
+    pthread_attr_t attr;
+    pthread_t thread;
+    uint8_t mode;
+
+    printf ("\n-- jitter: %llu steps, steptime=%u us\n", (long long unsigned)steps, steptime);
+    printf ("-- mode    mean[us]  p50[us]  p99[us]  p99.9[us]  max[us]  drift[us]  overruns  cpu[%%]\n");
+
+    memset (&g, 0, sizeof(g));
+    g.steps = steps;
+    g.steptime = steptime;
+    mot_thread_get (NULL, &cfg);
+    pthread_attr_init (&attr);
+    if ((cfg.policy == MOT_POLICY_FIFO) || (cfg.policy == MOT_POLICY_RR)) {
+        param.sched_priority = cfg.priority;
+        pthread_attr_setinheritsched (&attr, PTHREAD_EXPLICIT_SCHED);
+        pthread_attr_setschedpolicy (&attr, (cfg.policy == MOT_POLICY_FIFO) ? SCHED_FIFO : SCHED_RR);
+        pthread_attr_setschedparam (&attr, &param);
+    }
+    uint64_t wall = monotonic_ns ();
+    uint64_t cpu = cpu_time ();
+    if (pthread_create (&thread, &attr, gtod_loop, &g) != 0)
+        pthread_create (&thread, NULL, gtod_loop, &g);     /* without permission */
+    pthread_join (thread, NULL);
+    pthread_attr_destroy (&attr);
+    cpu = cpu_time () - cpu;
+    wall = (monotonic_ns () - wall) / 1000;
+    printf ("-- gtod   %8.2f  %7.1f  %7.1f  %9.1f  %7lli  %9lli  %8s  %6.1f\n",
+             (double)g.sum / (double)steps,
+             (double)mot_hist_percentile (&g.late, 0.5) / 1000.0,
+             (double)mot_hist_percentile (&g.late, 0.99) / 1000.0,
+             (double)mot_hist_percentile (&g.late, 0.999) / 1000.0,
+             (long long)g.max,
+             (long long)(g.runtime - (int64_t)steps * steptime),
+             "-",
+             100.0 * (double)cpu / (double)wall);
+
+    struct _mot_ctl_ *mc = new_mot (NULL, ENABLE_PIN_M1, DIR_PIN_M1, STEP_PIN_M1, STEPS_PER_TURN);
+    mot_set_steptime (mc, steptime);
+
+    for (mode = MOT_SCHED_BUSY; mode <= MOT_SCHED_SLEEP; mode++) {
+        mot_set_sched_mode (mode, 50);
+        mot_setparam (mc, MOT_CW, steps, 0.0, 0.0);
+        mot_hist_reset (mc);
+
+        wall = monotonic_ns ();
+        cpu = cpu_time ();
+        mot_start (mc);
+        wait_job (mc);
+        cpu = cpu_time () - cpu;
+        wall = (monotonic_ns () - wall) / 1000;
+
+        mot_snapshot (mc, &s);
+        mot_hist_snapshot (mc, &late, NULL);
+        printf ("-- %s  %8.2f  %7.1f  %7.1f  %9.1f  %7llu  %9lli  %8u  %6.1f\n",
+                 name[mode],
+                 (double)mc->sum_latency / (double)mc->current_stepcount / 1000.0,
+                 (double)mot_hist_percentile (&late, 0.5) / 1000.0,
+                 (double)mot_hist_percentile (&late, 0.99) / 1000.0,
+                 (double)mot_hist_percentile (&late, 0.999) / 1000.0,
+                 (long long unsigned)s.max_latency,
+                 (long long)((int64_t)s.runtime - (int64_t)steps * steptime),
+                 s.overruns,
+                 100.0 * (double)cpu / (double)wall);
+    }
+    kill_mot (mc);
+}
+/*! --------------------------------------------------------------------
+ * @brief   starts n motors together. The moves are posted with 
+ *           mot_queue_move(), that doesn't wait for the driver thread 
+ *           like mot_start(). The API thread posts with the policy of the
+ *           driver thread, so a busy driver thread on the same cpu doesn't
+ *           run the first motor before the last move is posted.
+ * @param   steps_0 = steps with steptime_0, every motor runs the same time
+ */
+static void start_all (struct _mot_ctl_ **mc, int n, uint64_t steps_0, uint32_t steptime_0)
+{
+    struct _mot_thread_cfg_ cfg;
+    struct sched_param param, old;
+    int policy, i;
+
+    pthread_getschedparam (pthread_self (), &policy, &old);
+    mot_thread_get (mc[0]->ctrl, &cfg);
+    if ((cfg.policy == MOT_POLICY_FIFO) || (cfg.policy == MOT_POLICY_RR)) {
+        param.sched_priority = cfg.priority;
+        pthread_setschedparam (pthread_self (), (cfg.policy == MOT_POLICY_FIFO) ? SCHED_FIFO : SCHED_RR, &param);
+    }
+    for (i = 0; i < n; i++) 
+        mot_queue_move (mc[i], MOT_CW, steps_0 * steptime_0 / mc[i]->steptime, mc[i]->steptime, 0.0, 0.0);
+    pthread_setschedparam (pthread_self (), policy, &old);
+}
+/*! --------------------------------------------------------------------
+ * @brief   n motors run together. Motor 0 runs with steptime_0, the 
+ *           other motors with steptime_n. All motors run the same time.
+ *           All motors use the pins of motor 1.
+ * @return  output line: motors, steps/s, mean and max lateness, cpu per step
+ */
+static void run_motors (int n, uint32_t steptime_0, uint32_t steptime_n, uint64_t steps_0)
+{
+    struct _mot_ctl_ *mc[MOT_MAX];
+    int i;
+
+    for (i = 0; i < n; i++) {
+        uint32_t steptime = (i == 0) ? steptime_0 : steptime_n;
+        mc[i] = new_mot (NULL, ENABLE_PIN_M1, DIR_PIN_M1, STEP_PIN_M1, STEPS_PER_TURN);
+        mot_set_steptime (mc[i], steptime);
+    }
+
+    uint64_t cpu = cpu_time ();
+    start_all (mc, n, steps_0, steptime_0);
+    for (i = 0; i < n; i++)
+        wait_job (mc[i]);
+    cpu = cpu_time () - cpu;
+
+    uint64_t sum = 0, max = 0, count = 0;
+    uint64_t t0 = UINT64_MAX, t1 = 0;                  /* first start, last step [ns] */
+    for (i = 0; i < n; i++) {
+        sum += mc[i]->sum_latency;
+        count += mc[i]->current_stepcount;
+        if (mc[i]->max_latency > max)
+            max = mc[i]->max_latency;
+        if (mc[i]->run_start < t0)
+            t0 = mc[i]->run_start;
+        if (mc[i]->run_start + mc[i]->runtime * 1000 > t1)
+            t1 = mc[i]->run_start + mc[i]->runtime * 1000;
+        kill_mot (mc[i]);
+    }
+
+    printf ("-- %6i  %8.0f  %8.2f  %7llu  %12.1f\n",
+             n,
+             (double)count * 1.0e9 / (double)(t1 - t0),
+             (double)sum / (double)count / 1000.0,
+             (long long unsigned)max,
+             (double)cpu * 1000.0 / (double)count);
+}
+/*! --------------------------------------------------------------------
+ * @brief   aggregate step rate of the driver thread with 1 ... MOT_MAX motors.
+ *           1) all motors get a steptime of 1 us. This is shorter than the 
+ *              thread can execute with many motors, so the result is the 
+ *              achievable step rate.
+ *           2) one fast motor (2 us) and slow motors (1000 us).
+ */
+static void bench_motors (void)
+{
+    int n;
+
+    printf ("\n-- motors: 20000 steps per motor, steptime=1 us\n");
+    printf ("-- motors  steps/s   mean[us]  max[us]  cpu/step[ns]\n");
+    for (n = 1; n <= MOT_MAX; n *= 2) 
+        run_motors (n, 1, 1, 20000);
+
+    printf ("\n-- motors: one motor 2 us, the others 1000 us\n");
+    printf ("-- motors  steps/s   mean[us]  max[us]  cpu/step[ns]\n");
+    for (n = 1; n <= MOT_MAX; n *= 2) 
+        run_motors (n, 2, 1000, 50000);
+}
+/*! --------------------------------------------------------------------
+ * @brief   12 axes on 1 controller and on 3 controllers (4 axes each).
+ *           With 4 cpus the 3 driver threads run on the cpus 1, 2, 3.
+ *           All motors use the pins of motor 1.
+ * @return  output line per controller: steps/s, mean, p99 and max lateness
+ */
+static void run_ctrl (int n_ctrl, int n_mot, uint32_t steptime, uint64_t steps)
+{
+    static struct _mot_hist_ late, sum;
+    struct _mot_ctrl_ *ctrl[3] = {NULL, NULL, NULL};
+    struct _mot_ctl_ *mc[12];
+    struct _mot_thread_cfg_ cfg;
+    int per_ctrl = n_mot / n_ctrl;
+    int i, k, b;
+
+    mot_thread_default (&cfg);
+    for (i = 0; i < n_ctrl; i++) {
+        if (sysconf (_SC_NPROCESSORS_ONLN) >= n_ctrl + 1)
+            snprintf (cfg.cpus, MOT_CPUS_LEN, "%i", i + 1);
+        if ((ctrl[i] = new_mot_ctrl (&cfg)) == NULL)
+            return;
+        for (k = 0; k < per_ctrl; k++) {
+            mc[i * per_ctrl + k] = new_mot (ctrl[i], ENABLE_PIN_M1, DIR_PIN_M1, STEP_PIN_M1, STEPS_PER_TURN);
+            mot_set_steptime (mc[i * per_ctrl + k], steptime);
+        }
+    }
+
+    for (i = 0; i < n_ctrl; i++)
+        start_all (&mc[i * per_ctrl], per_ctrl, steps, steptime);
+    for (i = 0; i < n_mot; i++)
+        wait_job (mc[i]);
+
+    for (i = 0; i < n_ctrl; i++) {
+        uint64_t max = 0, count = 0;
+        uint64_t t0 = UINT64_MAX, t1 = 0;
+        memset (&sum, 0, sizeof(sum));
+        for (k = i * per_ctrl; k < (i + 1) * per_ctrl; k++) {
+            mot_hist_snapshot (mc[k], &late, NULL);
+            for (b = 0; b < MOT_HIST_BUCKETS; b++)
+                sum.count[b] += late.count[b];
+            sum.n += late.n;
+            sum.sum += late.sum;
+            if (late.max > sum.max)
+                sum.max = late.max;
+            count += mc[k]->current_stepcount;
+            if (mc[k]->max_latency > max)
+                max = mc[k]->max_latency;
+            if (mc[k]->run_start < t0)
+                t0 = mc[k]->run_start;
+            if (mc[k]->run_start + mc[k]->runtime * 1000 > t1)
+                t1 = mc[k]->run_start + mc[k]->runtime * 1000;
+        }
+        mot_thread_get (ctrl[i], &cfg);
+        printf ("-- %4i  %4i  %4s  %9.0f  %8.2f  %8.2f  %7llu\n",
+                 n_ctrl, i + 1, (cfg.pinned) ? cfg.cpus : "all",
+                 (double)count * 1.0e9 / (double)(t1 - t0),
+                 (double)sum.sum / (double)sum.n / 1000.0,
+                 (double)mot_hist_percentile (&sum, 0.99) / 1000.0,
+                 (long long unsigned)max);
+        kill_mot_ctrl (ctrl[i]);
+    }
+}
+/*! --------------------------------------------------------------------
+ * @brief   step rate and lateness of 12 axes on one driver thread and 
+ *           spread over three driver threads.
+ */
+static void bench_ctrl (void)
+{
+    printf ("\n-- ctrl: 12 motors, 20000 steps per motor, steptime=20 us\n");
+    printf ("-- ctrl    nr  cpus    steps/s  mean[us]   p99[us]  max[us]\n");
+    run_ctrl (1, 12, 20, 20000);
+    run_ctrl (3, 12, 20, 20000);
+}
+/*! --------------------------------------------------------------------
+ * @brief   one motor runs, while the API creates and removes motors.
+ *           The steps of the running motor must not be delayed.
+ */
+static void bench_api (void)
+{
+    const uint64_t steps = 5000;
+    const uint32_t steptime = 200;                          /* [us] */
+    uint64_t calls = 0, t = 0, t0;
+    struct _mot_snapshot_ s;
+
+    printf ("\n-- api: new_mot() + kill_mot() while one motor runs, steptime=%u us\n", steptime);
+    printf ("-- calls  call[us]  mean[us]  max[us]\n");
+
+    struct _mot_ctl_ *mc = new_mot (NULL, ENABLE_PIN_M1, DIR_PIN_M1, STEP_PIN_M1, STEPS_PER_TURN);
+    mot_set_steptime (mc, steptime);
+    mot_setparam (mc, MOT_CW, steps, 0.0, 0.0);
+    mot_start (mc);
+
+    while ((mot_snapshot (mc, &s) == EXIT_SUCCESS) && s.aktiv) {
+        t0 = monotonic_ns ();
+        struct _mot_ctl_ *m = new_mot (NULL, ENABLE_PIN_M1, DIR_PIN_M1, STEP_PIN_M1, STEPS_PER_TURN);
+        mot_setparam (m, MOT_CW, 100, 0.0, 0.0);
+        kill_mot (m);
+        t += monotonic_ns () - t0;
+        calls++;
+    }
+
+    printf ("-- %5llu  %8.1f  %8.2f  %7llu\n",
+             (long long unsigned)calls,
+             (double)t / (double)calls / 1000.0,
+             (double)mc->sum_latency / (double)mc->current_stepcount / 1000.0,
+             (long long unsigned)mc->max_latency);
+    kill_mot (mc);
+}
+/*! --------------------------------------------------------------------
+ * @brief   cost of the step pulses of 8 motors.
+ *           single = one pulse per motor, batch = one pulse for all motors.
+ *           Only with mem or emu.
+ */
+static void bench_gpio (void)
+{
+    const int loops = 100000;
+    const int pins[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+    uint32_t mask = 0;
+    int i, k;
+
+    if (!gpio_mem_reg) {
+        printf ("\n-- gpio: needs mem or emu\n");
+        return;
+    }
+
+    for (k = 0; k < 8; k++) 
+        mask |= gpio_mem_mask (pins[k]);
+
+    printf ("\n-- gpio: 8 motors, pulse width 0 ns\n");
+    printf ("-- mode     ns/pass\n");
+
+    uint64_t t = monotonic_ns ();
+    for (i = 0; i < loops; i++) 
+        for (k = 0; k < 8; k++)
+            gpio_mem_pulse (gpio_mem_mask (pins[k]), 0);
+    t = monotonic_ns () - t;
+    printf ("-- single  %8.1f\n", (double)t / (double)loops);
+
+    t = monotonic_ns ();
+    for (i = 0; i < loops; i++) 
+        gpio_mem_pulse (mask, 0);
+    t = monotonic_ns () - t;
+    printf ("-- batch   %8.1f\n", (double)t / (double)loops);
+}
+/*! --------------------------------------------------------------------
+ * @brief   step timing at the step pin. The rising edges of the step pin
+ *           are read from the ring buffer of the gpio simulator.
+ *           Only with sim.
+ */
+static void bench_sim (void)
+{
+    const uint64_t steps = 2000;
+    const uint32_t steptime = 500;                          /* [us] */
+    struct _gpio_sim_event_ ev;
+    uint64_t n, count = 0, last = 0;
+    double sum = 0.0, sum2 = 0.0, max = 0.0;
+
+    if (gpio_selected () != GPIO_BE_SIM) {
+        printf ("\n-- sim: needs sim\n");
+        return;
+    }
+
+    struct _mot_ctl_ *mc = new_mot (NULL, ENABLE_PIN_M1, DIR_PIN_M1, STEP_PIN_M1, STEPS_PER_TURN);
+    mot_set_steptime (mc, steptime);
+    mot_setparam (mc, MOT_CW, steps, 0.0, 0.0);
+
+    gpio_sim_clear ();
+    mot_start (mc);
+    wait_job (mc);
+
+    for (n = 0; n < gpio_sim_count (); n++) {
+        if ((gpio_sim_event (n, &ev) != EXIT_SUCCESS) || (ev.pin != STEP_PIN_M1) || !ev.value)
+            continue;
+        if (last) {
+            double err = (double)(ev.t - last) / 1000.0 - (double)steptime;    /* [us] */
+            sum += err;
+            sum2 += err * err;
+            if (fabs (err) > max)
+                max = fabs (err);
+            count++;
+        }
+        last = ev.t;
+    }
+    kill_mot (mc);
+
+    printf ("\n-- sim: %llu steps, steptime=%u us, interval at the step pin\n", (long long unsigned)steps, steptime);
+    printf ("-- edges    mean err[us]  rms err[us]  max err[us]\n");
+    if (count)
+        printf ("-- %6llu  %12.2f  %11.2f  %11.2f\n",
+                 (long long unsigned)count + 1, sum / count, sqrt (sum2 / count), max);
+}
+/*! --------------------------------------------------------------------
+ * @brief   histograms of two motors and of the driver thread 
+ *           in Prometheus text format
+ */
+static void bench_hist (void)
+{
+    struct _mot_ctl_ *mc[2];
+    int i;
+
+    printf ("\n-- hist: 2 motors, 2000 steps, steptime=500 us and 700 us\n");
+    mot_hist_reset (NULL);
+    for (i = 0; i < 2; i++) {
+        mc[i] = new_mot (NULL, ENABLE_PIN_M1, DIR_PIN_M1, STEP_PIN_M1, STEPS_PER_TURN);
+        mot_set_steptime (mc[i], 500 + i * 200);
+        mot_setparam (mc[i], MOT_CW, 2000, 0.0, 0.0);
+        mot_start (mc[i]);
+    }
+    for (i = 0; i < 2; i++)
+        wait_job (mc[i]);
+
+    mot_hist_dump_all (stdout);
+    for (i = 0; i < 2; i++)
+        kill_mot (mc[i]);
+}
+/*! --------------------------------------------------------------------
+ * @brief   three motors with 3000, 1000 and -2000 steps. 
+ *           independent: every motor has its own job with the same steptime.
+ *           line: mot_move_line(), the steps of motor 2 and 3 are distributed
+ *           by the driver thread.
+ *           With sim the distance to the straight line is measured at every
+ *           step of motor 1 [steps].
+ */
+static void bench_line (void)
+{
+    const int64_t steps[3] = {3000, 1000, -2000};
+    const uint8_t step_pin[3] = {STEP_PIN_M1, STEP_PIN_M2, STEP_PIN_M3};
+    const uint32_t steptime = 300;                          /* [us] */
+    struct _mot_ctl_ *mc[3];
+    struct _gpio_sim_event_ ev;
+    uint64_t n, t_end[3], t_max, t_min;
+    int64_t pos[3];
+    double dev, max_dev;
+    int i, k, line;
+
+    mc[0] = new_mot (NULL, ENABLE_PIN_M1, DIR_PIN_M1, STEP_PIN_M1, STEPS_PER_TURN);
+    mc[1] = new_mot (NULL, ENABLE_PIN_M2, DIR_PIN_M2, STEP_PIN_M2, STEPS_PER_TURN);
+    mc[2] = new_mot (NULL, ENABLE_PIN_M3, DIR_PIN_M3, STEP_PIN_M3, STEPS_PER_TURN);
+
+    printf ("\n-- line: 3 motors, steps = 3000, 1000, -2000, steptime=%u us\n", steptime);
+    printf ("-- mode          end spread[ms]  max dist[steps]\n");
+    for (line = 0; line <= 1; line++) {
+        if (gpio_selected () == GPIO_BE_SIM)
+            gpio_sim_clear ();
+        if (line) {
+            mot_move_line (mc, steps, 3, steptime, 0.0, 0.0);
+        } else {
+            for (i = 0; i < 3; i++) {
+                mot_set_steptime (mc[i], steptime);
+                mot_setparam (mc[i], (steps[i] < 0) ? MOT_CCW : MOT_CW, llabs (steps[i]), 0.0, 0.0);
+            }
+            for (i = 0; i < 3; i++)
+                mot_start (mc[i]);
+        }
+        for (i = 0; i < 3; i++)
+            wait_job (mc[i]);
+
+        t_max = 0;
+        t_min = UINT64_MAX;
+        for (i = 0; i < 3; i++) {
+            t_end[i] = mc[i]->run_start + mc[i]->runtime * 1000;
+            t_max = (t_end[i] > t_max) ? t_end[i] : t_max;
+            t_min = (t_end[i] < t_min) ? t_end[i] : t_min;
+        }
+        printf ("-- %s  %14.2f", (line) ? "line       " : "independent", (double)(t_max - t_min) / 1000000.0);
+
+        if (gpio_selected () != GPIO_BE_SIM) {
+            printf ("  %15s\n", "needs sim");
+            continue;
+        }
+        memset (pos, 0, sizeof(pos));
+        max_dev = 0.0;
+        for (n = 0; n < gpio_sim_count (); n++) {
+            if ((gpio_sim_event (n, &ev) != EXIT_SUCCESS) || !ev.value)
+                continue;
+            for (i = 0; (i < 3) && (ev.pin != step_pin[i]); i++);
+            if (i == 3)
+                continue;
+            if (i == 0) {                           /* the steps of the last pass are recorded */
+                for (k = 1; k < 3; k++) {
+                    dev = fabs ((double)pos[k] - (double)pos[0] * (double)llabs (steps[k]) / (double)steps[0]);
+                    max_dev = (dev > max_dev) ? dev : max_dev;
+                }
+            }
+            pos[i]++;
+        }
+        printf ("  %15.2f\n", max_dev);
+    }
+
+    for (i = 0; i < 3; i++)
+        kill_mot (mc[i]);
+}
+/*! --------------------------------------------------------------------
+ * @brief   the step table of a ramp is compiled without the driver thread.
+ *           jerk = change of the acceleration of the steps / time of the step
+ * @param   jerk = 0.0 constant acceleration, else S-curve
+ */
+static void ramp_profile (const char *name, double jerk)
+{
+    static struct _mot_ctl_ m;
+    struct _step_entry_ *e;
+    double phi, w0 = 0.0, a0 = 0.0, t, j, max_a = 0.0, max_j = 0.0;
+    uint64_t steps = 0, sum_t = 0;
+
+    memset (&m, 0, sizeof(m));
+    m.steps_per_turn = STEPS_PER_TURN;
+    m.phi_per_step = phi = 2.0 * M_PI / (double)STEPS_PER_TURN;
+    m.steptime = 250;
+    m.omega = calc_omega (m.steps_per_turn, m.steptime);
+    m.a_start = m.a_stop = 300.0;
+    m.jerk = jerk;
+    m.num_steps = 4000;
+
+    uint64_t ns = monotonic_ns ();
+    step_table_start (&m);
+    while ((e = step_table_peek (&m)) != NULL) {
+        t = 2.0 * phi / (w0 + e->omega);                /* time of the step [s] */
+        j = (e->alpha - a0) / t;
+        max_a = (fabs (e->alpha) > max_a) ? fabs (e->alpha) : max_a;
+        max_j = (fabs (j) > max_j) ? fabs (j) : max_j;
+        w0 = e->omega;
+        a0 = e->alpha;
+        sum_t += e->steptime;
+        steps++;
+        m.st.pos++;
+    }
+    ns = monotonic_ns () - ns;
+
+    printf ("-- %s  %6llu  %12.1f  %11.1f  %13.0f  %11.1f\n", name, (long long unsigned)steps,
+             (double)sum_t / 1000.0, max_a, max_j, (double)ns / (double)steps);
+}
+/*! --------------------------------------------------------------------
+ * @brief   compile a ramp without the driver thread
+ * @return  number of steps, steptime[] and mode[] of the steps
+ */
+#define RAMP_MAX 20000
+
+static uint64_t compile_ramp (uint64_t steps, double a_start, double a_stop, uint8_t engine,
+                              uint32_t *steptime, uint8_t *mode)
+{
+    static struct _mot_ctl_ m;
+    struct _step_entry_ *e;
+    uint64_t n = 0;
+
+    memset (&m, 0, sizeof(m));
+    m.steps_per_turn = STEPS_PER_TURN;
+    m.phi_per_step = 2.0 * M_PI / (double)STEPS_PER_TURN;
+    m.steptime = 250;
+    m.omega = calc_omega (m.steps_per_turn, m.steptime);
+    m.a_start = a_start;
+    m.a_stop = a_stop;
+    m.num_steps = steps;
+
+    mot_set_ramp_engine (engine);
+    step_table_start (&m);
+    while ((e = step_table_peek (&m)) != NULL) {
+        if (n < RAMP_MAX) {
+            steptime[n] = e->steptime;
+            mode[n] = e->mode;
+        }
+        n++;
+        m.st.pos++;
+    }
+    mot_set_ramp_engine (MOT_RAMP_DOUBLE);
+
+    return n;
+}
+/*! --------------------------------------------------------------------
+ * @brief   reader of the telemetry benchmark, like a monitor process.
+ *           Polls the last record of motor 1 until stop is set. The 
+ *           position of a CW move must never decrease.
+ */
+struct _tele_reader_ {
+    uint16_t motor;
+    volatile uint8_t stop;
+    uint64_t reads, found, back;        /* reads, records found, position decreased */
+    uint64_t ns;                        /* time of the reads */
+    int64_t position;                   /* last position */
+};
+
+static void *tele_reader (void *data)
+{
+    struct _tele_reader_ *r = (struct _tele_reader_ *)data;
+    struct _mot_tele_ *t = mot_tele_attach (MOT_TELE_NAME);
+    struct _mot_tele_rec_ rec;
+    uint64_t t0;
+
+    if (!t)
+        return NULL;
+    r->position = INT64_MIN;
+    while (!r->stop) {
+        t0 = monotonic_ns ();
+        if (mot_tele_latest (t, r->motor, &rec) == EXIT_SUCCESS) {
+            r->found++;
+            if (rec.position < r->position)
+                r->back++;
+            r->position = rec.position;
+        }
+        r->ns += monotonic_ns () - t0;
+        r->reads++;
+        usleep (100);                   /* 10 kHz */
+    }
+    mot_tele_detach (t);
+
+    return NULL;
+}
+/*! --------------------------------------------------------------------
+ * @brief   shared memory telemetry: 3 motors run, the records are written
+ *           every 1 ms per motor, a reader polls at 10 kHz.
+ *           records = written records, reads = reads of the reader
+ */
+static void bench_tele (void)
+{
+    const uint64_t steps = 4000;
+    static struct _mot_hist_ loop;
+    struct _tele_reader_ r;
+    struct _mot_ctl_ *mc[3];
+    struct _mot_tele_ *t;
+    pthread_t th;
+    int i;
+
+    printf ("\n-- tele: 3 motors, %llu steps, steptime=250 us, records every 1 ms, reader 10 kHz\n", (long long unsigned)steps);
+    if (mot_tele_open (MOT_TELE_NAME, 4096, 1000) != EXIT_SUCCESS)
+        return;
+
+    for (i = 0; i < 3; i++) {
+        mc[i] = new_mot (NULL, ENABLE_PIN_M1, DIR_PIN_M1, STEP_PIN_M1, STEPS_PER_TURN);
+        mot_set_steptime (mc[i], 250);
+        mot_setparam (mc[i], MOT_CW, steps, 0.0, 0.0);
+    }
+    memset (&r, 0, sizeof(r));
+    r.motor = mc[0]->id;
+    pthread_create (&th, NULL, tele_reader, &r);
+    mot_hist_reset (NULL);
+
+    for (i = 0; i < 3; i++)
+        mot_start (mc[i]);
+    for (i = 0; i < 3; i++)
+        wait_job (mc[i]);
+    usleep (5000);                      /* last records */
+    r.stop = 1;
+    pthread_join (th, NULL);
+    mot_loop_hist_snapshot (NULL, &loop);
+
+    t = mot_tele_attach (MOT_TELE_NAME);
+    printf ("-- records  reads  found  ns/read  position  real_stepcount  decreased  loop p99[us]\n");
+    printf ("-- %7llu  %5llu  %5llu  %7.0f  %8lli  %14lli  %9llu  %12.1f\n",
+             (long long unsigned)((t) ? t->head : 0), (long long unsigned)r.reads, (long long unsigned)r.found,
+             (r.reads) ? (double)r.ns / (double)r.reads : 0.0, (long long int)r.position,
+             (long long int)mc[0]->real_stepcount, (long long unsigned)r.back,
+             (double)mot_hist_percentile (&loop, 0.99) / 1000.0);
+    mot_tele_detach (t);
+    mot_tele_close ();
+
+    for (i = 0; i < 3; i++)
+        kill_mot (mc[i]);
+}
+/*! --------------------------------------------------------------------
+ * @brief   reader of the snapshot benchmark. Reads motor mc without pause
+ *           with mot_snapshot() and, for comparison, field by field.
+ *           A CW job from position 0: position == stepcount in every 
+ *           coherent state.
+ */
+struct _snap_reader_ {
+    struct _mot_ctl_ *mc;
+    volatile uint8_t stop;
+    uint64_t reads, ns;                 /* mot_snapshot(): reads and time */
+    uint64_t torn, back;                /* mot_snapshot(): position != stepcount, position decreased */
+    uint64_t raw_torn;                  /* field by field: position != stepcount */
+};
+
+static void *snap_reader (void *data)
+{
+    struct _snap_reader_ *r = (struct _snap_reader_ *)data;
+    struct _mot_snapshot_ s;
+    int64_t position = 0, raw;
+    uint64_t t0;
+
+    while (!r->stop) {
+        t0 = monotonic_ns ();
+        mot_snapshot (r->mc, &s);
+        r->ns += monotonic_ns () - t0;
+        r->reads++;
+        if (s.position != (int64_t)s.stepcount)
+            r->torn++;
+        if (s.position < position)
+            r->back++;
+        position = s.position;
+
+        raw = __atomic_load_n (&r->mc->real_stepcount, __ATOMIC_RELAXED);
+        if (raw != (int64_t)__atomic_load_n (&r->mc->current_stepcount, __ATOMIC_RELAXED))
+            r->raw_torn++;
+    }
+
+    return NULL;
+}
+/*! --------------------------------------------------------------------
+ * @brief   mot_snapshot(): one motor runs with 20 kHz, a thread reads
+ *           its state without pause.
+ *           torn = states with position != stepcount
+ */
+static void bench_snap (void)
+{
+    const uint64_t steps = 20000;
+    const uint32_t steptime = 50;                           /* [us] */
+    static struct _mot_hist_ late;
+    struct _snap_reader_ r;
+    pthread_t th;
+
+    printf ("\n-- snap: one motor, %llu steps, steptime=%u us, reader without pause\n", (long long unsigned)steps, steptime);
+    printf ("-- reads  ns/read  torn  decreased  field by field torn  late p99[us]\n");
+
+    memset (&r, 0, sizeof(r));
+    r.mc = new_mot (NULL, ENABLE_PIN_M1, DIR_PIN_M1, STEP_PIN_M1, STEPS_PER_TURN);
+    mot_set_steptime (r.mc, steptime);
+    mot_setparam (r.mc, MOT_CW, steps, 0.0, 0.0);
+    pthread_create (&th, NULL, snap_reader, &r);
+
+    mot_start (r.mc);
+    wait_job (r.mc);
+    r.stop = 1;
+    pthread_join (th, NULL);
+    mot_hist_snapshot (r.mc, &late, NULL);
+
+    printf ("-- %8llu  %7.0f  %4llu  %9llu  %19llu  %12.1f\n",
+             (long long unsigned)r.reads, (r.reads) ? (double)r.ns / (double)r.reads : 0.0,
+             (long long unsigned)r.torn, (long long unsigned)r.back, (long long unsigned)r.raw_torn,
+             (double)mot_hist_percentile (&late, 0.99) / 1000.0);
+    kill_mot (r.mc);
+}
+/*! --------------------------------------------------------------------
+ * @brief   start of an idle motor: time from the call of mot_start() to
+ *           the first step minus the steptime of the first step, and the 
+ *           cpu time of the idle driver thread.
+ */
+static void bench_wake (void)
+{
+    const int starts = 200;
+    const uint32_t steptime = 100;                          /* [us] */
+    static struct _mot_hist_ delay;
+    struct _mot_snapshot_ s;
+    uint64_t t0, cpu;
+    int i;
+
+    printf ("\n-- wake: %i starts of an idle motor, one step, steptime=%u us\n", starts, steptime);
+    printf ("-- start to first step: p50[us]  p99[us]  max[us]   idle cpu[%%]\n");
+
+    struct _mot_ctl_ *mc = new_mot (NULL, ENABLE_PIN_M1, DIR_PIN_M1, STEP_PIN_M1, STEPS_PER_TURN);
+    mot_set_steptime (mc, steptime);
+    mot_setparam (mc, MOT_CW, 1, 0.0, 0.0);
+    memset (&delay, 0, sizeof(delay));
+
+    for (i = 0; i < starts; i++) {
+        usleep (2000 + (uint32_t)(rand () % 1000));         /* the driver thread is idle */
+        t0 = monotonic_ns ();
+        mot_start (mc);
+        wait_job (mc);
+        mot_snapshot (mc, &s);                              /* s.t = deadline of the step */
+        mot_hist_add (&delay, s.t + (uint64_t)s.latency - t0 - (uint64_t)steptime * 1000);
+    }
+
+    cpu = cpu_time ();
+    usleep (1000000);
+    cpu = cpu_time () - cpu;
+
+    printf ("--                        %7.1f  %7.1f  %7.1f  %11.2f\n",
+             (double)mot_hist_percentile (&delay, 0.5) / 1000.0,
+             (double)mot_hist_percentile (&delay, 0.99) / 1000.0,
+             (double)delay.max / 1000.0,
+             100.0 * (double)cpu / 1000000.0);
+    kill_mot (mc);
+}
+/*! --------------------------------------------------------------------
+ * @brief   callback of the done benchmark: time of the call
+ */
+static void done_cb (struct _mot_ctl_ *mc, void *arg)
+{
+    (void)mc;
+    __atomic_store_n ((uint64_t *)arg, monotonic_ns (), __ATOMIC_RELEASE);
+}
+/*! --------------------------------------------------------------------
+ * @brief   end of a job to the reaction of the application:
+ *           poll     = mot_snapshot() every 1 ms
+ *           wait     = mot_wait_job()
+ *           eventfd  = poll() on mot_job_fd()
+ *           callback = mot_set_job_callback()
+ *           One step jobs, the end of the job is the time of the step.
+ */
+static void bench_done (void)
+{
+    const char *name[4] = {"poll    ", "wait    ", "eventfd ", "callback"};
+    const int jobs = 100;
+    const uint32_t steptime = 100;                          /* [us] */
+    static struct _mot_hist_ h;
+    struct _mot_snapshot_ s;
+    struct pollfd pfd;
+    uint64_t t, cb_t, n;
+    int mode, i;
+
+    printf ("\n-- done: %i one step jobs, steptime=%u us, end of job to reaction\n", jobs, steptime);
+    printf ("-- mode      p50[us]  p99[us]  max[us]\n");
+
+    struct _mot_ctl_ *mc = new_mot (NULL, ENABLE_PIN_M1, DIR_PIN_M1, STEP_PIN_M1, STEPS_PER_TURN);
+    mot_set_steptime (mc, steptime);
+    mot_setparam (mc, MOT_CW, 1, 0.0, 0.0);
+    pfd.fd = mot_job_fd (mc);
+    pfd.events = POLLIN;
+
+    for (mode = 0; mode < 4; mode++) {
+        memset (&h, 0, sizeof(h));
+        if (mode == 3)
+            mot_set_job_callback (mc, done_cb, &cb_t);
+        for (i = 0; i < jobs; i++) {
+            cb_t = 0;
+            if (read (pfd.fd, &n, sizeof(n)) < 0)           /* clear the eventfd */
+                n = 0;
+            mot_start (mc);
+            switch (mode) {
+                case 0:
+                    while ((mot_snapshot (mc, &s) == EXIT_SUCCESS) && s.aktiv)
+                        usleep (1000);
+                    t = monotonic_ns ();
+                    break;
+                case 1:
+                    mot_wait_job (mc, 0);
+                    t = monotonic_ns ();
+                    break;
+                case 2:
+                    poll (&pfd, 1, -1);
+                    t = monotonic_ns ();
+                    break;
+                default:
+                    while (!(t = __atomic_load_n (&cb_t, __ATOMIC_ACQUIRE)))
+                        usleep (1000);
+                    break;
+            }
+            mot_snapshot (mc, &s);                          /* s.t = deadline of the step */
+            mot_hist_add (&h, t - (s.t + (uint64_t)s.latency));
+        }
+        printf ("-- %s  %7.1f  %7.1f  %7.1f\n", name[mode],
+                 (double)mot_hist_percentile (&h, 0.5) / 1000.0,
+                 (double)mot_hist_percentile (&h, 0.99) / 1000.0,
+                 (double)h.max / 1000.0);
+    }
+    mot_set_job_callback (mc, NULL, NULL);
+    kill_mot (mc);
+}
+/*! --------------------------------------------------------------------
+ * @brief   cost of a message in the driver thread (end of a job):
+ *           printf = printf with fflush, like a terminal (line buffered)
+ *           rt_log = record in the ring of the thread, see: rt_log.h
+ *           10 bursts of 100 messages, stdout is /dev/null. A burst fits
+ *           into the ring (RT_LOG_RING), the writer empties the ring 
+ *           between two bursts: no record is dropped.
+ */
+static void bench_log (void)
+{
+    const char *name[2] = {"printf", "rt_log"};
+    static struct _mot_hist_ h;
+    uint64_t t, dropped;
+    int mode, burst, i, fd, out;
+
+    printf ("\n-- log: 10 x 100 messages, stdout = /dev/null\n");
+    printf ("-- mode    p50[ns]  p99[ns]  max[ns]  dropped\n");
+    rt_log_thread ("bench");                                /* the ring is allocated before the measurement */
+    rt_log_flush ();
+    fflush (stdout);
+    if (((fd = open ("/dev/null", O_WRONLY)) < 0) || ((out = dup (STDOUT_FILENO)) < 0))
+        return;
+
+    for (mode = 0; mode < 2; mode++) {
+        memset (&h, 0, sizeof(h));
+        dropped = rt_log_dropped ();
+        dup2 (fd, STDOUT_FILENO);
+        for (burst = 0; burst < 10; burst++) {
+            for (i = 0; i < 100; i++) {
+                t = monotonic_ns ();
+                if (mode == 0) {
+                    printf ("-- max_latency=%lli us  current_stepcount=%llu  runtime=%lli us   real_stepcout=%lli\n",
+                             (long long int)i, (long long unsigned)burst, (long long int)t, (long long int)-i);
+                    fflush (stdout);
+                } else
+                    rt_log ("-- max_latency=%lli us  current_stepcount=%llu  runtime=%lli us   real_stepcout=%lli\n",
+                             (long long int)i, (long long unsigned)burst, (long long int)t, (long long int)-i);
+                mot_hist_add (&h, monotonic_ns () - t);
+            }
+            usleep (2 * RT_LOG_PERIOD_US);                  /* the writer empties the ring */
+        }
+        rt_log_flush ();
+        fflush (stdout);
+        dup2 (out, STDOUT_FILENO);
+        printf ("-- %s  %7llu  %7llu  %7llu  %7llu\n", name[mode],
+                 (long long unsigned)mot_hist_percentile (&h, 0.5),
+                 (long long unsigned)mot_hist_percentile (&h, 0.99),
+                 (long long unsigned)h.max,
+                 (long long unsigned)(rt_log_dropped () - dropped));
+        fflush (stdout);
+    }
+    close (out);
+    close (fd);
+}
+/*! --------------------------------------------------------------------
+ * @brief   child process of bench_rt(): the driver is initialized with
+ *           or without real time safe mode. One motor runs, the API 
+ *           creates and removes a motor and a diagram with 2000 points.
+ *           faults = minor page faults of the process while the motor runs
+ *           allocs = malloc() of the driver thread (see: mot_rt_allocs())
+ */
+static void run_rt (uint8_t rt)
+{
+    const uint64_t steps = 5000;
+    const uint32_t steptime = 100;                          /* [us] */
+    static struct _mot_hist_ late;
+    struct _mot_rt_cfg_ cfg;
+    struct _mot_rt_state_ st;
+    struct _mot_snapshot_ s;
+    struct rusage r0, r1;
+    uint64_t cycles = 0, allocs;
+    int k;
+
+    mot_rt_default (&cfg);
+    cfg.points = 2048;
+    if ((rt && (mot_rt_init (&cfg) != EXIT_SUCCESS)) || (init_mot_ctl () != EXIT_SUCCESS))
+        exit (EXIT_FAILURE);
+
+    struct _mot_ctl_ *mc = new_mot (NULL, ENABLE_PIN_M1, DIR_PIN_M1, STEP_PIN_M1, STEPS_PER_TURN);
+    mot_set_steptime (mc, steptime);
+    mot_setparam (mc, MOT_CW, steps, 0.0, 0.0);
+    getrusage (RUSAGE_SELF, &r0);
+    mot_start (mc);
+
+    while ((mot_snapshot (mc, &s) == EXIT_SUCCESS) && s.aktiv) {
+        struct _mot_ctl_ *m = new_mot (NULL, ENABLE_PIN_M2, DIR_PIN_M2, STEP_PIN_M2, STEPS_PER_TURN);
+        struct _motion_diagram_ *md = new_md (m);
+        for (k = 1; k <= 2000; k++)
+            add_mp_Hz (md, 100.0, 0.001 * k);
+        kill_md (md);
+        kill_mot (m);
+        cycles++;
+    }
+    getrusage (RUSAGE_SELF, &r1);
+
+    mot_hist_snapshot (mc, &late, NULL);
+    mot_rt_get (&st);
+    allocs = mot_rt_allocs ();
+    printf ("-- %s  %7.1f  %7.1f  %6li  %6s  %9s  %6llu\n", (rt) ? "rt safe" : "malloc ",
+             (double)mot_hist_percentile (&late, 0.99) / 1000.0, (double)late.max / 1000.0,
+             r1.ru_minflt - r0.ru_minflt, (st.locked) ? "yes" : "no",
+             (allocs == MOT_RT_NO_CHECK) ? "off" : (allocs) ? "FAILED" : "0", (long long unsigned)cycles);
+    fflush (stdout);
+    kill_all_mot_ctrl ();
+    exit ((allocs && (allocs != MOT_RT_NO_CHECK)) ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+/*! --------------------------------------------------------------------
+ * @brief   real time safe mode (mot_rt_init()) against malloc. Every mode
+ *           runs in its own process, it must be called before 
+ *           init_mot_ctl().
+ * @return  EXIT_FAILURE = a driver thread has allocated memory
+ */
+static int bench_rt (void)
+{
+    int rt, status, ret = EXIT_SUCCESS;
+    pid_t pid;
+
+    printf ("\n-- rt: 5000 steps, steptime=100 us, the API creates a motor and a diagram with 2000 points\n");
+    printf ("-- mode     p99[us]  max[us]  faults  locked  rt allocs  cycles\n");
+    for (rt = 0; rt < 2; rt++) {
+        fflush (stdout);
+        if ((pid = fork ()) == 0)
+            run_rt ((uint8_t)rt);
+        if ((pid < 0) || (waitpid (pid, &status, 0) != pid) || !WIFEXITED (status) || WEXITSTATUS (status))
+            ret = EXIT_FAILURE;
+    }
+
+    return ret;
+}
+/*! --------------------------------------------------------------------
+ * @brief   automatic microstep switching: 1/16 step at low speed, full 
+ *           step above 20 rad/s. A trapezoid CW and back CCW, 
+ *           real_stepcount must be 0 at the end.
+ *           pulses = step pulses of the driver thread
+ */
+static void bench_ms (void)
+{
+    const uint64_t steps = 64000;
+    const char *name[2] = {"1/16 ", "auto "};
+    static struct _mot_hist_ late, early;
+    struct _mot_ctl_ *mc = new_mot (NULL, ENABLE_PIN_M1, DIR_PIN_M1, STEP_PIN_M1, 3200);
+    int i, dir;
+
+    printf ("\n-- ms: 200 steps motor with 1/16 microstep, %llu steps, steptime=20 us, a=200 s⁻2\n", (long long unsigned)steps);
+    printf ("-- mode   dir   steps  real_stepcount  pulses  switches  max[us]  runtime[ms]\n");
+    mot_set_ms_pins (mc, MS1_PIN, MS2_PIN, MS3_PIN);
+    mot_set_steptime (mc, 20);
+    for (i = 0; i < 2; i++) {
+        if (i == 0)
+            mot_set_microstep (mc, MOT_MS_SIXTEENTH, MOT_MS_SIXTEENTH, 0.0, 0.0);
+        else
+            mot_set_microstep (mc, MOT_MS_SIXTEENTH, MOT_MS_FULL, 20.0, 10.0);
+        for (dir = MOT_CW; dir <= MOT_CCW; dir++) {
+            uint32_t sw = mc->ms.switches;
+            mot_hist_reset (mc);
+            mot_setparam (mc, dir, steps, 200.0, 200.0);
+            mot_start (mc);
+            wait_job (mc);
+            mot_hist_snapshot (mc, &late, &early);
+            printf ("-- %s  %s  %6llu  %14lli  %6llu  %8u  %7llu  %11.1f\n", name[i], (dir == MOT_CW) ? "CW " : "CCW",
+                     (long long unsigned)mc->current_stepcount, (long long int)mc->real_stepcount,
+                     (long long unsigned)(late.n + early.n), mc->ms.switches - sw,
+                     (long long unsigned)mc->max_latency, (double)mc->runtime / 1000.0);
+        }
+    }
+    kill_mot (mc);
+}
+/*! --------------------------------------------------------------------
+ * @brief   MOT_RAMP_DOUBLE and MOT_RAMP_FIXED: same moves, number of steps,
+ *           braking point, max. difference of the step delays and ns/step.
+ */
+static void bench_ramp_fixed (void)
+{
+    static uint32_t st[2][RAMP_MAX];
+    static uint8_t mode[2][RAMP_MAX];
+    const struct { uint64_t steps; double a_start, a_stop; } move[4] = {
+        {4000, 300.0, 300.0}, {4000, 100.0, 400.0}, {300, 300.0, 300.0}, {20000, 50.0, 50.0}
+    };
+    const int loops = 20;
+    uint64_t n[2], ns[2], brake[2], i;
+    int k, l, eng;
+
+    printf ("\n-- ramp: MOT_RAMP_DOUBLE / MOT_RAMP_FIXED, steptime=250 us\n");
+    printf ("-- steps  a_start  a_stop   steps d/f    brake d/f   max diff[%%]  double[ns/step]  fixed[ns/step]\n");
+    for (k = 0; k < 4; k++) {
+        for (eng = MOT_RAMP_DOUBLE; eng <= MOT_RAMP_FIXED; eng++) {
+            ns[eng] = monotonic_ns ();
+            for (l = 0; l < loops; l++)
+                n[eng] = compile_ramp (move[k].steps, move[k].a_start, move[k].a_stop, eng, st[eng], mode[eng]);
+            ns[eng] = (monotonic_ns () - ns[eng]) / loops;
+            for (brake[eng] = 0; (brake[eng] < n[eng]) && (mode[eng][brake[eng]] != MOT_SPEED_DOWN); brake[eng]++);
+        }
+
+        double diff = 0.0, d;
+        for (i = 0; (i < n[0]) && (i < n[1]) && (i < RAMP_MAX); i++) {
+            d = fabs ((double)st[1][i] - (double)st[0][i]) / (double)st[0][i] * 100.0;
+            diff = (d > diff) ? d : diff;
+        }
+        printf ("-- %5llu  %7.0f  %6.0f  %5llu/%5llu  %5llu/%5llu  %11.2f  %15.1f  %14.1f\n",
+                 (long long unsigned)move[k].steps, move[k].a_start, move[k].a_stop,
+                 (long long unsigned)n[0], (long long unsigned)n[1],
+                 (long long unsigned)brake[0], (long long unsigned)brake[1], diff,
+                 (double)ns[0] / (double)n[0], (double)ns[1] / (double)n[1]);
+    }
+}
+/*! --------------------------------------------------------------------
+ * @brief   constant acceleration and S-curve. 4000 steps, alpha = 300 s⁻2,
+ *           steptime = 250 us.
+ */
+static void bench_ramp (void)
+{
+    printf ("\n-- ramp: 4000 steps, a_start=a_stop=300 s-2, steptime=250 us, compiled without driver thread\n");
+    printf ("-- profile          steps  move time[ms]  max a[s-2]  max jerk[s-3]  compile[ns/step]\n");
+    ramp_profile ("trapezoid      ", 0.0);
+    ramp_profile ("S-curve j=20000", 20000.0);
+    ramp_profile ("S-curve j=5000 ", 5000.0);
+    bench_ramp_fixed ();
+}
+/*! --------------------------------------------------------------------
+ * @brief   indexing job: 20 moves of 400 steps. 
+ *           single: mot_setparam(), mot_start() and wait for every move
+ *           queue:  mot_queue_move(), the moves are blended
+ *           The second line of each mode changes the direction every move,
+ *           so the queue has to stop between the moves.
+ */
+static void bench_queue (void)
+{
+    const int moves = 20;
+    const uint64_t steps = 400;
+    const uint32_t steptime = 300;                          /* [us] */
+    const double a = 200.0;                                 /* [s⁻2] */
+    uint64_t t;
+    int i, alt;
+
+    printf ("\n-- queue: %i moves, %llu steps, steptime=%u us, a_start=a_stop=%.0f s-2\n", 
+             moves, (long long unsigned)steps, steptime, a);
+    printf ("-- mode    direction   time[ms]  steps\n");
+
+    struct _mot_ctl_ *mc = new_mot (NULL, ENABLE_PIN_M1, DIR_PIN_M1, STEP_PIN_M1, STEPS_PER_TURN);
+    mot_set_steptime (mc, steptime);
+
+    for (alt = 0; alt <= 1; alt++) {
+        mc->real_stepcount = 0;
+        t = monotonic_ns ();
+        for (i = 0; i < moves; i++) {
+            mot_setparam (mc, (alt && (i & 1)) ? MOT_CCW : MOT_CW, steps, a, a);
+            mot_start (mc);
+            wait_job (mc);
+        }
+        printf ("-- single  %s  %8.1f  %5lli\n", (alt) ? "alternating" : "same       ",
+                 (double)(monotonic_ns () - t) / 1000000.0, (long long)mc->real_stepcount);
+    }
+
+    for (alt = 0; alt <= 1; alt++) {
+        mc->real_stepcount = 0;
+        t = monotonic_ns ();
+        for (i = 0; i < moves; i++)
+            mot_queue_move (mc, (alt && (i & 1)) ? MOT_CCW : MOT_CW, steps, steptime, a, a);
+        while (mot_queue_count (mc))
+            usleep (10000);
+        wait_job (mc);
+        printf ("-- queue   %s  %8.1f  %5lli\n", (alt) ? "alternating" : "same       ",
+                 (double)(monotonic_ns () - t) / 1000000.0, (long long)mc->real_stepcount);
+    }
+    kill_mot (mc);
+}
+/*! --------------------------------------------------------------------
+ * @brief   load time of a motion diagram: text file (new_md_from_file)
+ *           and binary file (new_md_from_bin). The profile changes the
+ *           direction every 1000 points.
+ */
+static void bench_mdload (void)
+{
+    const uint32_t points = 200000;
+    const char *txt = "/tmp/bench_md.dat";
+    const char *bin = "/tmp/bench_md.md";
+    struct _motion_diagram_ *md[2];
+    uint64_t t[2];
+    uint32_t i;
+    FILE *f;
+    int n;
+
+    printf ("\n-- mdload: %u points, rpm format\n", points);
+
+    if ((f = fopen (txt, "wt")) == NULL)
+        return;
+    fprintf (f, "# [min-1]  [s]\n");
+    for (i = 0; i < points; i++)
+        fprintf (f, "%.3f  %.4f\n", 120.0 * sin ((double)i * M_PI / 1000.0), (double)i * 0.001);
+    fclose (f);
+    if (md_convert (txt, bin, RPM) != EXIT_SUCCESS)
+        return;
+
+    struct _mot_ctl_ *mc = new_mot (NULL, ENABLE_PIN_M1, DIR_PIN_M1, STEP_PIN_M1, STEPS_PER_TURN);
+
+    t[0] = monotonic_ns ();
+    md[0] = new_md_from_file (mc, txt, RPM);
+    t[0] = monotonic_ns () - t[0];
+    t[1] = monotonic_ns ();
+    md[1] = new_md_from_bin (mc, bin);
+    t[1] = monotonic_ns () - t[1];
+
+    printf ("-- file    load[ms]  per point[ns]  move points  sum steps\n");
+    for (n = 0; n < 2; n++) {
+        if (!md[n])
+            continue;
+        printf ("-- %s  %8.1f  %13.0f  %11i  %9llu\n", (n) ? "binary" : "text  ",
+                 (double)t[n] / 1000000.0, (double)t[n] / points, count_mp (md[n]),
+                 (long long unsigned)md[n]->last_mp->sum_steps);
+    }
+
+    kill_md (md[0]);
+    kill_md (md[1]);
+    kill_mot (mc);
+    unlink (txt);
+    unlink (bin);
+}
+/*! --------------------------------------------------------------------
+ * @brief   writer of the stream benchmark: points every 1 ms, rpm format.
+ *           pause = pause in the middle of the profile [ms]
+ */
+struct _stream_writer_ {
+    int fd;
+    uint32_t points;
+    uint32_t pause;
+    uint64_t blocked;                   /* time in write() [ns] */
+};
+
+static void *stream_writer (void *data)
+{
+    struct _stream_writer_ *w = (struct _stream_writer_ *)data;
+    char str[64];
+    uint64_t t;
+    uint32_t i;
+    int len;
+
+    w->blocked = 0;
+    for (i = 1; i <= w->points; i++) {
+        if (w->pause && (i == w->points / 2))
+            usleep (w->pause * 1000);
+        len = snprintf (str, sizeof(str), "%.3f  %.4f\n", 600.0 * sin ((double)i * M_PI / w->points), (double)i * 0.001);
+        t = monotonic_ns ();
+        if (write (w->fd, str, len) != len)
+            break;
+        w->blocked += monotonic_ns () - t;
+    }
+    close (w->fd);
+
+    return NULL;
+}
+/*! --------------------------------------------------------------------
+ * @brief   streaming motion diagram from a pipe (64 kB pipe buffer
+ *           reduced to 4 kB). The ring holds MD_STREAM_SIZE points, the
+ *           writer is blocked, while the ring is full.
+ *           The second line pauses the writer in the middle of the profile.
+ */
+static void bench_stream (void)
+{
+    const uint32_t points = 2000;
+    const uint32_t pause[2] = {0, 1000};
+    struct _stream_writer_ w;
+    struct _motion_diagram_ *md;
+    pthread_t th;
+    uint64_t t, expected;
+    int fds[2], n;
+
+    printf ("\n-- stream: %u points every 1 ms, max. 600 rpm, ring %u points (%lu bytes), full diagram %lu bytes\n",
+             points, MD_STREAM_SIZE, (unsigned long)(MD_STREAM_SIZE * sizeof(struct _move_point_)),
+             (unsigned long)(points * sizeof(struct _move_point_)));
+    printf ("-- writer pause[ms]  time[ms]  writer blocked[ms]  underrun[ms]  steps  expected\n");
+
+    struct _mot_ctl_ *mc = new_mot (NULL, ENABLE_PIN_M1, DIR_PIN_M1, STEP_PIN_M1, STEPS_PER_TURN);
+
+    for (n = 0; n < 2; n++) {
+        if (pipe (fds) != 0)
+            break;
+        fcntl (fds[1], F_SETPIPE_SZ, 4096);
+        w.fd = fds[1];
+        w.points = points;
+        w.pause = pause[n];
+        pthread_create (&th, NULL, stream_writer, &w);
+
+        t = monotonic_ns ();
+        md = new_md_from_stream (mc, fds[0], RPM);
+        pthread_join (th, NULL);
+        if (!md)
+            break;
+        expected = md->last_mp->sum_steps;
+        wait_job (mc);
+        printf ("-- %17u  %8.1f  %18.1f  %12.1f  %5llu  %8llu\n", pause[n],
+                 (double)(monotonic_ns () - t) / 1000000.0, (double)w.blocked / 1000000.0,
+                 (double)md->underrun * MD_STREAM_WAIT_US / 1000.0,
+                 (long long unsigned)mc->current_stepcount, (long long unsigned)expected);
+        kill_md (md);
+    }
+    kill_mot (mc);
+}
+/*! --------------------------------------------------------------------
+ * @return  allocated heap memory [byte]
+ */
+static size_t heap_used (void)
+{
+#if __GLIBC_PREREQ(2, 33)
+    struct mallinfo2 mi = mallinfo2 ();
+#else
+    struct mallinfo mi = mallinfo ();
+#endif
+    return (size_t)mi.uordblks + (size_t)mi.hblkhd;
+}
+/*! --------------------------------------------------------------------
+ * @return  time of 10 passes through the list of move points [ns per point]
+ */
+static double walk_mp (struct _move_point_ *first, uint32_t points, uint64_t *sum)
+{
+    struct _move_point_ *mp;
+    uint64_t t = monotonic_ns ();
+    int n;
+
+    *sum = 0;
+    for (n = 0; n < 10; n++)
+        for (mp = first; mp; mp = mp->next)
+            *sum += mp->steps;
+
+    return (double)(monotonic_ns () - t) / 10.0 / points;
+}
+/*! --------------------------------------------------------------------
+ * @brief   memory and traversal of a 100k point diagram.
+ *           block:   the points of the diagram (md->mp_pool), grows by doubling
+ *           reserve: block with md_reserve() before the points are added
+ *           malloc:  one malloc per point, between the points the heap is
+ *                   used by other allocations (the storage before the block)
+ */
+static void bench_mdpool (void)
+{
+    const uint32_t points = 100000;
+    struct _move_point_ *mp, *prev = NULL, *first = NULL;
+    void **other;
+    size_t heap;
+    uint64_t t, t_kill, sum;
+    double walk;
+    uint32_t i;
+    int n;
+
+    printf ("\n-- mdpool: %u move points, %lu bytes per point\n", points, (unsigned long)sizeof(struct _move_point_));
+    printf ("-- storage  build[ms]  heap[kB]  walk[ns/point]  kill[us]  sum steps\n");
+
+    struct _mot_ctl_ *mc = new_mot (NULL, ENABLE_PIN_M1, DIR_PIN_M1, STEP_PIN_M1, STEPS_PER_TURN);
+
+    for (n = 0; n < 2; n++) {
+        heap = heap_used ();
+        t = monotonic_ns ();
+        struct _motion_diagram_ *md = new_md (mc);
+        if (n)
+            md_reserve (md, points + 1);
+        for (i = 1; i <= points; i++)
+            add_mp_rpm (md, 120.0 + 60.0 * sin ((double)i * M_PI / 1000.0), (double)i * 0.001);
+        t = monotonic_ns () - t;
+        heap = heap_used () - heap;
+        walk = walk_mp (md->first_mp, points, &sum);
+        t_kill = monotonic_ns ();
+        kill_md (md);
+        t_kill = monotonic_ns () - t_kill;
+        printf ("-- %s  %9.1f  %8lu  %14.1f  %8.0f  %9llu\n", (n) ? "reserve" : "block  ", (double)t / 1000000.0, 
+                 (unsigned long)(heap / 1024), walk, (double)t_kill / 1000.0, (long long unsigned)sum);
+    }
+
+    other = (void **) malloc (points * sizeof(void *));
+    heap = heap_used ();
+    t = monotonic_ns ();
+    for (i = 0; i < points; i++) {
+        mp = (struct _move_point_ *) malloc (sizeof(struct _move_point_));
+        other[i] = malloc (16 + (i * 7919) % 240);          /* other users of the heap */
+        mp->steps = 1;
+        mp->next = NULL;
+        mp->prev = prev;
+        if (prev)
+            prev->next = mp;
+        else
+            first = mp;
+        prev = mp;
+    }
+    t = monotonic_ns () - t;
+    for (i = 0; i < points; i++)
+        free (other[i]);
+    heap = heap_used () - heap;
+    walk = walk_mp (first, points, &sum);
+    t_kill = monotonic_ns ();
+    while (first) {
+        mp = first->next;
+        free (first);
+        first = mp;
+    }
+    t_kill = monotonic_ns () - t_kill;
+    free (other);
+    printf ("-- malloc   %9.1f  %8lu  %14.1f  %8.0f  %9llu\n", (double)t / 1000000.0, (unsigned long)(heap / 1024),
+             walk, (double)t_kill / 1000.0, (long long unsigned)sum);
+
+    kill_mot (mc);
+}
+/*! --------------------------------------------------------------------
+ *
+ */
+int main (int argc, char *argv[])
+{
+    const char *sel = (argc > 1) ? argv[1] : NULL;
+    int ret = EXIT_SUCCESS;
+
+    if (sel && !strcmp (sel, "all"))
+        sel = NULL;
+    if (argc > 2) {
+        if (!strcmp (argv[2], "mem"))
+            mot_set_gpio (MOT_GPIO_MEM, 1000);
+        else if (!strcmp (argv[2], "emu"))
+            mot_set_gpio (MOT_GPIO_MEM_EMULATED, 1000);
+        else if (!strcmp (argv[2], "chardev"))
+            mot_set_gpio (MOT_GPIO_CHARDEV, 1000);
+        else if (!strcmp (argv[2], "sim"))
+            mot_set_gpio (MOT_GPIO_SIM, 1000);
+        else if (!strcmp (argv[2], "wiringpi"))
+            mot_set_gpio (MOT_GPIO_WIRINGPI, 1000);
+    }
+
+    if (!sel || !strcmp (sel, "rt"))               /* before init_mot_ctl(): child processes */
+        ret = bench_rt ();
+
+    if (init_mot_ctl () != EXIT_SUCCESS)
+        return EXIT_FAILURE;
+
+    if (!sel || !strcmp (sel, "jitter"))
+        bench_jitter ();
+    if (!sel || !strcmp (sel, "motors"))
+        bench_motors ();
+    if (!sel || !strcmp (sel, "ctrl"))
+        bench_ctrl ();
+    if (!sel || !strcmp (sel, "api"))
+        bench_api ();
+    if (!sel || !strcmp (sel, "gpio"))
+        bench_gpio ();
+    if (!sel || !strcmp (sel, "sim"))
+        bench_sim ();
+    if (!sel || !strcmp (sel, "hist"))
+        bench_hist ();
+    if (!sel || !strcmp (sel, "line"))
+        bench_line ();
+    if (!sel || !strcmp (sel, "ramp"))
+        bench_ramp ();
+    if (!sel || !strcmp (sel, "queue"))
+        bench_queue ();
+    if (!sel || !strcmp (sel, "mdload"))
+        bench_mdload ();
+    if (!sel || !strcmp (sel, "stream"))
+        bench_stream ();
+    if (!sel || !strcmp (sel, "mdpool"))
+        bench_mdpool ();
+    if (!sel || !strcmp (sel, "ms"))
+        bench_ms ();
+    if (!sel || !strcmp (sel, "tele"))
+        bench_tele ();
+    if (!sel || !strcmp (sel, "snap"))
+        bench_snap ();
+    if (!sel || !strcmp (sel, "wake"))
+        bench_wake ();
+    if (!sel || !strcmp (sel, "done"))
+        bench_done ();
+    if (!sel || !strcmp (sel, "log"))
+        bench_log ();
+
+    kill_all_mot_ctrl ();                           /* wait for thread ending */
+
+    return ret;
+}
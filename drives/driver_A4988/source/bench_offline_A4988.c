@@ -0,0 +1,136 @@
+/*! ---------------------------------------------------------------------
+ * @file    bench_offline_A4988.c
+ * @date    10-17-2026
+ * @name    Ulrich Buettemeier
+ * @brief   speed of the step engine without driver thread and gpio.
+ *          The steps are executed by mot_run_offline() with a virtual
+ *          clock, the pin changes go to the null backend (MOT_GPIO_NULL).
+ *          So the result is the cpu time per step of the engine
+ *          (compilation, heap, step accounting) and doesn't depend on
+ *          the scheduler or the gpio access.
+ *          usage: bench_offline_A4988 [max. number of motors]   (default: 8)
+ *          Run in source/, the motion diagrams are curve_1.dat and curve_2.dat.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "driver_A4988.h"
+#include "../../../tools/rpi_tools/rpi_tools.h"
+
+#define ENABLE_PIN_M1 25     /* GPIO.25  PIN 37 */
+#define STEP_PIN_M1   24     /* GPIO.24  PIN 35 */
+#define DIR_PIN_M1    23     /* GPIO.23  PIN 33 */
+
+#define STEPS_PER_TURN 400
+#define MAX_MOTORS MOT_MAX
+
+enum JOB {
+    JOB_TRAPEZOID = 0,          /* mot_setparam() with speed-up and speed-down */
+    JOB_ENDLESS = 1,            /* constant speed, stopped after ENDLESS_NS */
+    JOB_CURVE_1 = 2,            /* curve_1.dat, RPM */
+    JOB_CURVE_2 = 3             /* curve_2.dat, STEP */
+};
+
+#define TRAPEZOID_STEPS 100000
+#define ENDLESS_NS 10000000000ull       /* virtual run time of the endless job [ns] */
+#define CURVE_REPEAT 20
+
+static struct _mot_ctl_ *mc[MAX_MOTORS];
+
+/*! --------------------------------------------------------------------
+ * @brief   one job for n motors
+ * @return  executed steps of all motors
+ */
+static uint64_t run_job (int job, int n)
+{
+    static const char *fname[2] = {"curve_1.dat", "curve_2.dat"};
+    static const uint8_t format[2] = {RPM, STEP};
+    struct _motion_diagram_ *md[MAX_MOTORS];
+    uint64_t steps = 0;
+    int i, r;
+
+    switch (job) {
+        case JOB_TRAPEZOID:
+        case JOB_ENDLESS:
+            for (i = 0; i < n; i++) {
+                if (job == JOB_TRAPEZOID)
+                    mot_setparam (mc[i], MOT_CW, TRAPEZOID_STEPS, 300.0, 300.0);
+                else
+                    mot_setparam (mc[i], MOT_CW, 0, 0.0, 0.0);
+                mot_start (mc[i]);
+            }
+            mot_run_offline ((job == JOB_ENDLESS) ? ENDLESS_NS : 0);
+            for (i = 0; i < n; i++) {
+                mot_fast_stop (mc[i]);
+                steps += mc[i]->current_stepcount;
+            }
+            break;
+
+        case JOB_CURVE_1:
+        case JOB_CURVE_2:
+            for (i = 0; i < n; i++) {
+                if ((md[i] = new_md_from_file (mc[i], fname[job - JOB_CURVE_1], format[job - JOB_CURVE_1])) == NULL)
+                    return 0;
+            }
+            for (r = 0; r < CURVE_REPEAT; r++) {
+                for (i = 0; i < n; i++)
+                    mot_start_md (md[i]);
+                mot_run_offline (0);
+                for (i = 0; i < n; i++)
+                    steps += mc[i]->current_stepcount;
+            }
+            for (i = 0; i < n; i++)
+                kill_md (md[i]);
+            break;
+    }
+
+    return steps;
+}
+/*! --------------------------------------------------------------------
+ *
+ */
+int main (int argc, char *argv[])
+{
+    const char *name[4] = {"trapezoid", "endless  ", "curve_1  ", "curve_2  "};
+    int max = (argc > 1) ? atoi (argv[1]) : 8;
+    uint64_t t, steps, t_virt;
+    int job, n, i;
+
+    if ((max < 1) || (max > MAX_MOTORS))
+        max = 8;
+
+    mot_set_gpio (MOT_GPIO_NULL, 0);
+    if (init_mot_offline () != EXIT_SUCCESS)
+        return EXIT_FAILURE;
+
+    for (i = 0; i < max; i++) {
+        mc[i] = new_mot (NULL, ENABLE_PIN_M1, DIR_PIN_M1, STEP_PIN_M1, STEPS_PER_TURN);
+        mot_set_steptime (mc[i], 100 + 10 * i);     /* different deadlines */
+    }
+
+    printf ("\n-- offline: virtual clock, null gpio, sizeof(struct _mot_ctl_)=%lu\n", (unsigned long)sizeof(struct _mot_ctl_));
+    printf ("-- job        motors      steps  virtual[ms]  ns/step   steps/s\n");
+    for (job = JOB_TRAPEZOID; job <= JOB_CURVE_2; job++) {
+        for (n = 1; n <= max; n *= 2) {
+            t_virt = mot_offline_now ();
+            t = monotonic_ns ();
+            steps = run_job (job, n);
+            t = monotonic_ns () - t;
+            t_virt = mot_offline_now () - t_virt;
+            if (!steps) {
+                printf ("-- %s  %6i  no steps\n", name[job], n);
+                continue;
+            }
+            printf ("-- %s  %6i  %9llu  %11.1f  %7.1f  %8.3gM\n", name[job], n, (long long unsigned)steps,
+                     (double)t_virt / 1000000.0, (double)t / steps, (double)steps * 1000.0 / t);
+        }
+    }
+
+    for (i = 0; i < max; i++)
+        kill_mot (mc[i]);
+
+    return EXIT_SUCCESS;
+}
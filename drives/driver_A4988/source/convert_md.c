@@ -0,0 +1,39 @@
+/*! ---------------------------------------------------------------------
+ * @file    convert_md.c
+ * @date    10-16-2026
+ * @name    Ulrich Buettemeier
+ * @brief   converts a motion diagram text file to the binary format
+ *          usage: convert_md <text file> <binary file> [omega|freq|rpm|step]
+ *          default speed format: rpm
+ * @example convert_md curve_1.dat curve_1.md rpm
+ *          convert_md curve_2.dat curve_2.md step
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "driver_A4988.h"
+
+int main (int argc, char *argv[])
+{
+    const char *name[4] = {"omega", "freq", "rpm", "step"};
+    uint8_t speedformat = RPM;
+
+    if (argc < 3) {
+        printf ("usage: convert_md <text file> <binary file> [omega|freq|rpm|step]\n");
+        return EXIT_FAILURE;
+    }
+    if (argc > 3) {
+        for (speedformat = OMEGA; speedformat <= STEP; speedformat++)
+            if (!strcmp (argv[3], name[speedformat]))
+                break;
+        if (speedformat > STEP) {
+            printf ("-- unknown speed format <%s>\n", argv[3]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    return md_convert (argv[1], argv[2], speedformat);
+}
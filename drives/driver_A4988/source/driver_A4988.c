@@ -15,23 +15,19 @@
  *          struct _mot_ctl_ *m1 = NULL;
  * 
  *          init_mot_ctl ();    
- *          sleep (1);
- *          m1 = new_mot (25, 23, 24, 400);              // param: GPIO_ENABLE PIN, GPIO_DIR PIN, GPIO_STEP PIN, steps_per_turn
+ *          m1 = new_mot (NULL, 25, 23, 24, 400);        // param: controller, GPIO_ENABLE PIN, GPIO_DIR PIN, GPIO_STEP PIN, steps_per_turn
  *          mot_setparam (m1, MOT_CW, 400, 20.0, 40.0);  // 400 steps, speed up=20 s⁻2, speed down=40 s⁻2
  *          mot_start (m1);
  * 
- *          while (m1->flag.aktive) sleep(1);
+ *          mot_wait_job (m1, 0);                // returns at the end of the job, see: mot_notify.c
  * 
  *          mot_disenable (m1);
- *          kill_all_mot ();                    
- *          thread_state.kill = 1;
- *          while (!thread_state.run); 
+ *          kill_all_mot_ctrl ();               // kills the motors and stops the driver threads
  * 
  *          return ( 0 );
  *      }
  */
 
-#define USE_GPIO
 #define _GNU_SOURCE
  
 #include <stdio.h>
@@ -39,331 +35,1348 @@
 #include <stdint.h>
 #include <string.h>
 #include <unistd.h>
-
-#ifdef USE_GPIO
-#include <wiringPi.h>
-#endif
-
 #include <sys/time.h>
 #include <pthread.h>
 #include <sched.h>
 #include <math.h>
  
 #include "../../../tools/rpi_tools/rpi_tools.h"
+#include "../../../tools/gpio/gpio.h"
+#include "../../../tools/gpio/gpio_mem.h"
+#include "../../../tools/gpio/gpio_sim.h"
+#include "../../../tools/futex/futex.h"
+#include "../../../tools/rt_log/rt_log.h"
 #include "driver_A4988.h"
 
 
-struct _thread_state_ thread_state = {
-    .run = 0,
-    .kill = 0
-};
+struct _mot_ctrl_ *first_ctrl = NULL;                   /* all controllers. see: new_mot_ctrl() */
+static struct _mot_ctrl_ *default_ctrl = NULL;          /* controller of init_mot_ctl() and new_mot (NULL, ...) */
+uint8_t is_init = 0;                                    /* gpio is initialized */
+
+static uint8_t gpio_access = GPIO_DEFAULT;              /* see: enum MOT_GPIO */
+static uint32_t pulse_ns = 1000;                        /* width of the step pulse [ns]. see: MOT_GPIO_MEM */
 
-pthread_t thread_A4988 = 0;                             /* glob thread handle */
-struct _mot_ctl_ *first_mc = NULL, *last_mc = NULL;   /* motor control */
-uint8_t is_init = 0;
+static uint8_t sched_mode = MOT_SCHED_SLEEP;            /* see: enum MOT_SCHED_MODE */
+static uint64_t sched_spin = 50000;                     /* spin time before a deadline [ns] */
+
+static const uint8_t ms_level[5][3] = {{0,0,0}, {1,0,0}, {0,1,0}, {1,1,0}, {1,1,1}};   /* MS1, MS2, MS3. see: enum MOT_MS */
+
+static uint8_t offline = 0;                             /* 1 = controllers without driver thread. see: init_mot_offline() */
+static uint64_t offline_now = 0;                        /* virtual clock of mot_run_offline() [ns] */
 
 struct _motion_diagram_ *first_md = NULL, *last_md = NULL;  /* motion diagram */
 
 /*! --------------------------------------------------------------------
- * 
- */
-static void printSchedulingPolicy(void)
+ * @brief  MOT_GPIO_MEM: the step pulses are collected by mot_step()
+ */ 
+#define BATCH_STEPS ((gpio_access == MOT_GPIO_MEM) || (gpio_access == MOT_GPIO_MEM_EMULATED))
+/*! --------------------------------------------------------------------
+ * @brief  The step pulses of all motors of one loop pass are executed 
+ *          with one write to GPSET0 and one write to GPCLR0.
+ *          After a change of a dir pin the setup time is waited.
+ *          used by driver_pass()
+ */ 
+static void flush_steps (struct _mot_ctrl_ *c)
 {
-    struct sched_param sp;
-    int which;
-
-    which = sched_getscheduler(0);    
-    sched_getparam (0, &sp);
-    printf ("-- priority = %i\n", sp.sched_priority);
+    if (!c->batch_mask)
+        return;
     
-    switch (which) {
-        case SCHED_OTHER: 
-            printf("-- default scheduling is being used\n");		
-            break;
-        case SCHED_FIFO:
-            printf("-- fifo scheduling is being used\n");		
-            break;
-        case SCHED_RR:		
-            printf("-- round robin scheduling is being used\n");		
-            break;
-	}		
+    if (c->batch_dir)
+        gpio_mem_wait_ns (pulse_ns);        /* dir setup time */
+    gpio_mem_pulse (c->batch_mask, pulse_ns);
+    c->batch_mask = 0;
+    c->batch_dir = 0;
+}
+/*! --------------------------------------------------------------------
+ * @brief  set the pins. Used by the driver thread and by new_mot(), 
+ *          kill_mot() while the driver thread doesn't know the motor.
+ */ 
+static void set_enable (struct _mot_ctl_ *mc, uint8_t enable)
+{
+    gpio_write (mc->mp.enable_pin, (mc->flag.enable = enable));
+}
+
+static void set_dir (struct _mot_ctl_ *mc, uint8_t direction)
+{
+    gpio_write (mc->mp.dir_pin, (mc->flag.dir = direction));
+}
+/*! --------------------------------------------------------------------
+ * @brief  microstep resolution fine - shift. A pending pulse of the motor 
+ *          is executed before, the setup time is waited by flush_steps().
+ *          see: mot_set_microstep()
+ * @param  shift = 0: fine, one pulse = 1 << shift steps
+ */
+static void ms_select (struct _mot_ctl_ *mc, uint8_t shift)
+{
+    int i;
+    
+    if (mc->ctrl->batch_mask & mc->step_mask)   /* the pulse was made with the old resolution */
+        flush_steps (mc->ctrl);
+    for (i = 0; i < 3; i++) 
+        if (mc->mp.ms_pin[i] != MOT_MS_PIN_NC)
+            gpio_write (mc->mp.ms_pin[i], ms_level[mc->ms.fine - shift][i]);
+    if (shift != mc->ms.shift)
+        mc->ms.switches++;
+    mc->ms.shift = shift;
+    mc->ctrl->batch_dir = 1;
 }
 /*! --------------------------------------------------------------------
  * @brief  Execute step
- *          used by execute_step()
+ *          used by execute_step() and MOT_CMD_STEP
+ * @param  batch = 1: with MOT_GPIO_MEM the pulse is executed by flush_steps()
  */ 
-static int mot_step (struct _mot_ctl_ *mc)
+static int mot_step (struct _mot_ctl_ *mc, uint8_t batch)
 {
     if (mc) {
-#ifdef USE_GPIO
-        digitalWrite (mc->mp.step_pin, 0);
-        digitalWrite (mc->mp.step_pin, 1);
-        asm ("nop");
-        asm ("nop");
-        asm ("nop");
-        asm ("nop");
-        digitalWrite (mc->mp.step_pin, 0);
-#endif
-        if (mc->flag.dir)
-            mc->real_stepcount--;
+        if (BATCH_STEPS) {
+            if (batch)
+                mc->ctrl->batch_mask |= mc->step_mask;
+            else
+                gpio_mem_pulse (mc->step_mask, pulse_ns);
+        } else {
+            gpio_write (mc->mp.step_pin, 0);
+            gpio_write (mc->mp.step_pin, 1);
+            asm ("nop");
+            asm ("nop");
+            asm ("nop");
+            asm ("nop");
+            gpio_write (mc->mp.step_pin, 0);
+        }
+        if (mc->flag.dir)                   /* coarse microstep: 1 << shift steps */
+            mc->real_stepcount -= 1 << mc->ms.shift;
         else 
-            mc->real_stepcount++;
+            mc->real_stepcount += 1 << mc->ms.shift;
             
     } else return (EXIT_FAILURE);
     
     return EXIT_SUCCESS;
 }
+/*! --------------------------------------------------------------------
+ * @brief  copy of the state for mot_snapshot(). Only the driver thread 
+ *          (or the API without thread) writes, it never waits.
+ *          used after every step and every change of the mode
+ */
+static void state_publish (struct _mot_ctl_ *mc)
+{
+    struct _mot_snapshot_ *s = &mc->snap;
+    
+    seqlock_write_begin (&mc->snap_lock);
+    s->mode = mc->mode;
+    s->aktiv = mc->flag.aktiv;
+    s->dir = mc->flag.dir;
+    s->enable = mc->flag.enable;
+    s->ms_shift = mc->ms.shift;
+    s->position = mc->real_stepcount;
+    s->stepcount = mc->current_stepcount;
+    s->num_rest = mc->num_rest;
+    s->runtime = mc->runtime;
+    s->t = mc->step_time;
+    s->steptime = mc->current_steptime;
+    s->omega = mc->current_omega;
+    s->alpha = mc->current_alpha;
+    s->latency = mc->latency;
+    s->max_latency = mc->max_latency;
+    s->overruns = mc->overruns;
+    s->lost_time = mc->lost_time / 1000;
+    s->seq++;
+    seqlock_write_end (&mc->snap_lock);
+}
 /*! --------------------------------------------------------------------
  * @brief  used by mot_run()
+ *          The next deadline starts from the deadline of this step. If the
+ *          step is later than one steptime (the thread was stalled), it
+ *          starts from now: the overdue steps don't follow without spacing.
+ *          The skipped time is counted in overruns and lost_time.
+ * @param  now = current time [ns]
  */
-static int64_t execute_step (struct _mot_ctl_ *mc, uint64_t timediff)
+static void execute_step (struct _mot_ctl_ *mc, uint64_t now)
 {
-    uint64_t latency;
+    uint32_t n = 1u << mc->ms.shift;    /* steps of the pulse */
     
-    gettimeofday (&mc->start, NULL);    /* set new time */   
-    mot_step (mc);                      /* Execute step */
-    mc->current_stepcount++;            /* Increase step counter */
-    mc->runtime = (uint64_t) difference_micro (&mc->run_start, &mc->stop); 
+    mot_step (mc, 1);                   /* Execute step */
+    mc->current_stepcount += n;         /* Increase step counter */
+    mc->step_time = mc->deadline;
+    mc->runtime = (now - mc->run_start) / 1000;   
 
-    if ((latency = timediff - mc->current_steptime) > mc->max_latency)    /* check max latency */
-        mc->max_latency = latency;   
+    mc->latency = (int64_t)(now - mc->deadline);
+    if (!mc->lead && (mc->latency > (int64_t)mc->current_steptime * 1000)) {   /* a follower keeps the time of its lead */
+        mc->step_time = now;
+        mc->overruns++;
+        mc->lost_time += (uint64_t)mc->latency;
+    }
+    mc->sum_latency += mc->latency;
+    if (mc->latency / 1000 > (int64_t)mc->max_latency)    /* check max latency */
+        mc->max_latency = mc->latency / 1000;   
+    
+    seqlock_write_begin (&mc->hist_lock);
+    if (mc->latency >= 0)
+        mot_hist_add (&mc->hist_late, (uint64_t)mc->latency);
+    else
+        mot_hist_add (&mc->hist_early, (uint64_t)(-mc->latency));
+    seqlock_write_end (&mc->hist_lock);
         
-    if ((!mc->flag.endless) || 
-        (mc->flag.endless && (mc->mode == MOT_RUN_SPEED_DOWN))) {   /* check step counter */
-            
-        if (!(--mc->num_rest)) 
-            mc->mode = MOT_JOB_READY;
+    mc->num_rest = (mc->num_rest > n) ? mc->num_rest - n : 0;
+    state_publish (mc);
+}
+/*! --------------------------------------------------------------------
+ * @brief  automatic microstep switching. Coarse above omega_coarse, if the
+ *          position is a coarse step and the next 1 << shift steps have 
+ *          the same direction. Fine below omega_fine and at a change of 
+ *          direction or the end of the job.
+ *          The step unit stays the fine microstep, so real_stepcount, 
+ *          num_steps and the motion diagrams don't change.
+ *          used by set_deadline()
+ * @return  time until the next pulse [us]
+ */
+static uint32_t ms_policy (struct _mot_ctl_ *mc, struct _step_entry_ *e)
+{
+    uint8_t shift = mc->ms.fine - mc->ms.coarse;
+    uint32_t n = 1u << shift;
+    float w = fabsf (e->omega);
+    uint32_t us;
+    
+    if (!mc->ms.shift) {
+        if ((w < mc->ms.omega_coarse) || (mc->real_stepcount & (n - 1)) ||    /* slow or between two coarse steps */
+            (step_table_group (mc, n, &us) < n))
+            return e->steptime;
+        ms_select (mc, shift);
+        return us;
+    }
+    
+    if ((w >= mc->ms.omega_fine) && (step_table_group (mc, n, &us) == n))
+        return us;
+    ms_select (mc, 0);
+    
+    return e->steptime;
+}
+/*! --------------------------------------------------------------------
+ * @brief  set the deadline of the next step from the step table
+ *          used by mot_run()
+ */
+static void set_deadline (struct _mot_ctl_ *mc)
+{
+    struct _step_entry_ *e;
+    uint32_t us;
+    
+    if ((e = step_table_peek (mc)) == NULL) {
+        mc->mode = MOT_JOB_READY;           /* end of job */
+        return;
+    }
+    us = e->steptime;
+    if ((mc->ms.coarse != mc->ms.fine) && !mc->follow)     /* a linear move runs fine */
+        us = ms_policy (mc, e);
+    mc->deadline = mc->step_time + (uint64_t)us * 1000;
+}
+/*! --------------------------------------------------------------------
+ * @brief  mot_stop() and mot_fast_stop() are executed in the driver thread.
+ *          used by execute_cmd()
+ * @param  cmd = MOT_CMD_STOP or MOT_CMD_FAST_STOP
+ */
+static void handle_stop (struct _mot_ctl_ *mc, uint8_t cmd)
+{
+    if ((mc->mode == MOT_IDLE) || (mc->mode == MOT_JOB_READY))
+        return;
+
+    if (cmd == MOT_CMD_STOP) {
+        step_table_stop (mc);               /* recompile with speed-down */
+        mc->num_rest = mc->st.gen.rest;
+        set_deadline (mc);
+    }
+    else 
+        mc->mode = MOT_JOB_READY;
+}
+/*! --------------------------------------------------------------------
+ * @brief  min-heap of the running motors of a controller, sorted by the 
+ *          deadline of the next step. heap[0] is the next motor to step.
+ *          Only the driver thread of the controller works on the heap.
+ */
+static inline void heap_set (struct _heap_node_ *heap, int i, struct _heap_node_ node)
+{
+    heap[i] = node;
+    node.mc->heap_pos = i;
+}
+
+static void heap_up (struct _heap_node_ *heap, int i)
+{
+    struct _heap_node_ node = heap[i];
+    
+    while ((i > 0) && (node.deadline < heap[(i-1)/2].deadline)) {
+        heap_set (heap, i, heap[(i-1)/2]);
+        i = (i-1)/2;
+    }
+    heap_set (heap, i, node);
+}
+
+static void heap_down (struct _mot_ctrl_ *ctrl, int i)
+{
+    struct _heap_node_ *heap = ctrl->heap;
+    struct _heap_node_ node = heap[i];
+    int c;
+    
+    while ((c = 2*i+1) < ctrl->heap_count) {
+        if ((c+1 < ctrl->heap_count) && (heap[c+1].deadline < heap[c].deadline)) 
+            c++;
+        if (heap[c].deadline >= node.deadline) 
+            break;
+        heap_set (heap, i, heap[c]);
+        i = c;
+    }
+    heap_set (heap, i, node);
+}
+/*! --------------------------------------------------------------------
+ * @brief  mc->deadline has changed
+ */
+static void heap_update (struct _mot_ctl_ *mc)
+{
+    int i = mc->heap_pos;
+    
+    if (i < 0)
+        return;
+    
+    mc->ctrl->heap[i].deadline = mc->deadline;
+    heap_up (mc->ctrl->heap, i);
+    heap_down (mc->ctrl, mc->heap_pos);
+}
+
+static void heap_insert (struct _mot_ctl_ *mc)
+{
+    struct _mot_ctrl_ *c = mc->ctrl;
+    
+    if ((mc->heap_pos >= 0) || (c->heap_count >= MOT_MAX))
+        return;
+    
+    heap_set (c->heap, c->heap_count, (struct _heap_node_){ mc->deadline, mc });
+    heap_up (c->heap, c->heap_count++);
+}
+
+static void heap_remove (struct _mot_ctl_ *mc)
+{
+    struct _mot_ctrl_ *c = mc->ctrl;
+    int i = mc->heap_pos;
+    
+    if (i < 0)
+        return;
+    
+    mc->heap_pos = -1;
+    if (i != --c->heap_count) {
+        struct _mot_ctl_ *last = c->heap[c->heap_count].mc;
+        heap_set (c->heap, i, c->heap[c->heap_count]);
+        heap_up (c->heap, i);
+        heap_down (c, last->heap_pos);
+    }
+}
+/*! --------------------------------------------------------------------
+ * @brief  The first steps are compiled and the motor is put into the heap.
+ *          used by execute_cmd()
+ * @param  now = current time [ns]
+ */
+static void job_start (struct _mot_ctl_ *mc, uint64_t now)
+{
+    mc->max_latency = 0;
+    mc->latency = 0;
+    mc->sum_latency = 0;
+    mc->overruns = 0;
+    mc->lost_time = 0;
+    mc->current_stepcount = 0;              /* Current number of steps = 0 */
+    mc->num_rest = ((mc->mode == MOT_START_RUN) && (mc->num_steps > 0) && !mc->flag.queue) ? mc->num_steps : 0;
+    step_table_start (mc);                  /* compile the first steps */
+    mc->run_start = mc->step_time = now;    /* memory start time */    
+    mc->mode = (mc->mc_mp) ? MOT_RUN_MD : MOT_RUN;
+    set_deadline (mc);
+    if (mc->mode != MOT_JOB_READY)
+        heap_insert (mc);
+    state_publish (mc);
+}
+/*! --------------------------------------------------------------------
+ * @brief  end of job. The motor is removed from the heap.
+ *          The followers of a linear move end with their lead.
+ */
+static void job_ready (struct _mot_ctl_ *mc)
+{
+    struct _mot_ctl_ *f;
+    
+    while ((f = mc->follow) != NULL) {
+        mc->follow = f->next_follow;
+        f->lead = f->next_follow = NULL;
+        job_ready (f);
+    }
+    heap_remove (mc);
+    if (mc->ms.shift)                       /* mot_on_step() and the next job start fine */
+        ms_select (mc, 0);
+    mc->mode = MOT_IDLE;
+    mc->mc_mp = NULL;
+    mc->flag.aktiv = 0;
+    mc->flag.queue = 0;
+    state_publish (mc);
+    mot_job_notify (mc);                    /* mot_wait_job(), eventfd, callback */
+    if (offline)                            /* no report, see: mot_run_offline() */
+        return;
+    
+    struct _mot_ctrl_ *c = mc->ctrl;
+    uint64_t now = monotonic_ns ();
+    
+    if (now - c->report_t < (uint64_t)MOT_REPORT_MS * 1000000ull) {    /* short jobs don't flood the log */
+        c->report_skip++;
+        return;
+    }
+    c->report_t = now;
+    if (c->report_skip) {
+        rt_log ("-- %u jobs without report\n", c->report_skip);
+        c->report_skip = 0;
+    }
+    rt_log ("-- max_latency=%lli us  current_stepcount=%llu  runtime=%lli us   real_stepcout=%lli\n", 
+             (long long int) mc->max_latency, 
+             (long long unsigned) mc->current_stepcount, 
+             (long long int) mc->runtime,
+             (long long int) mc->real_stepcount);
+}
+/*! --------------------------------------------------------------------
+ * @brief  linear move: the follower is removed from the list of its lead
+ */
+static void line_detach (struct _mot_ctl_ *mc)
+{
+    struct _mot_ctl_ **f = &mc->lead->follow;
+    
+    while (*f != mc)
+        f = &(*f)->next_follow;
+    *f = mc->next_follow;
+    mc->lead = mc->next_follow = NULL;
+}
+/*! --------------------------------------------------------------------
+ * @brief  linear move. The motor with the most steps (lead) runs a 
+ *          normal ramp job. The other motors (followers) are not in the 
+ *          heap, they are stepped by the lead. see: step_followers()
+ *          used by execute_cmd()
+ * @param  now = current time [ns]
+ */
+static int line_start (const struct _mot_line_ *l, uint64_t now)
+{
+    struct _mot_ctl_ *mc, *lead = NULL;
+    uint64_t steps, max = 0;
+    int i, k;
+    
+    if (!l->n || (l->n > MOT_LINE_AXES))
+        return EXIT_FAILURE;
+    
+    for (i = 0; i < l->n; i++) {
+        if (!l->mc[i] || (l->mc[i]->mode != MOT_IDLE))
+            return EXIT_FAILURE;
+        for (k = 0; k < i; k++) {
+            if (l->mc[k] == l->mc[i])           /* motor is used twice */
+                return EXIT_FAILURE;
+        }
+        steps = (l->steps[i] < 0) ? (uint64_t)-l->steps[i] : (uint64_t)l->steps[i];
+        if (steps > max) {
+            max = steps;
+            lead = l->mc[i];
+        }
+    }
+    if (!lead)                                  /* no steps */
+        return EXIT_SUCCESS;
+    
+    for (i = 0; i < l->n; i++) {
+        mc = l->mc[i];
+        if (!(steps = (l->steps[i] < 0) ? (uint64_t)-l->steps[i] : (uint64_t)l->steps[i]))
+            continue;
+        set_enable (mc, 0);                     /* switch motor ON */
+        set_dir (mc, (l->steps[i] < 0) ? MOT_CCW : MOT_CW);
+        mc->flag.endless = 0;
+        mc->flag.aktiv = 1;
+        mc->mc_mp = NULL;
+        mc->dda_steps = steps;
+        if (mc == lead)
+            continue;
+        
+        mc->dda_err = max / 2;                  /* the steps of the follower are centred between the steps of the lead */
+        mc->lead = lead;
+        mc->next_follow = lead->follow;
+        lead->follow = mc;
+        mc->max_latency = 0;
+        mc->latency = 0;
+        mc->sum_latency = 0;
+        mc->overruns = 0;
+        mc->lost_time = 0;
+        mc->current_stepcount = 0;
+        mc->num_steps = mc->num_rest = steps;
+        mc->run_start = mc->step_time = now;
+        mc->mode = MOT_RUN;
+        state_publish (mc);
+    }
+    
+    lead->steptime = l->steptime;
+    lead->omega = calc_omega (lead->steps_per_turn, lead->steptime);
+    lead->num_steps = max;
+    lead->a_start = l->a_start;
+    lead->a_stop = l->a_stop;
+    lead->jerk = 0.0;
+    lead->mode = MOT_START_RUN;
+    job_start (lead, now);
+    if (lead->mode == MOT_JOB_READY)
+        job_ready (lead);
+    
+    return EXIT_SUCCESS;
+}
+/*! --------------------------------------------------------------------
+ * @brief  look-ahead planner of the move queue. Sets the exit speed of 
+ *          every move, that is not compiled. The move, that is compiled 
+ *          at the moment, starts with the compiled speed.
+ *          backward: the exit speed of the last move is zero. The entry 
+ *                    speed of a move is limited by its cruise speed and 
+ *                    by the speed-down to its exit speed. The junction 
+ *                    speed of two moves is the lower cruise speed, zero 
+ *                    at a change of direction.
+ *          forward:  the exit speed is limited by the speed-up from the 
+ *                    entry speed.
+ *          used by queue_append()
+ */
+#define QUEUE_MOVE(mc, i) (&(mc)->queue[(i) & (MOT_QUEUE_SIZE - 1)])
+
+static void queue_plan (struct _mot_ctl_ *mc)
+{
+    struct _step_gen_ *g = &mc->st.gen;
+    struct _mot_move_ *mv, *prev;
+    uint8_t running = mc->flag.queue && (g->mv == QUEUE_MOVE (mc, mc->q_out));   /* first move is compiled */
+    uint64_t steps;
+    double w = 0.0;
+    uint32_t i;
+
+    if (mc->q_in == mc->q_out)
+        return;
+
+    for (i = mc->q_in - 1; ; i--) {                     /* backward */
+        mv = QUEUE_MOVE (mc, i);
+        mv->exit = w;
+        steps = ((i == mc->q_out) && running) ? g->rest : mv->steps;
+        w = (mv->a_stop > 0.0) ? sqrt (w * w + 2.0 * mv->a_stop * mc->phi_per_step * (double)steps) : mv->omega;
+        if (w > mv->omega)
+            w = mv->omega;
+        if (i == mc->q_out)
+            break;
+        prev = QUEUE_MOVE (mc, i - 1);
+        if (prev->dir != mv->dir)                       /* change of direction */
+            w = 0.0;
+        else if (w > prev->omega)
+            w = prev->omega;
+    }
+
+    w = (running) ? g->omega : 0.0;
+    for (i = mc->q_out; i != mc->q_in; i++) {           /* forward */
+        mv = QUEUE_MOVE (mc, i);
+        steps = ((i == mc->q_out) && running) ? g->rest : mv->steps;
+        if (mv->a_start > 0.0) {
+            w = sqrt (w * w + 2.0 * mv->a_start * mc->phi_per_step * (double)steps);
+            if (mv->exit > w)
+                mv->exit = w;
+        }
+        w = mv->exit;
+    }
+}
+/*! --------------------------------------------------------------------
+ * @brief  the motor runs the move queue
+ * @param  now = current time [ns]
+ */
+static void queue_start (struct _mot_ctl_ *mc, uint64_t now)
+{
+    set_enable (mc, 0);                         /* switch motor ON */
+    mc->mc_mp = NULL;
+    mc->flag.aktiv = 1;
+    mc->flag.queue = 1;
+    mc->flag.endless = 0;
+    mc->mode = MOT_START_RUN;
+    job_start (mc, now);
+    if (mc->mode == MOT_JOB_READY)
+        job_ready (mc);
+}
+/*! --------------------------------------------------------------------
+ * @brief  MOT_CMD_QUEUE: the move is appended and the queue is planned
+ *          again. An idle motor starts.
+ *          A motor with an other job drops the move.
+ * @param  now = current time [ns]
+ */
+static int queue_append (struct _mot_ctl_ *mc, struct _mot_cmd_ *cmd, uint64_t now)
+{
+    struct _mot_move_ *mv;
+
+    if ((mc->mode != MOT_IDLE) && !mc->flag.queue) {
+        mc->q_in++;
+        __atomic_store_n (&mc->q_out, mc->q_out + 1, __ATOMIC_RELEASE);
+        rt_log ("-- move dropped. The motor runs an other job\n");
+        return EXIT_FAILURE;
+    }
+
+    mv = QUEUE_MOVE (mc, mc->q_in);
+    mv->dir = cmd->value;
+    mv->steps = cmd->num_steps;
+    mv->omega = calc_omega (mc->steps_per_turn, cmd->steptime);
+    mv->a_start = cmd->a_start;
+    mv->a_stop = cmd->a_stop;
+    mv->exit = 0.0;
+    mc->q_in++;
+    queue_plan (mc);
+
+    if (mc->mode == MOT_IDLE)
+        queue_start (mc, now);
+
+    return EXIT_SUCCESS;
+}
+/*! --------------------------------------------------------------------
+ * @brief  the motor list of a controller is only changed by its driver thread
+ */
+static void list_insert (struct _mot_ctl_ *mc)
+{
+    struct _mot_ctrl_ *c = mc->ctrl;
+    
+    mc->next = mc->prev = NULL;
+    if (c->first_mc == NULL) {
+        c->first_mc = c->last_mc = mc;
+    } else {
+        c->last_mc->next = mc;
+        mc->prev = c->last_mc;
+        c->last_mc = mc;
+    }
+}
+
+static void list_remove (struct _mot_ctl_ *mc)
+{
+    struct _mot_ctrl_ *c = mc->ctrl;
+    
+    if (mc->next != NULL) mc->next->prev = mc->prev;
+    if (mc->prev != NULL) mc->prev->next = mc->next;
+    if (mc == c->first_mc) c->first_mc = mc->next;
+    if (mc == c->last_mc) c->last_mc = mc->prev;
+}
+/*! --------------------------------------------------------------------
+ * @brief  execute a command in the driver thread of controller c
+ * @param  now = current time [ns]
+ * @return  result of the command
+ */
+static int execute_cmd (struct _mot_ctrl_ *c, struct _mot_cmd_ *cmd, uint64_t now)
+{
+    struct _mot_ctl_ *mc = cmd->mc;
+
+    switch (cmd->cmd) {
+        case MOT_CMD_ADD:
+            if (c->mot_count >= MOT_MAX)
+                return EXIT_FAILURE;
+            list_insert (mc);
+            __atomic_store_n (&c->mot_count, c->mot_count + 1, __ATOMIC_RELEASE);
+            break;
+
+        case MOT_CMD_REMOVE:
+            if (mc->lead)                           /* follower of a linear move */
+                line_detach (mc);
+            __atomic_store_n (&mc->q_out, mc->q_in, __ATOMIC_RELEASE);     /* drop the move queue */
+            __atomic_store_n (&mc->job_cb, NULL, __ATOMIC_RELEASE);     /* no callback with a removed motor */
+            if (mc->mode != MOT_IDLE) {
+                mc->mode = MOT_JOB_READY;
+                job_ready (mc);
+            }
+            list_remove (mc);
+            __atomic_store_n (&c->mot_count, c->mot_count - 1, __ATOMIC_RELEASE);
+            break;
+
+        case MOT_CMD_LIST: {
+                struct _mot_ctl_ *m;
+                int n = 0;
+                
+                for (m = c->first_mc; m; m = m->next)
+                    cmd->list[n++] = m;
+                return n;                   /* number of motors, not EXIT_SUCCESS */
+            }
+
+        case MOT_CMD_START:
+        case MOT_CMD_START_MD:
+            if ((mc->mode != MOT_IDLE) || ((cmd->cmd == MOT_CMD_START) && (mc->num_steps < 0)))
+                return EXIT_FAILURE;
+            set_enable (mc, 0);                     /* switch motor ON */
+            if (cmd->cmd == MOT_CMD_START_MD) {
+                mc->mc_mp = cmd->mp;                /* set first moition-point */
+                mc->current_omega = cmd->mp->omega;
+                mc->mode = MOT_START_MD;
+            } else {
+                mc->mc_mp = NULL;                   /* no motion diagram */
+                mc->mode = MOT_START_RUN;
+            }
+            mc->flag.aktiv = 1;
+            job_start (mc, now);
+            if (mc->mode == MOT_JOB_READY)
+                job_ready (mc);
+            break;
+
+        case MOT_CMD_STOP:
+        case MOT_CMD_FAST_STOP:
+            if (mc->lead)                           /* a linear move is stopped by its lead */
+                mc = mc->lead;
+            if (cmd->cmd == MOT_CMD_FAST_STOP)      /* drop the move queue */
+                __atomic_store_n (&mc->q_out, mc->q_in, __ATOMIC_RELEASE);
+            handle_stop (mc, cmd->cmd);
+            if (mc->mode == MOT_JOB_READY)
+                job_ready (mc);
+            else
+                heap_update (mc);                   /* new deadline */
+            break;
+
+        case MOT_CMD_PARAM:
+            set_dir (mc, cmd->value);
+            mc->num_steps = mc->num_rest = cmd->num_steps;
+            mc->flag.endless = (cmd->num_steps == 0) ? 1 : 0;
+            mc->max_latency = 0;
+            mc->a_start = cmd->a_start;
+            mc->a_stop = cmd->a_stop;
+            mc->jerk = cmd->jerk;
+            break;
+
+        case MOT_CMD_STEPTIME:
+            if (cmd->steptime == mc->steptime)
+                break;
+            mc->steptime = cmd->steptime;
+            mc->omega = calc_omega (mc->steps_per_turn, mc->steptime);   /* no log, may be set before every job */
+            break;
+
+        case MOT_CMD_STEP:
+            if (mc->mode != MOT_IDLE) 
+                return EXIT_FAILURE;
+            set_enable (mc, 0);
+            set_dir (mc, cmd->value);
+            mot_step (mc, 0);                       /* Execute step */
+            break;
+
+        case MOT_CMD_ENABLE:
+            set_enable (mc, cmd->value);
+            break;
+
+        case MOT_CMD_DIR:
+            set_dir (mc, cmd->value);
+            break;
+
+        case MOT_CMD_HIST_RESET:
+            if (mc) {
+                seqlock_write_begin (&mc->hist_lock);
+                memset (&mc->hist_late, 0, sizeof(struct _mot_hist_));
+                memset (&mc->hist_early, 0, sizeof(struct _mot_hist_));
+                seqlock_write_end (&mc->hist_lock);
+            } else {
+                seqlock_write_begin (&c->loop_hist_lock);
+                memset (&c->loop_hist, 0, sizeof(struct _mot_hist_));
+                seqlock_write_end (&c->loop_hist_lock);
+            }
+            break;
+
+        case MOT_CMD_LINE:
+            return line_start (cmd->line, now);
+
+        case MOT_CMD_QUEUE:
+            return queue_append (mc, cmd, now);
+
+        case MOT_CMD_MICROSTEP:
+            if (mc->mode != MOT_IDLE) 
+                return EXIT_FAILURE;
+            if (cmd->pin)
+                memcpy (mc->mp.ms_pin, cmd->pin->ms_pin, sizeof(mc->mp.ms_pin));
+            if (cmd->ms) {
+                mc->ms.fine = cmd->ms->fine;
+                mc->ms.coarse = cmd->ms->coarse;
+                mc->ms.omega_coarse = cmd->ms->omega_coarse;
+                mc->ms.omega_fine = cmd->ms->omega_fine;
+            }
+            ms_select (mc, 0);                      /* fine */
+            break;
+
+        case MOT_CMD_SYNC:
+            break;
+
+        case MOT_CMD_CALLBACK:
+            __atomic_store_n (&mc->job_arg, cmd->arg, __ATOMIC_RELAXED);
+            __atomic_store_n (&mc->job_cb, cmd->cb, __ATOMIC_RELEASE);     /* after the argument, see: mot_job_notify() */
+            break;
+
+        default:
+            return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+/*! --------------------------------------------------------------------
+ * @brief  command ring of a controller. Several producers (the threads, 
+ *          that call the API, also the callbacks of mot_notify.c) and a 
+ *          single consumer (the driver thread). cmd_head is only written 
+ *          under cmd_lock, cmd_tail only by the consumer. cmd_tail is also 
+ *          the number of executed commands; the result of a command stays 
+ *          in its slot until the slot is used again.
+ *          All posted commands are executed. 
+ *          used by run_A4988() at the begin of a loop pass and by the 
+ *          API, if the driver thread is not running (see: api_commands()).
+ * @return  number of executed commands
+ */
+static int process_commands (struct _mot_ctrl_ *c, uint64_t now)
+{
+    uint32_t tail = c->cmd_tail;
+    struct _mot_cmd_ *cmd;
+    int n = 0;
+
+    while (tail != __atomic_load_n (&c->cmd_head, __ATOMIC_ACQUIRE)) {
+        cmd = &c->cmd_ring[tail & (MOT_CMD_SIZE - 1)];
+        if (cmd->result)                    /* the API waits, see: cmd_call() */
+            *cmd->result = execute_cmd (c, cmd, now);
+        else
+            execute_cmd (c, cmd, now);
+        if (cmd->mc)                        /* pins, parameter or mode changed */
+            state_publish (cmd->mc);
+        __atomic_store_n (&c->cmd_tail, ++tail, __ATOMIC_SEQ_CST);
+        n++;
+    }
+    if (n && __atomic_load_n (&c->tail_wait, __ATOMIC_SEQ_CST))   /* see: cmd_wait() */
+        futex_wake (&c->cmd_tail, INT32_MAX);
+
+    return n;
+}
+/*! --------------------------------------------------------------------
+ * @brief  time of the commands, that are executed by the API 
+ *          (driver thread is not running)
+ */
+static inline uint64_t api_now (void)
+{
+    return (offline) ? offline_now : monotonic_ns ();
+}
+/*! --------------------------------------------------------------------
+ * @brief  driver thread: sleeps until a command is posted or until the
+ *          time t. The futex is cmd_head: if cmd_post() writes cmd_head
+ *          before the thread sleeps, the kernel doesn't put the thread
+ *          to sleep. cmd_post() wakes the thread only if c->sleep is set.
+ * @param  t = CLOCK_MONOTONIC [ns]. 0 = until the next command
+ */
+static void wait_command (struct _mot_ctrl_ *c, uint64_t t)
+{
+    uint32_t tail = c->cmd_tail;
+    
+    __atomic_store_n (&c->sleep, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n (&c->cmd_head, __ATOMIC_SEQ_CST) == tail)
+        futex_wait (&c->cmd_head, tail, t);
+    __atomic_store_n (&c->sleep, 0, __ATOMIC_RELAXED);
+}
+/*! --------------------------------------------------------------------
+ * @brief  API side: executes the posted commands, if the controller has 
+ *          no driver thread. exec_lock makes the API threads a single 
+ *          consumer, see: mot_run_offline()
+ */
+static void api_commands (struct _mot_ctrl_ *c)
+{
+    pthread_mutex_lock (&c->exec_lock);
+    if (!c->state.run)
+        process_commands (c, api_now ());
+    pthread_mutex_unlock (&c->exec_lock);
+}
+/*! --------------------------------------------------------------------
+ * @brief  API side: the command is written to the ring. If the ring is 
+ *          full, the API waits. A sleeping driver thread is woken.
+ *          The caller holds cmd_lock.
+ * @return  sequence number for cmd_wait()
+ */
+static uint32_t cmd_put (struct _mot_ctrl_ *c, struct _mot_cmd_ *cmd)
+{
+    uint32_t head = c->cmd_head;
+
+    while (head - __atomic_load_n (&c->cmd_tail, __ATOMIC_ACQUIRE) >= MOT_CMD_SIZE) {   /* ring is full */
+        if (!c->state.run)
+            api_commands (c);
+        else
+            usleep (100);
+    }
+    c->cmd_ring[head & (MOT_CMD_SIZE - 1)] = *cmd;
+    __atomic_store_n (&c->cmd_head, head + 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n (&c->sleep, __ATOMIC_SEQ_CST))         /* see: wait_command() */
+        futex_wake (&c->cmd_head, 1);
+
+    return head + 1;
+}
+/*! --------------------------------------------------------------------
+ * @brief  API side: cmd_put() of any thread. The slot is reserved and 
+ *          published under the producer lock of the controller.
+ * @return  sequence number for cmd_wait()
+ */
+static uint32_t cmd_post (struct _mot_ctrl_ *c, struct _mot_cmd_ *cmd)
+{
+    uint32_t seq;
+
+    pthread_mutex_lock (&c->cmd_lock);
+    seq = cmd_put (c, cmd);
+    pthread_mutex_unlock (&c->cmd_lock);
+
+    return seq;
+}
+/*! --------------------------------------------------------------------
+ * @brief  API side: wait until the command seq is executed. The API 
+ *          sleeps on the futex cmd_tail, process_commands() wakes the 
+ *          waiting threads (tail_wait) after the executed commands.
+ */
+static void cmd_wait (struct _mot_ctrl_ *c, uint32_t seq)
+{
+    uint32_t tail;
+    
+    __atomic_add_fetch (&c->tail_wait, 1, __ATOMIC_SEQ_CST);
+    while ((int32_t)((tail = __atomic_load_n (&c->cmd_tail, __ATOMIC_SEQ_CST)) - seq) < 0) {
+        if (!c->state.run)
+            api_commands (c);
+        else
+            futex_wait (&c->cmd_tail, tail, 0);
+    }
+    __atomic_sub_fetch (&c->tail_wait, 1, __ATOMIC_RELAXED);
+}
+/*! --------------------------------------------------------------------
+ * @brief  API side: posts the command and waits for its result. The 
+ *          result is written into the stack of the caller, a slot of the
+ *          ring can be used again by other threads before cmd_wait() returns.
+ * @return  result of the command
+ */
+static int cmd_call (struct _mot_ctrl_ *c, struct _mot_cmd_ *cmd)
+{
+    int result = EXIT_FAILURE;
+
+    cmd->result = &result;
+    cmd_wait (c, cmd_post (c, cmd));
+
+    return result;
+}
+/*! --------------------------------------------------------------------
+ * @brief  linear move: the followers of a lead are stepped with a 
+ *          Bresenham accumulator, only integer additions per step.
+ *          The step of a follower has the deadline of the step of the lead.
+ *          used by mot_run()
+ * @param  now = current time [ns]
+ */
+static void step_followers (struct _mot_ctl_ *lead, uint64_t now)
+{
+    struct _mot_ctl_ *f;
+    
+    for (f = lead->follow; f; f = f->next_follow) {
+        f->dda_err += f->dda_steps;
+        if (f->dda_err >= lead->dda_steps) {
+            f->dda_err -= lead->dda_steps;
+            f->deadline = lead->step_time;
+            f->mode = lead->mode;
+            execute_step (f, now);
+        }
+    }
+}
+/*! --------------------------------------------------------------------
+ * @brief  used by driver thread run_A4988()
+ *          The step is read from the step table. see: step_table.c
+ *          The deadline of a step is the deadline of the last step plus 
+ *          the steptime, so the timing error does not accumulate.
+ * @param  now = current time [ns]
+ */
+static int mot_run (struct _mot_ctl_ *mc, uint64_t now)
+{
+    struct _step_entry_ *e = step_table_peek (mc);
+    uint32_t i;
+    
+    for (i = 1; i < (1u << mc->ms.shift); i++) {   /* coarse microstep: the pulse ends the group of steps */
+        mc->st.pos++;
+        e = step_table_peek (mc);
+    }
+    
+    if (e->dir != mc->flag.dir) {
+        set_dir (mc, e->dir);
+        mc->ctrl->batch_dir = 1;
+    }
+    mc->current_steptime = e->steptime;
+    mc->current_omega = e->omega;
+    mc->current_alpha = e->alpha;
+    mc->mode = e->mode;
+    if (e->mode == MOT_WAIT_MD) {           /* streaming motion diagram: the ring is empty */
+        mc->step_time = mc->deadline;
+        state_publish (mc);
+    } else
+        execute_step (mc, now);
+    if (mc->follow)
+        step_followers (mc, now);
+    mc->st.pos++;
+    set_deadline (mc);
+    
+    return EXIT_SUCCESS;
+}
+/*! --------------------------------------------------------------------
+ * @brief  loop pass of a controller: commands of the API, due steps and
+ *          compilation of the next steps.
+ *          used by run_A4988() and mot_run_offline()
+ * @param  now = current time [ns]
+ * @return  number of commands and steps
+ */
+static int driver_pass (struct _mot_ctrl_ *c, uint64_t now)
+{
+    struct _mot_ctl_ *mc;
+    struct _mot_ctl_ *fill[MOT_MAX];        /* motors with an empty back chunk */
+    int i, n = 0;
+    int work = process_commands (c, now);   /* commands of the API */
+    
+    while (c->heap_count && (c->heap[0].deadline <= now)) {     /* motors with due steps */
+        mc = c->heap[0].mc;
+        work++;
+        if (c->batch_mask & mc->step_mask)  /* second step of this motor in this pass */
+            flush_steps (c);
+        mot_run (mc, now);                
+        if (mc->mode == MOT_JOB_READY) {
+            job_ready (mc);
+            if (mc->q_out != mc->q_in)      /* moves appended after the end of compilation */
+                queue_start (mc, now);
+        }
+        else {
+            c->heap[0].deadline = mc->deadline;
+            heap_down (c, 0);
+            if (!mc->st.back_ready && (n < MOT_MAX))
+                fill[n++] = mc;
+        }
+    }
+    
+    flush_steps (c);                        /* step pulses of this pass */
+    
+    for (i = 0; i < n; i++)                 /* compile the next steps */
+        step_table_fill (fill[i]);
+    
+    mot_tele_pass (c, now);                 /* telemetry records, see: mot_telemetry.c */
+    
+    return work;
+}
+/*! --------------------------------------------------------------------
+ * @brief  driver thread of a controller
+ *          Only the motor at the top of the heap is checked. After the 
+ *          steps the thread sleeps until the next deadline (MOT_SCHED_SLEEP)
+ *          or polls the clock (MOT_SCHED_BUSY). Without running motors 
+ *          it sleeps until the next command. A command wakes the thread.
+ *          cpus and policy see: mot_thread.c
+ *          Messages are written with rt_log(), never with printf().
+ * @param  data = controller
+ */
+void *run_A4988 (void *data)
+{
+    struct _mot_ctrl_ *c = (struct _mot_ctrl_ *)data;
+    char name[24];
+    
+    snprintf (name, sizeof(name), "run_A4988 %u", c->id);
+    rt_log_thread (name);                       /* messages without lock and system call */
+    rt_log ("-- <run_A4988> %u is started\n", c->id);
+    
+    mot_thread_apply (c);                       /* cpus and policy, with fallback */
+    mot_rt_thread ();                           /* stack prefault. From now on no malloc, see: mot_rt.c */
+    c->state.ready = 1;
+    
+    uint64_t now;
+    int work;
+    
+    while (!c->state.kill) {                    /* thread main loop */
+        now = monotonic_ns ();
+        work = driver_pass (c, now);
+        
+        if (work) {                             /* duration of the loop pass */
+            seqlock_write_begin (&c->loop_hist_lock);
+            mot_hist_add (&c->loop_hist, monotonic_ns () - now);
+            seqlock_write_end (&c->loop_hist_lock);
+        }
+        
+        if (!c->heap_count) {                   /* idle: until the next command or telemetry record */
+            wait_command (c, c->tele_next);
+        } else if (sched_mode == MOT_SCHED_SLEEP) {     /* sleep until shortly before the deadline */
+            uint64_t wake = c->heap[0].deadline;
+            if (c->tele_next && (c->tele_next < wake))  /* telemetry records of slow motors */
+                wake = c->tele_next + sched_spin;
+            if (wake > monotonic_ns () + sched_spin) 
+                wait_command (c, wake - sched_spin);
+        }
+    }
+    if (c->report_skip)
+        rt_log ("-- %u jobs without report\n", c->report_skip);
+    rt_log ("-- <run_A4988> %u is stoped\n", c->id);    
+    c->state.run = 0;
+    
+    return EXIT_SUCCESS;
+}
+/*! --------------------------------------------------------------------
+ * @brief  gpio initialisation of the first controller
+ */
+static int gpio_setup (void)
+{
+    if (is_init)
+        return EXIT_SUCCESS;
+    
+    if ((gpio_select (gpio_access) != EXIT_SUCCESS) || (gpio_init () != EXIT_SUCCESS)) {
+        rt_log ("-- gpio initialisation failed !\n");
+        return EXIT_FAILURE;
+    }
+    is_init = 1;
+    
+    return EXIT_SUCCESS;
+}
+/*! --------------------------------------------------------------------
+ * @brief  A new controller: driver thread, motor list, command ring and 
+ *          heap. The motors of the controller are created with 
+ *          new_mot (ctrl, ...). Returns, when the thread has set its 
+ *          cpus and its policy.
+ *          After init_mot_offline() the controller has no thread.
+ * @param  cfg = cpus and policy of the thread. 
+ *          NULL = mot_set_thread_...(), config file and environment (see: mot_thread.c)
+ * @example 12 axes on the isolated cores 1, 2, 3:
+ *      struct _mot_thread_cfg_ cfg;
+ *      mot_thread_default (&cfg);
+ *      for (i = 0; i < 3; i++) {
+ *          sprintf (cfg.cpus, "%i", i + 1);
+ *          ctrl[i] = new_mot_ctrl (&cfg);
+ *          for (k = 0; k < 4; k++)
+ *              m[4*i + k] = new_mot (ctrl[i], pin_enable[4*i + k], ...);
+ *      }
+ */
+struct _mot_ctrl_ *new_mot_ctrl (const struct _mot_thread_cfg_ *cfg)
+{
+    static uint16_t ctrl_id = 0;
+    struct _mot_ctrl_ *c, **p;
+    
+    if (gpio_setup () != EXIT_SUCCESS)
+        return NULL;
+    
+    if ((c = (struct _mot_ctrl_ *) mot_rt_alloc (MOT_RT_CTRL)) == NULL) {
+        rt_log ("-- Can't create controller\n");
+        return NULL;
+    }
+    c->id = ++ctrl_id;
+    c->loop_hist_lock = (struct _seqlock_)SEQLOCK_INIT;
+    pthread_mutex_init (&c->cmd_lock, NULL);
+    pthread_mutex_init (&c->exec_lock, NULL);
+    if (cfg)
+        c->cfg = *cfg;
+    else
+        mot_thread_default (&c->cfg);
+    
+    if (!offline) {
+        pthread_attr_t attr;
+        int ret;
+        
+        rt_log_start (NULL);        /* messages of the driver threads, see: rt_log.h */
+        c->state.run = 1;           /* from now on the commands are executed by the driver thread */
+        pthread_attr_init (&attr);
+        mot_rt_thread_attr (&attr); /* stack of the real time safe mode, see: mot_rt.c */
+        ret = pthread_create (&c->thread, &attr, &run_A4988, c);
+        pthread_attr_destroy (&attr);
+        if (ret != 0) {
+            rt_log ("-- can't create the driver thread\n");
+            mot_rt_free (MOT_RT_CTRL, c);
+            return NULL;
+        }
+        while (!c->state.ready)
+            usleep (100);
+    }
+    
+    for (p = &first_ctrl; *p; p = &(*p)->next)
+        ;
+    *p = c;
+    
+    return c;
+}
+/*! --------------------------------------------------------------------
+ * @brief  kills the motors of the controller. used by kill_mot_ctrl() 
+ *          and kill_all_mot()
+ */
+static int kill_ctrl_mot (struct _mot_ctrl_ *c)
+{
+    struct _mot_ctl_ *list[MOT_MAX];
+    int i, n;
+    
+    while ((n = mot_list (c, list)) > 0) {
+        for (i = 0; i < n; i++) {
+            if (kill_mot (list[i]) != EXIT_SUCCESS) 
+                return EXIT_FAILURE;
+        }
+    }
+    
+    return EXIT_SUCCESS;
+}
+/*! --------------------------------------------------------------------
+ * @brief  The motors of the controller are killed, the driver thread ends.
+ * @param  ctrl = NULL: default controller
+ */
+int kill_mot_ctrl (struct _mot_ctrl_ *ctrl)
+{
+    struct _mot_ctrl_ **p;
+    
+    if (!ctrl && ((ctrl = default_ctrl) == NULL))
+        return EXIT_FAILURE;
+    
+    for (p = &first_ctrl; *p && (*p != ctrl); p = &(*p)->next)
+        ;
+    if (!*p)
+        return EXIT_FAILURE;
+    
+    if (kill_ctrl_mot (ctrl) != EXIT_SUCCESS) 
+        return EXIT_FAILURE;
+    
+    if (ctrl->state.run) {
+        ctrl->state.kill = 1;
+        cmd_post (ctrl, &(struct _mot_cmd_){ .cmd = MOT_CMD_SYNC });   /* wakes the idle thread */
+        pthread_join (ctrl->thread, NULL);
+    }
+    mot_notify_stop (ctrl);                 /* callback worker */
+    rt_log_flush ();                        /* the messages of the thread are written */
+    
+    *p = ctrl->next;
+    if (ctrl == default_ctrl)
+        default_ctrl = NULL;
+    pthread_mutex_destroy (&ctrl->cmd_lock);
+    pthread_mutex_destroy (&ctrl->exec_lock);
+    mot_rt_free (MOT_RT_CTRL, ctrl);
+    
+    return EXIT_SUCCESS;
+}
+/*! --------------------------------------------------------------------
+ * @brief  all controllers and motors. At the end of the program.
+ */
+int kill_all_mot_ctrl (void)
+{
+    while (first_ctrl) {
+        if (kill_mot_ctrl (first_ctrl) != EXIT_SUCCESS) 
+            return EXIT_FAILURE;
     }
     
-    return latency;
+    return EXIT_SUCCESS;
+}
+/*! --------------------------------------------------------------------
+ * @brief  waits until the driver thread has finished its loop pass.
+ *          Used, before data is freed, that the thread reads without 
+ *          a command (e.g. mot_tele_close()).
+ */
+int mot_ctrl_sync (struct _mot_ctrl_ *ctrl)
+{
+    if (!ctrl && ((ctrl = default_ctrl) == NULL))
+        return EXIT_FAILURE;
+    
+    return cmd_call (ctrl, &(struct _mot_cmd_){ .cmd = MOT_CMD_SYNC });
+}
+/*! --------------------------------------------------------------------
+ * @return  controller of init_mot_ctl() or NULL
+ */
+struct _mot_ctrl_ *mot_default_ctrl (void)
+{
+    return default_ctrl;
+}
+/*! --------------------------------------------------------------------
+ * @brief  Initializes the default controller, it is used by 
+ *          new_mot (NULL, ...). The cpus and the policy of the thread are 
+ *          taken from mot_set_thread_...(), the config file of A4988_CONFIG
+ *          and the environment (see: mot_thread.c).
+ */
+int init_mot_ctl()
+{    
+    if (!default_ctrl && ((default_ctrl = new_mot_ctrl (NULL)) == NULL))
+        return EXIT_FAILURE;
+    
+    return EXIT_SUCCESS;
 }
 /*! --------------------------------------------------------------------
- *  @brief  used by mot_run(). see: state MOT_RUN_MD
+ * @brief  Initializes the driver without thread. The commands of the API
+ *          are executed at once, the steps of all controllers are executed 
+ *          by mot_run_offline() with a virtual clock as fast as possible.
+ *          The default controller is created, new_mot_ctrl() creates 
+ *          controllers without thread.
+ *          The virtual clock starts at 0, so every run is reproducible.
+ *          With MOT_GPIO_SIM the pin changes are recorded with the virtual
+ *          clock: the step/dir timeline of the job (see: sim_md.c).
+ *          Used by benchmarks, e.g. with mot_set_gpio (MOT_GPIO_NULL, 0).
  */
-static inline void switch_dir (struct _mot_ctl_ *mc, double new_omega)
+int init_mot_offline (void)
 {
-    if (new_omega < 0.0) {
-        mot_set_dir (mc, MOT_CCW);
-    } else if (new_omega > 0.0) {
-        mot_set_dir (mc, MOT_CW);
+    if (first_ctrl && !offline) {
+        rt_log ("-- driver thread is running\n");
+        return EXIT_FAILURE;
     }
+    
+    offline = 1;
+    offline_now = 0;
+    if (gpio_setup () != EXIT_SUCCESS)
+        return EXIT_FAILURE;
+    if (gpio_access == MOT_GPIO_SIM)
+        gpio_sim_clock (mot_offline_now);
+    
+    return init_mot_ctl ();
 }
 /*! --------------------------------------------------------------------
- * @brief  used by driver thread run_A4988()
+ * @brief  The steps are executed without waiting: the virtual clock 
+ *          jumps to the next deadline of all controllers.
+ * @param  max_ns = virtual run time [ns]. 0 = until all motors are idle
+ * @return  EXIT_FAILURE = not initialized with init_mot_offline()
  */
-static int mot_run (struct _mot_ctl_ *mc)
+int mot_run_offline (uint64_t max_ns)
 {
-    uint64_t timediff;
-    static uint64_t latency; 
+    uint64_t end = offline_now + max_ns;
+    struct _mot_ctrl_ *c, *next;
     
-    switch (mc->mode) {        
-        case MOT_START_RUN:
-            mc->max_latency = 0;
-            mc->current_steptime = mc->steptime;
-            mc->num_rest = (mc->num_steps >= 0) ? mc->num_steps : 0;
-            mc->current_stepcount = 0;              /* Current number of steps = 0 */
-            mc->current_omega = 0.0;
-            latency = 0;
-            gettimeofday (&mc->start, NULL);        /* get start time */
-            mc->run_start = mc->start;              /* memory start time */    
-            mc->mode = (mc->a_start <= 0.0) ? MOT_RUN : MOT_SPEED_UP;            
-            break;
-            
-        case MOT_SPEED_UP:             
-            if (mc->num_steps && (mc->current_stepcount >= mc->num_steps)) mc->mode = MOT_JOB_READY;         /* target number of steps reached */
-            else {                
-                double current_phi = mc->phi_per_step * ((double)mc->current_stepcount);   /* current angle from acceleration */                
-                double new_omega = sqrt(2.0 * mc->a_start * (current_phi + mc->phi_per_step));
-                if (new_omega >= mc->omega) {                                               /* target speed reached */ 
-                    mc->current_steptime = mc->steptime;
-                    mc->current_omega = mc->omega; 
-                    mc->mode = MOT_RUN;                                                     /* constant speed */
-                } else {
-                    double t = 2.0 * mc->phi_per_step / (new_omega + mc->current_omega);    /* new time for step */
-                    mc->current_steptime = (int64_t) (t * 1000000.0);                       /* steptime in us */
-                    mc->current_omega = new_omega;
-                    mc->mode = MOT_RUN_SPEED_UP;
-                }
-            }
-            break;
-            
-        case MOT_RUN:
-        case MOT_RUN_SPEED_UP:
-        case MOT_RUN_SPEED_DOWN:
-        case MOT_RUN_SPEED_MD:
-            gettimeofday (&mc->stop, NULL); 
-            if ((timediff = (uint64_t)difference_micro (&mc->start, &mc->stop)) >= (mc->current_steptime - latency)) {    /* Execute step */
-                latency = execute_step (mc, timediff);                  
-                
-                if (((mc->mode == MOT_RUN) || (mc->mode == MOT_RUN_SPEED_UP)) && (mc->a_stop > 0.0)) {          /* See if you need to brake. */
-                    if (mc->num_steps != 0) {
-                        uint64_t rest_steps = calc_steps_for_step_down(mc);
-                        if (mc->num_rest <= rest_steps) {
-                            mc->mode = MOT_SPEED_DOWN;                            
-                        }
-                    }
-                }
-                
-                if (mc->mode == MOT_RUN_SPEED_UP) 
-                    mc->mode = MOT_SPEED_UP;
-                if (mc->mode == MOT_RUN_SPEED_DOWN) 
-                    mc->mode = MOT_SPEED_DOWN;
-                if (mc->mode == MOT_RUN_SPEED_MD)
-                    mc->mode = MOT_RUN_MD;
-            }
-            break;
-            
-        case MOT_SPEED_DOWN: 
-            if (mc->num_rest) {
-                double phi1 = (double)mc->num_rest * mc->phi_per_step;
-                double phi0 = phi1 - mc->phi_per_step;
-                double t1 = sqrt(phi1 * 2.0 / mc->a_stop);
-                double t0 = sqrt(phi0 * 2.0 / mc->a_stop);                
-                mc->current_steptime = (int64_t) ((t1 - t0) * 1000000.0);       /* steptime in us */
-                mc->current_omega = calc_omega (mc->steps_per_turn, mc->current_steptime);
-                mc->mode = MOT_RUN_SPEED_DOWN;
-            }
-            break;
-            
-        case MOT_RUN_MD: {                
-                if (mc->mc_mp->current_step >= mc->mc_mp->steps) {   /* end of MOT_RUN_MD */
-                    mc->mode = MOT_START_MD;                    
-                } else {                          
-                    double t;
-                    double new_omega;
-                    if (mc->mc_mp->a == 0.0) {                     /* omega const. */
-                        new_omega = mc->mc_mp->omega;                        
-                        switch_dir (mc, new_omega);                 /* inline function */
-                        
-                        t = mc->phi_per_step / new_omega;
-                    } else {                        
-                        double faktor = 1.0;                        /* CW */
-                        if ((mc->current_omega < 0.0) ||            /* CCW */
-                            ((mc->current_omega == 0.0) && (mc->mc_mp->a < 0.0))) {
-                            faktor = -1.0;   
-                        }
-                        new_omega = sqrt((mc->current_omega * mc->current_omega) + 2.0*(mc->mc_mp->a)*faktor*mc->phi_per_step) * faktor;
-                        switch_dir (mc, new_omega);                 /* inline function */
-                        
-                        t = (2.0 * faktor*mc->phi_per_step) / (mc->current_omega + new_omega);
-                    }                    
-                        
-                    mc->current_steptime = fabs(t) * 1000000.0;
-                    mc->current_omega = new_omega;                    
-                    latency = 0;
-                    
-                    gettimeofday (&mc->start, NULL);        
-                    mc->mode = MOT_RUN_SPEED_MD;
-                }
-                mc->mc_mp->current_step++;
-            }
-            break;
-        case MOT_START_MD: {                                 
-                mc->mc_mp = mc->mc_mp->next;       /* set the next motion-point in the struct _mot_ctl_ */
-                if (!mc->mc_mp) {
-                    mc->mode = MOT_JOB_READY;                    
-                } else {                          
-                    if (mc->mc_mp->delta_t != 0.0) {
-                        mc->mc_mp->current_step = 0;
-                        mc->current_omega = mc->mc_mp->prev->omega;
-                        mc->mode = MOT_RUN_MD;
-                    }
-                }                                
-            }
+    if (!offline)
+        return EXIT_FAILURE;
+    
+    for (c = first_ctrl; c; c = c->next) {
+        pthread_mutex_lock (&c->exec_lock);     /* posted commands, see: api_commands() */
+        driver_pass (c, offline_now);
+        pthread_mutex_unlock (&c->exec_lock);
+    }
+    
+    for (;;) {
+        for (c = first_ctrl, next = NULL; c; c = c->next) {
+            if (c->heap_count && (!next || (c->heap[0].deadline < next->heap[0].deadline)))
+                next = c;
+        }
+        if (!next)
             break;
-        case MOT_JOB_READY:             
-            mc->mode = MOT_IDLE;
-            mc->flag.aktiv = 0;
-            printf ("-- max_latency=%lli us  current_stepcount=%llu  runtime=%lli us   real_stepcout=%lli\n", 
-                     (long long int) mc->max_latency, 
-                     (long long unsigned) mc->current_stepcount, 
-                     (long long int) mc->runtime,
-                     (long long int) mc->real_stepcount);
+        if (max_ns && (next->heap[0].deadline > end)) {
+            offline_now = end;
             break;
-    }    
+        }
+        offline_now = next->heap[0].deadline;
+        pthread_mutex_lock (&next->exec_lock);
+        driver_pass (next, offline_now);
+        pthread_mutex_unlock (&next->exec_lock);
+    }
+    
+    for (c = first_ctrl; c; c = c->next)
+        mot_notify_pass (c);                    /* callbacks of the finished jobs */
+    
     return EXIT_SUCCESS;
 }
 /*! --------------------------------------------------------------------
- * @brief  driver thread
+ * @return  virtual clock of mot_run_offline() [ns]
  */
-
-#define USE_HIGH_PRIORITY
- 
-void *run_A4988 (void *data)
+uint64_t mot_offline_now (void)
 {
-    struct _mot_ctl_ *mc;
-
-    thread_state.kill = 0;
-    thread_state.run = 1;
-    printf ("-- <run_A4988> is started\n");
-    
-#ifdef USE_HIGH_PRIORITY
-    struct sched_param sp = { .sched_priority = 95 };       /* priority > 95 you need permitted ??? */       
-    if (sched_setscheduler(0, SCHED_FIFO, &sp) == -1) {     /* SCHED_FIFO  SCHED_RR   SCHED_OTHER  */
-        perror("sched_setscheduler");
-        return (NULL);
-    }
-    printSchedulingPolicy ();
-#endif
-    
-    uint8_t all_mot_idle;
-    
-    while (!thread_state.kill) {                /* thread main loop */
-        all_mot_idle = 1;
-        if (!thread_state.mc_closed) {            
-            mc = first_mc;
-            while (mc) {
-                if (mc->mode != MOT_IDLE) {
-                    mot_run (mc);                
-                    all_mot_idle = 0;                    
-                }
-                mc = mc->next;
-            }
-        }
-        
-        if (all_mot_idle) 
-            usleep (1000); 
+    return offline_now;
+}
+/*! --------------------------------------------------------------------
+ * @brief  select the gpio access. Must be called before init_mot_ctl().
+ * @param  gpio = see: enum MOT_GPIO
+ *          pulse_ns = width of the step pulse with MOT_GPIO_MEM [ns]. 
+ *                     The A4988 needs min. 1000 ns.
+ */
+int mot_set_gpio (uint8_t gpio, uint32_t pulse)
+{
+    if (gpio > MOT_GPIO_NULL)
+        return EXIT_FAILURE;
+    
+    if (is_init) {
+        rt_log ("-- gpio access can't be changed after init_mot_ctl()\n");
+        return EXIT_FAILURE;
     }
-    printf ("-- <run_A4988> is stoped\n");    
-    thread_state.run = 0;
+    
+    gpio_access = gpio;
+    pulse_ns = pulse;
     
     return EXIT_SUCCESS;
 }
 /*! --------------------------------------------------------------------
- * @brief  Initializes the driver thread
- */  
-#define USE_CORE_3_
-
-int init_mot_ctl()
-{    
-#ifdef USE_GPIO
-    if( wiringPiSetup() < 0) {
-        printf ("-- wiringPiSetup failed !\n");
+ * @brief  set the waiting strategy of the driver thread
+ * @param  mode = MOT_SCHED_BUSY or MOT_SCHED_SLEEP. see: enum MOT_SCHED_MODE
+ *          spin_us = time before a deadline, that is polled in MOT_SCHED_SLEEP mode [us]
+ */
+int mot_set_sched_mode (uint8_t mode, uint32_t spin_us)
+{
+    if ((mode != MOT_SCHED_BUSY) && (mode != MOT_SCHED_SLEEP))
         return EXIT_FAILURE;
-    } else printf ("-- wiringPi initialisiert\n");
-#endif
-    
-    if (!thread_A4988) {         /* glob thread handle */
-        thread_state.run = 0;
-        thread_state.kill = 0;
-        thread_state.mc_closed = 0;
-        pthread_create (&thread_A4988, NULL, &run_A4988, NULL);  /* starts measuring routine */
-        is_init = 1;
-        
-#ifdef USE_CORE_3        
-        int i;
-        cpu_set_t go_core;
-        
-        sleep (1);
-        CPU_ZERO(&go_core);			/* Initialize with 0 */
-        CPU_SET(3, &go_core);		/* enter Core 3 */
-        pthread_setaffinity_np(thread_A4988, sizeof(cpu_set_t), &go_core);		/* Assign a CPU core to the thread */
-        for (i = 0; i < CPU_SETSIZE; i++)
-            if (CPU_ISSET(i, &go_core))
-                printf("-- thread run_A4988() -> CPU = CPU %d\n", i);
-        sleep (1);
-#endif    
-    }
+    
+    sched_spin = (uint64_t)spin_us * 1000;
+    sched_mode = mode;
     
     return EXIT_SUCCESS;
 }
@@ -375,26 +1388,36 @@ void mot_initpins (struct _mot_ctl_ *mc)
     if (!mc) 
         return;
    
-#ifdef USE_GPIO
-    pinMode (mc->mp.enable_pin, OUTPUT);
-    pinMode (mc->mp.dir_pin, OUTPUT);
-    pinMode (mc->mp.step_pin, OUTPUT);
-#endif    
+    gpio_mode (mc->mp.enable_pin, GPIO_OUTPUT);
+    gpio_mode (mc->mp.dir_pin, GPIO_OUTPUT);
+    gpio_mode (mc->mp.step_pin, GPIO_OUTPUT);
 }
 /*! --------------------------------------------------------------------
  * @brief  create dynamic memory for motor parameter
+ * @param  ctrl = controller (driver thread) of the motor. NULL = default controller
  */ 
-struct _mot_ctl_ *new_mot (uint8_t pin_enable,
+struct _mot_ctl_ *new_mot (struct _mot_ctrl_ *ctrl,
+                             uint8_t pin_enable,
                              uint8_t pin_dir,
                              uint8_t pin_step,
                              uint32_t steps_per_turn)
 {
-    if (!is_init) 
+    static uint16_t mot_id = 0;
+    
+    if (!ctrl)
+        ctrl = default_ctrl;
+    if (!ctrl) 
         return NULL;
     
-    thread_state.mc_closed = 1;
+    if (__atomic_load_n (&ctrl->mot_count, __ATOMIC_ACQUIRE) >= MOT_MAX) {   /* checked again by MOT_CMD_ADD */
+        rt_log ("-- Can't create motor. Max. %i motors per controller\n", MOT_MAX);
+        return NULL;
+    }
     
-    struct _mot_ctl_ *mc = (struct _mot_ctl_ *) malloc (sizeof(struct _mot_ctl_));
+    struct _mot_ctl_ *mc = (struct _mot_ctl_ *) mot_rt_alloc (MOT_RT_MOT);
+    if (mc == NULL)
+        return NULL;
+    mc->id = __atomic_add_fetch (&mot_id, 1, __ATOMIC_RELAXED);
     mc->mode = MOT_IDLE;
     mc->flag.aktiv = 0;
     mc->flag.endless = 0;
@@ -402,14 +1425,15 @@ struct _mot_ctl_ *new_mot (uint8_t pin_enable,
     mc->mp.enable_pin = pin_enable;
     mc->mp.dir_pin = pin_dir;
     mc->mp.step_pin = pin_step;
+    mc->mp.ms_pin[0] = mc->mp.ms_pin[1] = mc->mp.ms_pin[2] = MOT_MS_PIN_NC;
+    mc->step_mask = gpio_mem_mask (pin_step);
+    mc->ms = (struct _mot_ms_){ .fine = MOT_MS_HALF, .coarse = MOT_MS_HALF };   /* MS pins hard wired, see: readme.txt */
     
     mot_initpins (mc);
         
-    mot_disenable (mc);                     /* flag enable is updated */
-    mot_set_dir (mc, MOT_CW);               /* flag dir is updated */
-#ifdef USE_GPIO
-    digitalWrite (mc->mp.step_pin, 0);
-#endif
+    set_enable (mc, 1);                     /* flag enable is updated */
+    set_dir (mc, MOT_CW);                   /* flag dir is updated */
+    gpio_write (mc->mp.step_pin, 0);
     
     mc->steps_per_turn = steps_per_turn;  
     mc->real_stepcount = 0; 
@@ -422,19 +1446,39 @@ struct _mot_ctl_ *new_mot (uint8_t pin_enable,
     mc->steptime = 2000;                                        /* steptime in us. Default 2ms */
     mc->omega = calc_omega (mc->steps_per_turn, mc->steptime);
     mc->a_start = mc->a_stop = 0.0;                             /* speed-up, speed-down */
+    mc->jerk = 0.0;                                             /* constant acceleration ramps */
     
     mc->mc_mp = NULL;                       /* moition point; for define use function mot_start_md()  */
+    mc->heap_pos = -1;
+    mc->lead = mc->follow = mc->next_follow = NULL;
+    mc->dda_steps = mc->dda_err = 0;
+    mc->flag.queue = 0;
+    mc->q_posted = mc->q_in = mc->q_out = 0;
+    mc->st.gen.mv = NULL;
+    mc->latency = 0;
+    mc->max_latency = 0;
+    mc->current_steptime = mc->steptime;
+    mc->current_omega = 0.0;
+    mc->current_alpha = 0.0;
+    mc->hist_lock = (struct _seqlock_)SEQLOCK_INIT;
+    mc->runtime = mc->step_time = 0;
+    mc->snap_lock = (struct _seqlock_)SEQLOCK_INIT;
+    memset (&mc->snap, 0, sizeof(struct _mot_snapshot_));     /* published by MOT_CMD_ADD */
+    mc->job_done = mc->job_wait = 0;
+    mc->job_fd = -1;
+    mc->job_cb = NULL;
+    mc->job_arg = NULL;
+    memset (&mc->hist_late, 0, sizeof(struct _mot_hist_));
+    memset (&mc->hist_early, 0, sizeof(struct _mot_hist_));
     
     mc->next = mc->prev = NULL;
-    if (first_mc == NULL) {
-        first_mc = last_mc = mc;
-    } else {
-        last_mc->next = mc;
-        mc->prev = last_mc;
-        last_mc = mc;
+    mc->ctrl = ctrl;
+    if (cmd_call (mc->ctrl, &(struct _mot_cmd_){ .cmd = MOT_CMD_ADD, .mc = mc }) != EXIT_SUCCESS) {   /* insert into the motor list */
+        rt_log ("-- Can't create motor. Max. %i motors per controller\n", MOT_MAX);
+        mot_rt_free (MOT_RT_MOT, mc);
+        return NULL;
     }
     
-    thread_state.mc_closed = 0;
     return mc;
 }
 /*! --------------------------------------------------------------------
@@ -446,21 +1490,16 @@ int kill_mot (struct _mot_ctl_ *mc)
     if (mc == NULL) 
         return EXIT_FAILURE;
     
-    thread_state.mc_closed = 1;
-    
-    mot_set_dir (mc, MOT_CW);
-    mot_disenable (mc);    
+    /* the driver thread stops the motor and removes it from the heap and the motor list */
+    cmd_call (mc->ctrl, &(struct _mot_cmd_){ .cmd = MOT_CMD_REMOVE, .mc = mc });
+    mot_notify_release (mc);                /* callbacks, eventfd */
     
-    if (mc->next != NULL) mc->next->prev = mc->prev;
-    if (mc->prev != NULL) mc->prev->next = mc->next;
-    if (mc == first_mc) first_mc = mc->next;
-    if (mc == last_mc) last_mc = mc->prev;
+    set_dir (mc, MOT_CW);
+    set_enable (mc, 1);    
     
     clear_mc_in_md (mc);
     
-    free (mc);
-    
-    thread_state.mc_closed = 0;
+    mot_rt_free (MOT_RT_MOT, mc);
     
     return EXIT_SUCCESS;
 }
@@ -469,8 +1508,10 @@ int kill_mot (struct _mot_ctl_ *mc)
  */ 
 int kill_all_mot ()
 {   
-    while (first_mc) {
-        if (kill_mot (first_mc) != EXIT_SUCCESS) 
+    struct _mot_ctrl_ *c;
+    
+    for (c = first_ctrl; c; c = c->next) {
+        if (kill_ctrl_mot (c) != EXIT_SUCCESS) 
             return EXIT_FAILURE;
     }
 
@@ -481,28 +1522,43 @@ int kill_all_mot ()
  */ 
 int count_mot (void)
 {
-    struct _mot_ctl_ *mc = first_mc;
+    struct _mot_ctrl_ *c;
     int count = 0;
     
-    while (mc) {
-        count++;
-        mc = mc->next;
-    }
+    for (c = first_ctrl; c; c = c->next) 
+        count += (int)__atomic_load_n (&c->mot_count, __ATOMIC_ACQUIRE);
     
     return count;
 }
+/*! --------------------------------------------------------------------
+ * @brief  copy of the motor list of the controller. The driver thread 
+ *          copies the list, the API never walks the list of a running 
+ *          thread.
+ * @param  mc = MOT_MAX motors
+ * @return  number of motors, -1 = no controller
+ */ 
+int mot_list (struct _mot_ctrl_ *ctrl, struct _mot_ctl_ **mc)
+{
+    if (!ctrl)
+        ctrl = default_ctrl;
+    if (!ctrl || !mc) 
+        return -1;
+    
+    return cmd_call (ctrl, &(struct _mot_cmd_){ .cmd = MOT_CMD_LIST, .list = mc });
+}
 /*! --------------------------------------------------------------------
  * 
  */ 
 int check_mc_pointer (struct _mot_ctl_ *mc)
 {
-    struct _mot_ctl_ *m = first_mc;
+    struct _mot_ctl_ *list[MOT_MAX];
+    struct _mot_ctrl_ *c;
+    int i, n;
     
-    while (m) {
-        if (m == mc) 
-            return EXIT_SUCCESS;
-        m = m->next;
-    }
+    for (c = first_ctrl; c; c = c->next) 
+        for (i = 0, n = mot_list (c, list); i < n; i++) 
+            if (list[i] == mc) 
+                return EXIT_SUCCESS;
     
     return EXIT_FAILURE;
 }
@@ -517,10 +1573,66 @@ void show_mot_ctl (struct _mot_ctl_ *mc)
     }
     
     printf ("max_latency=%lli\n", (long long int)mc->max_latency);
+    if (mc->current_stepcount)
+        printf ("mean_latency=%lli ns\n", (long long int)(mc->sum_latency / mc->current_stepcount));
+    if (mc->overruns)
+        printf ("overruns=%u  lost_time=%llu us\n", mc->overruns, (unsigned long long)(mc->lost_time / 1000));
+    
+    struct _mot_hist_ late;                 /* MOT_HIST_BUCKETS counters, ~2 KiB on the stack */
+    mot_hist_snapshot (mc, &late, NULL);
+    printf ("latency p50=%llu ns  p99=%llu ns  p99.9=%llu ns  max=%llu ns  (%llu steps)\n",
+             (unsigned long long)mot_hist_percentile (&late, 0.5),
+             (unsigned long long)mot_hist_percentile (&late, 0.99),
+             (unsigned long long)mot_hist_percentile (&late, 0.999),
+             (unsigned long long)late.max,
+             (unsigned long long)late.n);
     printf ("current_stepcount=%llu\n", (unsigned long long)mc->current_stepcount);
     printf ("real_stepcount=%lli\n", (long long int)mc->real_stepcount);
     
 }
+/*! --------------------------------------------------------------------
+ * @brief  cb is called at the end of every job of the motor by the 
+ *          worker of the controller (SCHED_OTHER), not by the driver 
+ *          thread. The callback may start the next job, also while 
+ *          other threads call the API (see: cmd_post()). 
+ *          see: mot_notify.c
+ * @param  cb = NULL: no callback
+ */
+int mot_set_job_callback (struct _mot_ctl_ *mc, void (*cb)(struct _mot_ctl_ *mc, void *arg), void *arg)
+{
+    if (!mc) 
+        return EXIT_FAILURE;
+    
+    if (cb && (mot_notify_start (mc->ctrl) != EXIT_SUCCESS))
+        return EXIT_FAILURE;
+    
+    return cmd_call (mc->ctrl, &(struct _mot_cmd_){ .cmd = MOT_CMD_CALLBACK, .mc = mc, .cb = cb, .arg = arg });
+}
+/*! --------------------------------------------------------------------
+ * @brief  coherent copy of the state of a motor, written by the driver 
+ *          thread after every step and every change of the mode.
+ *          The driver thread never waits; the copy is repeated, if a 
+ *          step was written in the meantime.
+ * @example
+ *          struct _mot_snapshot_ s;
+ *          do {
+ *              mot_snapshot (m1, &s);
+ *          } while (s.aktiv);
+ */
+int mot_snapshot (struct _mot_ctl_ *mc, struct _mot_snapshot_ *s)
+{
+    uint32_t seq;
+    
+    if (!mc || !s)
+        return EXIT_FAILURE;
+    
+    do {
+        seq = seqlock_read_begin (&mc->snap_lock);
+        memcpy (s, &mc->snap, sizeof(struct _mot_snapshot_));
+    } while (seqlock_read_retry (&mc->snap_lock, seq));
+    
+    return EXIT_SUCCESS;
+}
 /*! --------------------------------------------------------------------
  * @param  *mc  motor handle
  *          dir  0=CW  1=CCW
@@ -535,12 +1647,29 @@ int mot_setparam (struct _mot_ctl_ *mc,
     if (!mc) 
         return EXIT_FAILURE;
     
-    mot_set_dir (mc, dir);        
-    mc->num_steps = mc->num_rest = num_steps;
-    mc->flag.endless = (num_steps == 0) ? 1 : 0;
-    mc->max_latency = 0;
-    mc->a_start = a_start;
-    mc->a_stop = a_stop;
+    cmd_post (mc->ctrl, &(struct _mot_cmd_){ .cmd = MOT_CMD_PARAM, .mc = mc, .value = dir, 
+                                   .num_steps = num_steps, .a_start = a_start, .a_stop = a_stop });
+    
+    return EXIT_SUCCESS;
+}
+/*! --------------------------------------------------------------------
+ * @brief   like mot_setparam(), but speed-up and speed-down are jerk limited
+ *           S-curves: the acceleration rises with jerk to a_start, stays 
+ *           constant and falls with jerk to zero at the target speed.
+ * @param   jerk [s⁻3]. jerk == 0 => constant acceleration like mot_setparam()
+ */ 
+int mot_setparam_scurve (struct _mot_ctl_ *mc,
+                         uint8_t dir,
+                         uint64_t num_steps,
+                         double a_start,
+                         double a_stop,
+                         double jerk)
+{
+    if (!mc || (jerk < 0.0)) 
+        return EXIT_FAILURE;
+    
+    cmd_post (mc->ctrl, &(struct _mot_cmd_){ .cmd = MOT_CMD_PARAM, .mc = mc, .value = dir, .num_steps = num_steps, 
+                                   .a_start = a_start, .a_stop = a_stop, .jerk = jerk });
     
     return EXIT_SUCCESS;
 }
@@ -552,19 +1681,10 @@ int mot_start (struct _mot_ctl_ *mc)
     if (!mc) 
         return EXIT_FAILURE;
 
-    if (mc->num_steps < 0) {
-        printf ("-- parameter num_steps failed\n");
-        return (EXIT_FAILURE);
-    }
-    
-    if (mc->mode != MOT_IDLE) {
-        printf ("-- Can't start motor\n");
+    if (cmd_call (mc->ctrl, &(struct _mot_cmd_){ .cmd = MOT_CMD_START, .mc = mc }) != EXIT_SUCCESS) {
+        rt_log ("-- Can't start motor. Motor is running or parameter num_steps failed\n");
         return EXIT_FAILURE;
     }
-    
-    mot_enable (mc);
-    mc->mode = MOT_START_RUN;        
-    mc->flag.aktiv = 1;
    
     return EXIT_SUCCESS;
 }
@@ -576,16 +1696,25 @@ int mot_stop (struct _mot_ctl_ *mc)
     if (!mc) 
         return EXIT_FAILURE;
     
-    if (mc->mode != MOT_IDLE) {
-        if (mc->a_stop > 0.0) {                             /* stop with speed-down */
-            mc->num_rest = calc_steps_for_step_down (mc);
-            mc->mode = MOT_SPEED_DOWN;
-        }
-        else mc->mode = MOT_JOB_READY;
-    }
+    cmd_post (mc->ctrl, &(struct _mot_cmd_){ .cmd = MOT_CMD_STOP, .mc = mc });    /* speed-down is compiled by the driver thread */
     
     return EXIT_SUCCESS;
 }
+/*! --------------------------------------------------------------------
+ * @brief   The histograms are cleared by the driver thread.
+ * @param   mc == NULL: loop histogram of the default controller
+ */ 
+int mot_hist_reset (struct _mot_ctl_ *mc)
+{
+    struct _mot_ctrl_ *c = (mc) ? mc->ctrl : default_ctrl;
+    
+    if (!c)
+        return EXIT_FAILURE;
+    
+    cmd_post (c, &(struct _mot_cmd_){ .cmd = MOT_CMD_HIST_RESET, .mc = mc });
+        
+    return EXIT_SUCCESS;
+} 
 /*! --------------------------------------------------------------------
  * @brief   Engine stopping without ramp.
  */ 
@@ -594,8 +1723,7 @@ int mot_fast_stop (struct _mot_ctl_ *mc)
     if (!mc) 
         return EXIT_FAILURE;
     
-    if (mc->mode != MOT_IDLE)
-        mc->mode = MOT_JOB_READY;    
+    cmd_post (mc->ctrl, &(struct _mot_cmd_){ .cmd = MOT_CMD_FAST_STOP, .mc = mc });
         
     return EXIT_SUCCESS;
 } 
@@ -607,15 +1735,11 @@ int mot_on_step (struct _mot_ctl_ *mc, uint8_t dir)
     if (!mc) 
         return EXIT_FAILURE;
         
-    if (mc->mode != MOT_IDLE) {
-        printf ("-- Can't step. Motor is not idle\n");
+    if (cmd_call (mc->ctrl, &(struct _mot_cmd_){ .cmd = MOT_CMD_STEP, .mc = mc, .value = dir }) != EXIT_SUCCESS) {
+        rt_log ("-- Can't step. Motor is not idle\n");
         return EXIT_FAILURE;
     }
         
-    mot_enable (mc);
-    mot_set_dir (mc, dir);
-    mot_step (mc);              /* Execute step */
-        
     return EXIT_SUCCESS;
 }
 /*! --------------------------------------------------------------------
@@ -625,7 +1749,7 @@ int mot_start_md (struct _motion_diagram_ *md)
 {
     if (md) {
         if (check_md_pointer(md) != EXIT_SUCCESS) {      /* check md */
-            printf ("-- Data set not found\n");
+            rt_log ("-- Data set not found\n");
             return EXIT_FAILURE;
         }
     }
@@ -634,22 +1758,102 @@ int mot_start_md (struct _motion_diagram_ *md)
         return EXIT_FAILURE;
     
     if (md->data_set_is_incorrect) {
-        printf ("-- Data set is incorrect. ERROR No.: %i\n", md->data_set_is_incorrect);
+        rt_log ("-- Data set is incorrect. ERROR No.: %i\n", md->data_set_is_incorrect);
         return EXIT_FAILURE;
     }    
     
-    if (md->mc->mode != MOT_IDLE) {
-        printf ("-- Can't start motor-program\n");
+    if (cmd_call (md->mc->ctrl, &(struct _mot_cmd_){ .cmd = MOT_CMD_START_MD, .mc = md->mc, .mp = md->first_mp }) != EXIT_SUCCESS) {
+        rt_log ("-- Can't start motor-program\n");
+        return EXIT_FAILURE;
+    }
+    
+    return EXIT_SUCCESS;
+}
+/*! --------------------------------------------------------------------
+ * @brief   append a move to the move queue of the motor. The moves run
+ *           one after another without stop: the look-ahead planner of 
+ *           the driver thread calculates the speed between the moves.
+ *           An idle motor starts with the first move. If the queue is 
+ *           full, the function waits. mot_stop() drops the queue.
+ * @param   steptime = cruise speed [us]
+ * @example
+ *      for (i = 0; i < 20; i++)
+ *          mot_queue_move (m1, MOT_CW, 400, 300, 200.0, 200.0);
+ *      while (m1->flag.aktiv) usleep (10000);
+ */ 
+int mot_queue_move (struct _mot_ctl_ *mc, uint8_t dir, uint64_t num_steps, 
+                    uint32_t steptime, double a_start, double a_stop)
+{
+    if (!mc || !num_steps || !steptime) 
+        return EXIT_FAILURE;
+    
+    pthread_mutex_lock (&mc->ctrl->cmd_lock);          /* q_posted and the slot, see: cmd_post() */
+    while (mc->q_posted - __atomic_load_n (&mc->q_out, __ATOMIC_ACQUIRE) >= MOT_QUEUE_SIZE) {   /* queue is full */
+        if (!mc->ctrl->state.run)
+            api_commands (mc->ctrl);
+        else
+            usleep (1000);
+    }
+    mc->q_posted++;
+    cmd_put (mc->ctrl, &(struct _mot_cmd_){ .cmd = MOT_CMD_QUEUE, .mc = mc, .value = dir, .num_steps = num_steps,
+                                  .steptime = steptime, .a_start = a_start, .a_stop = a_stop });
+    pthread_mutex_unlock (&mc->ctrl->cmd_lock);
+    
+    return EXIT_SUCCESS;
+}
+/*! --------------------------------------------------------------------
+ * @return  number of posted moves, that are not compiled
+ */ 
+int mot_queue_count (struct _mot_ctl_ *mc)
+{
+    if (!mc) 
+        return 0;
+    
+    return (int)(mc->q_posted - __atomic_load_n (&mc->q_out, __ATOMIC_ACQUIRE));
+}
+/*! --------------------------------------------------------------------
+ * @brief   linear move. The motors start together and end together.
+ *           The motor with the most steps (dominant axis) runs with 
+ *           steptime and the ramps a_start, a_stop. The steps of the 
+ *           other motors are distributed by the driver thread with a 
+ *           Bresenham accumulator. mot_stop() of any motor stops the move.
+ *           All motors must belong to the same controller.
+ * @param   steps = steps of each motor. > 0 CW, < 0 CCW
+ *           n = number of motors, max. MOT_LINE_AXES
+ * @example 
+ *      struct _mot_ctl_ *axis[2] = {mx, my};
+ *      int64_t steps[2] = {3000, -1000};
+ *      mot_move_line (axis, steps, 2, 500, 20.0, 20.0);
+ */ 
+int mot_move_line (struct _mot_ctl_ **mc, const int64_t *steps, uint8_t n, 
+                   uint32_t steptime, double a_start, double a_stop)
+{
+    struct _mot_line_ line;
+    struct _mot_ctrl_ *c;
+    int i;
+    
+    if (!mc || !steps || !n || (n > MOT_LINE_AXES) || !steptime || !mc[0])
         return EXIT_FAILURE;
+    
+    c = mc[0]->ctrl;
+    for (i = 1; i < n; i++) {
+        if (!mc[i] || (mc[i]->ctrl != c)) {
+            rt_log ("-- Can't start linear move. The motors have different controllers\n");
+            return EXIT_FAILURE;
+        }
     }
     
-    mot_enable (md->mc);                            /* switch motor ON */
-    md->mc->max_latency = 0;
-    md->mc->current_stepcount = 0;
-    md->mc->mc_mp = md->first_mp;                   /* set first moition-point */
-    md->mc->current_omega = md->first_mp->omega;
-    gettimeofday (&md->mc->run_start, NULL);
-    md->mc->mode = MOT_START_MD;
+    line.n = n;
+    memcpy (line.mc, mc, n * sizeof(struct _mot_ctl_ *));
+    memcpy (line.steps, steps, n * sizeof(int64_t));
+    line.steptime = steptime;
+    line.a_start = a_start;
+    line.a_stop = a_stop;
+    
+    if (cmd_call (c, &(struct _mot_cmd_){ .cmd = MOT_CMD_LINE, .line = &line }) != EXIT_SUCCESS) {
+        rt_log ("-- Can't start linear move. A motor is running or is used twice\n");
+        return EXIT_FAILURE;
+    }
     
     return EXIT_SUCCESS;
 }
@@ -660,9 +1864,7 @@ int mot_start_md (struct _motion_diagram_ *md)
 int mot_switch_enable (struct _mot_ctl_ *mc, uint8_t enable)
 {
     if (mc) {
-#ifdef USE_GPIO
-        digitalWrite (mc->mp.enable_pin, (mc->flag.enable = enable));
-#endif    
+        cmd_post (mc->ctrl, &(struct _mot_cmd_){ .cmd = MOT_CMD_ENABLE, .mc = mc, .value = enable });
     } else return EXIT_FAILURE;
     
     return EXIT_SUCCESS;
@@ -686,9 +1888,7 @@ int mot_set_dir (struct _mot_ctl_ *mc, uint8_t direction)
 {
     if (!mc) 
         return EXIT_FAILURE;
-#ifdef USE_GPIO
-    digitalWrite (mc->mp.dir_pin, (mc->flag.dir = direction));
-#endif    
+    cmd_post (mc->ctrl, &(struct _mot_cmd_){ .cmd = MOT_CMD_DIR, .mc = mc, .value = direction });
         
     return EXIT_SUCCESS;
 }
@@ -702,11 +1902,82 @@ int mot_set_steptime (struct _mot_ctl_ *mc, int steptime)
     if (!mc) 
         return (EXIT_FAILURE);
    
-    if (steptime != mc->steptime) {
-        mc->steptime = steptime;
-        mc->omega = calc_omega (mc->steps_per_turn, mc->steptime);    
-        printf ("-- new steptime=%u us  Omega=%2.3f s⁻1\n", mc->steptime, mc->omega);
+    /* mc->steptime is written by the driver thread, the command compares */
+    cmd_post (mc->ctrl, &(struct _mot_cmd_){ .cmd = MOT_CMD_STEPTIME, .mc = mc, .steptime = steptime });
+    
+    return EXIT_SUCCESS;
+}
+/*! --------------------------------------------------------------------
+ * @brief   gpio pins MS1, MS2, MS3 of the A4988. The pins get the fine 
+ *           resolution of mot_set_microstep() (default MOT_MS_HALF).
+ *           The motor must be idle.
+ * @param   ms1, ms2, ms3 = MOT_MS_PIN_NC: the pin is hard wired
+ */ 
+int mot_set_ms_pins (struct _mot_ctl_ *mc, uint8_t ms1, uint8_t ms2, uint8_t ms3)
+{
+    struct _mot_pin_ pin = { .ms_pin = {ms1, ms2, ms3} };
+    int i;
+    
+    if (!mc) 
+        return EXIT_FAILURE;
+    
+    for (i = 0; i < 3; i++) 
+        if (pin.ms_pin[i] != MOT_MS_PIN_NC)
+            gpio_mode (pin.ms_pin[i], GPIO_OUTPUT);
+    
+    if (cmd_call (mc->ctrl, &(struct _mot_cmd_){ .cmd = MOT_CMD_MICROSTEP, .mc = mc, .pin = &pin }) != EXIT_SUCCESS) {
+        rt_log ("-- Can't set MS pins. Motor is not idle\n");
+        return EXIT_FAILURE;
+    }
+    
+    return EXIT_SUCCESS;
+}
+/*! --------------------------------------------------------------------
+ * @brief   microstep resolution. The step unit (steps_per_turn, num_steps,
+ *           steptime, real_stepcount, motion diagrams) is the fine microstep.
+ *           At high speed the driver thread switches to the coarse 
+ *           resolution: one pulse moves 2^(fine - coarse) steps, so the 
+ *           pulse rate is smaller by this factor. It switches back below 
+ *           omega_fine (hysteresis). The motor must be idle.
+ *           A hard wired MS pin (MOT_MS_PIN_NC) must have the same level 
+ *           in both resolutions. 
+ *           The position after new_mot() must be the home position of the 
+ *           A4988 (after reset), it is a full step.
+ * @param   fine, coarse = see: enum MOT_MS. coarse == fine: no switching
+ *          omega_coarse = |omega| >= omega_coarse: coarse [rad/s]
+ *          omega_fine = |omega| < omega_fine: fine [rad/s]. <= omega_coarse
+ * @example 200 steps motor, 1/16 below 1 turn/s, full step above 2 turns/s:
+ *      m1 = new_mot (NULL, 25, 23, 24, 3200);
+ *      mot_set_ms_pins (m1, 17, 27, 22);
+ *      mot_set_microstep (m1, MOT_MS_SIXTEENTH, MOT_MS_FULL, 4.0 * M_PI, 2.0 * M_PI);
+ */ 
+int mot_set_microstep (struct _mot_ctl_ *mc, uint8_t fine, uint8_t coarse, 
+                       double omega_coarse, double omega_fine)
+{
+    struct _mot_ms_ ms = { .fine = fine, .coarse = coarse, 
+                           .omega_coarse = (float)omega_coarse, .omega_fine = (float)omega_fine };
+    int i;
+    
+    if (!mc) 
+        return EXIT_FAILURE;
+    
+    if ((fine > MOT_MS_SIXTEENTH) || (coarse > fine) || 
+        ((coarse != fine) && ((omega_coarse <= 0.0) || (omega_fine > omega_coarse)))) {
+        rt_log ("-- wrong microstep parameter\n");
+        return EXIT_FAILURE;
     }
+    for (i = 0; i < 3; i++) {
+        if ((mc->mp.ms_pin[i] == MOT_MS_PIN_NC) && (ms_level[fine][i] != ms_level[coarse][i])) {
+            rt_log ("-- MS%i is hard wired, see: mot_set_ms_pins()\n", i + 1);
+            return EXIT_FAILURE;
+        }
+    }
+    
+    if (cmd_call (mc->ctrl, &(struct _mot_cmd_){ .cmd = MOT_CMD_MICROSTEP, .mc = mc, .ms = &ms }) != EXIT_SUCCESS) {
+        rt_log ("-- Can't set microstep. Motor is not idle\n");
+        return EXIT_FAILURE;
+    }
+    
     return EXIT_SUCCESS;
 }
 /*! --------------------------------------------------------------------
@@ -749,20 +2020,59 @@ double calc_omega (uint32_t steps_per_turn, uint32_t steptime)
 double calc_steps_for_step_down (struct _mot_ctl_ *mc)
 {
     double omega = calc_omega (mc->steps_per_turn, mc->current_steptime); 
-    double phi = omega * omega / 2.0 / mc->a_stop;         
+    double phi = (mc->jerk > 0.0) ? calc_phi_for_scurve_down (omega, mc->current_alpha, mc->a_stop, mc->jerk)
+                                  : omega * omega / 2.0 / mc->a_stop;         
     
     return phi / mc->phi_per_step;
 }
+/*! --------------------------------------------------------------------
+ * @brief   braking angle of the jerk limited speed-down [rad]. 
+ *           An acceleration alpha > 0 is first reduced to zero with jerk,
+ *           then the speed-down is symmetric: mean speed = omega / 2.
+ *           a_stop is reached: T = omega/a_stop + a_stop/jerk
+ *           a_stop is not reached: T = 2 * sqrt(omega/jerk)
+ * @param   omega = current speed [rad/s], alpha = current acceleration [s⁻2]
+ */
+double calc_phi_for_scurve_down (double omega, double alpha, double a_stop, double jerk)
+{
+    double t, phi = 0.0;
+    
+    omega = fabs (omega);
+    if (alpha > 0.0) {                                  /* acceleration => 0 */
+        t = alpha / jerk;
+        phi = omega * t + alpha * t * t / 2.0 - jerk * t * t * t / 6.0;
+        omega += alpha * alpha / 2.0 / jerk;
+    }
+    
+    if (omega * jerk >= a_stop * a_stop)               
+        return phi + omega / 2.0 * (omega / a_stop + a_stop / jerk);
+    
+    return phi + omega * sqrt (omega / jerk);
+}
 /*! --------------------------------------------------------------------
  * @brief   motion diagram
  *          a new diagram is created
  */
 struct _motion_diagram_ *new_md (struct _mot_ctl_ *mc)
 {
-    struct _motion_diagram_ *md = (struct _motion_diagram_ *) malloc (sizeof(struct _motion_diagram_));
-    struct _move_point_ *mp = (struct _move_point_ *) malloc (sizeof(struct _move_point_));
+    struct _motion_diagram_ *md = (struct _motion_diagram_ *) mot_rt_alloc (MOT_RT_MD);
+    
+    if (md == NULL)
+        return NULL;
+    if ((md->mp_pool = mot_rt_points (md, &md->mp_pool_size)) == NULL) {     /* real time safe mode: fixed block */
+        if ((md->mp_pool = (struct _move_point_ *) malloc (MD_POOL_INIT * sizeof(struct _move_point_))) == NULL) {
+            rt_log ("-- Can't create motion-diagram\n");
+            mot_rt_free (MOT_RT_MD, md);
+            return NULL;
+        }
+        md->mp_pool_size = MD_POOL_INIT;
+    }
+    md->mp_pool_used = 1;
+    md->free_mp = NULL;
     
-    mp->omega = mp->t = mp->delta_phi = 0.0;        /* the first move point with t=0 */
+    struct _move_point_ *mp = &md->mp_pool[0];
+    
+    mp->omega = mp->t = mp->phi = 0.0;              /* the first move point with t=0 */
     mp->a = 0.0;
     mp->delta_omega = mp->delta_t = mp->delta_phi = 0.0;
     mp->steps = mp->sum_steps = 0;
@@ -776,6 +2086,8 @@ struct _motion_diagram_ *new_md (struct _mot_ctl_ *mc)
     md->max_t = 0.5;
     
     md->data_set_is_incorrect = 0;
+    md->stream = MD_STREAM_OFF;
+    md->mp_done = md->underrun = 0;
     md->mc = mc;
     md->phi_all = 0.0;
     md->next = md->prev = NULL;    
@@ -810,11 +2122,14 @@ struct _motion_diagram_ *new_md_from_file (struct _mot_ctl_ *mc, const char *fna
     uint16_t n;
     
     if ((f = fopen (fname, "r+t")) == NULL) {
-        printf ("-- File <%s> not found\n", fname);
+        rt_log ("-- File <%s> not found\n", fname);
         return NULL;
     }
     
-    md = new_md (mc);
+    if ((md = new_md (mc)) == NULL) {
+        fclose (f);
+        return NULL;
+    }
     while (fgets (str, MAX_CHAR, f)) {
         n=0;
         while (str[n] == ' ') n++;
@@ -822,23 +2137,9 @@ struct _motion_diagram_ *new_md_from_file (struct _mot_ctl_ *mc, const char *fna
             int anz_arg;
             if ((anz_arg = sscanf (str, "%f %f\n", &speed, &t)) != 2) {
                 if (anz_arg > 0) 
-                    printf ("param count incorrekt: %s\n", str);
-            } else {
-                switch (speedformat) {
-                    case OMEGA:
-                        add_mp_omega (md, speed, t);    /* file format =  OMEGA[1/rad] and t[s] */
-                        break;
-                    case FREQ:
-                        add_mp_Hz (md, speed, t);       /* file format =  FREQ[1/s] and t[s] */
-                        break;
-                    case RPM:
-                        add_mp_rpm (md, speed, t);      /* file format =  RPM[1/min] and t[s] */
-                        break;
-                    case STEP:                        
-                        add_mp_steps (md, speed, t);    /* file format =  FREQ[1/s] and STEPS */
-                        break;
-                }
-            }                                    
+                    rt_log ("param count incorrekt: %s\n", str);
+            } else 
+                add_mp (md, speedformat, speed, t);
         }
     }
     fclose (f);
@@ -860,19 +2161,19 @@ extern int kill_md (struct _motion_diagram_ *md)
        
     if (md->mc != NULL) {
         if (md->mc->mc_mp != NULL) {          /* Engine is running with this motion diagram */
-            printf ("-- kill failure\n");
+            rt_log ("-- kill failure\n");
             return EXIT_FAILURE;
         }
     }
         
-    kill_all_mp (md);
-    
     if (md->next != NULL) md->next->prev = md->prev;
     if (md->prev != NULL) md->prev->next = md->next;
     if (md == first_md) first_md = md->next;
     if (md == last_md) last_md = md->prev; 
     
-    free (md);
+    if (!mot_rt_is_points (md->mp_pool))    /* all move points */
+        free (md->mp_pool);
+    mot_rt_free (MOT_RT_MD, md);
     
     return EXIT_SUCCESS;
 }
@@ -886,7 +2187,7 @@ extern int kill_all_md (void)
     while (md != NULL) {
         if (md->mc != NULL) {
             if (md->mc->mode != MOT_IDLE) {
-                printf ("-- Can't delete motion-diagram. Engine is running\n");
+                rt_log ("-- Can't delete motion-diagram. Engine is running\n");
                 return EXIT_FAILURE;
             }
         }
@@ -990,7 +2291,7 @@ int gnuplot_write_graph_data_file (struct _motion_diagram_ *md, const char *fnam
     uint64_t sum_step = 0;
     
     if ((data = fopen (fname, "w+t")) == 0) {
-        printf ("-- Can't open %s\n", fname);
+        rt_log ("-- Can't open %s\n", fname);
         return EXIT_FAILURE;
     }
     
@@ -1026,22 +2327,22 @@ int gnuplot_md (struct _motion_diagram_ *md)
         
     if (md != NULL) {        
         if (check_md_pointer(md) != EXIT_SUCCESS) {              /* check parameter md */
-            printf ("-- Can't find motion-diagram\n");
+            rt_log ("-- Can't find motion-diagram\n");
             return EXIT_FAILURE;
         }
     } else {
-        printf ("-- diagram pointer is empty\n");
+        rt_log ("-- diagram pointer is empty\n");
         return EXIT_FAILURE;
     }
     
         
     if (gnuplot_write_graph_data_file (md, "graph.txt") != EXIT_SUCCESS) {      /* write motion data to a file */
-        printf ("-- Can't write diagram data to graph.txt\n");
+        rt_log ("-- Can't write diagram data to graph.txt\n");
         return EXIT_FAILURE;
     }    
         
     if ((gp = popen("gnuplot -p" , "w")) == NULL) {
-        printf ("-- Can't open gnuplot\n");
+        rt_log ("-- Can't open gnuplot\n");
         return EXIT_FAILURE;
     }
         
@@ -1068,6 +2369,83 @@ int gnuplot_md (struct _motion_diagram_ *md)
     pclose (gp);
     return EXIT_SUCCESS;
 }
+/*! --------------------------------------------------------------------
+ * @brief   The block of the move points is moved by realloc(),
+ *           the pointers to the points are corrected.
+ * @param   old = address of the block before realloc()
+ */
+#define MP_REBASE(p) if (p) p = (struct _move_point_ *)((uintptr_t)(p) - old + (uintptr_t)md->mp_pool)
+
+static void md_rebase (struct _motion_diagram_ *md, uintptr_t old)
+{
+    uint32_t i;
+    
+    MP_REBASE (md->first_mp);
+    MP_REBASE (md->last_mp);
+    MP_REBASE (md->free_mp);
+    for (i = 0; i < md->mp_pool_used; i++) {
+        MP_REBASE (md->mp_pool[i].next);
+        MP_REBASE (md->mp_pool[i].prev);
+    }
+}
+/*! --------------------------------------------------------------------
+ * @brief   The block of the diagram gets space for n move points.
+ *           Not possible, while the motor runs the diagram.
+ */
+int md_reserve (struct _motion_diagram_ *md, uint32_t n)
+{
+    struct _move_point_ *pool;
+    uintptr_t old;
+    
+    if (!md) 
+        return EXIT_FAILURE;
+    
+    if (n <= md->mp_pool_size)
+        return EXIT_SUCCESS;
+    
+    if (md->mc && md->first_mp && (__atomic_load_n (&md->mc->mc_mp, __ATOMIC_ACQUIRE) == md->first_mp)) {
+        rt_log ("-- Can't add move points. Engine is running\n");
+        return EXIT_FAILURE;
+    }
+    
+    if (mot_rt_is_points (md->mp_pool)) {   /* real time safe mode, see: mot_rt.c */
+        rt_log ("-- Can't add move points. Max. %u move points per diagram\n", md->mp_pool_size);
+        return EXIT_FAILURE;
+    }
+    
+    old = (uintptr_t)md->mp_pool;
+    if ((pool = (struct _move_point_ *) realloc (md->mp_pool, (size_t)n * sizeof(struct _move_point_))) == NULL) {
+        rt_log ("-- no memory for %u move points\n", n);
+        return EXIT_FAILURE;
+    }
+    md->mp_pool = pool;
+    md->mp_pool_size = n;
+    if ((uintptr_t)pool != old)
+        md_rebase (md, old);
+    
+    return EXIT_SUCCESS;
+}
+/*! --------------------------------------------------------------------
+ * @brief   new move point: a deleted point or the next point of the block.
+ *           A full block is doubled.
+ */
+static struct _move_point_ *mp_alloc (struct _motion_diagram_ *md)
+{
+    struct _move_point_ *mp;
+    
+    if (md->stream)
+        return md_stream_alloc (md);
+
+    if ((mp = md->free_mp) != NULL) {
+        md->free_mp = mp->next;
+        return mp;
+    }
+    
+    if ((md->mp_pool_used >= md->mp_pool_size) && (md_reserve (md, 2 * md->mp_pool_size) != EXIT_SUCCESS))
+        return NULL;
+
+    return &md->mp_pool[md->mp_pool_used++];
+}
 /*! --------------------------------------------------------------------
  * @brief  add an item to the end of the list
  */
@@ -1078,7 +2456,7 @@ struct _move_point_ *add_mp_Hz (struct _motion_diagram_ *md, double Hz, double t
         
     if (t < md->last_mp->t) {                               /* negative time */
         md->data_set_is_incorrect = 1;
-        printf ("-- ERROR: negative time \n");
+        rt_log ("-- ERROR: negative time \n");
         return (NULL);
     }
         
@@ -1092,7 +2470,9 @@ struct _move_point_ *add_mp_Hz (struct _motion_diagram_ *md, double Hz, double t
 			add_mp_omega (md, 0.0, md->last_mp->t + nt);    /* include zero crossing motion point */
     }
         
-    struct _move_point_ *mp = (struct _move_point_ *) malloc (sizeof(struct _move_point_));    
+    struct _move_point_ *mp = mp_alloc (md);
+    if (!mp)
+        return NULL;
     
     mp->omega = omega;
     mp->t = t;
@@ -1114,16 +2494,11 @@ struct _move_point_ *add_mp_Hz (struct _motion_diagram_ *md, double Hz, double t
         md->min_omega = mp->omega;
     if (t > md->max_t) md->max_t = t;
     
-    mp->next = mp->prev = NULL;
-    if (md->first_mp == NULL) {        
-        md->first_mp = md->last_mp = mp;
-    } else {        
-        md->last_mp->next = mp;
-        mp->prev = md->last_mp;
-        md->last_mp = mp;       
-    }
-    
+    mp->next = NULL;
+    mp->prev = md->last_mp;
     mp->sum_steps = mp->prev->sum_steps + mp->steps;
+    __atomic_store_n (&md->last_mp->next, mp, __ATOMIC_RELEASE);     /* stream: the driver thread reads the point */
+    md->last_mp = mp;
     
     return mp;
 }
@@ -1168,12 +2543,31 @@ struct _move_point_ *add_mp_steps (struct _motion_diagram_ *md, double Hz, doubl
     
     if (t < md->last_mp->t) {                               /* negative time */
         md->data_set_is_incorrect = 1;
-        printf ("-- ERROR: negative time \n");
+        rt_log ("-- ERROR: negative time \n");
         return (NULL);
     }
     
     return add_mp_omega (md, omega, t);
 }
+/*! --------------------------------------------------------------------
+ * @brief   add an item to the end of the list
+ * @param   speedformat = [OMEGA, FREQ, RPM, STEP]; see: enum SPEEDFORMAT
+ *          t = time [s] or number of steps (STEP)
+ */
+struct _move_point_ *add_mp (struct _motion_diagram_ *md, uint8_t speedformat, double speed, double t)
+{
+    switch (speedformat) {
+        case OMEGA:
+            return add_mp_omega (md, speed, t);     /* OMEGA[1/rad] and t[s] */
+        case FREQ:
+            return add_mp_Hz (md, speed, t);        /* FREQ[1/s] and t[s] */
+        case RPM:
+            return add_mp_rpm (md, speed, t);       /* RPM[1/min] and t[s] */
+        case STEP:
+            return add_mp_steps (md, speed, t);     /* FREQ[1/s] and STEPS */
+    }
+    return NULL;
+}
 /*! --------------------------------------------------------------------
  * @brief   delete move point in motion diagram
  */
@@ -1187,7 +2581,8 @@ int kill_mp (struct _move_point_ *mp)
     if (mp == mp->owner->first_mp) mp->owner->first_mp = mp->next;
     if (mp == mp->owner->last_mp) mp->owner->last_mp = mp->prev;
         
-    free (mp);    
+    mp->next = mp->owner->free_mp;              /* the point is used again by the next add_mp() */
+    mp->owner->free_mp = mp;
         
     return EXIT_SUCCESS;
 }
@@ -1199,9 +2594,9 @@ int kill_all_mp (struct _motion_diagram_ *md)
     if (!md) 
         return EXIT_FAILURE;
         
-    while (md->first_mp != NULL) {        
-        kill_mp (md->first_mp);
-    }
+    md->first_mp = md->last_mp = NULL;          /* the block stays for new points */
+    md->free_mp = NULL;
+    md->mp_pool_used = 0;
         
     return EXIT_SUCCESS;
 }
@@ -4,10 +4,14 @@
  *  @name    Ulrich Buettemeier
  */
 
+#include <stdio.h>
 #include <math.h>
 #include <stdint.h>
+#include <pthread.h>
 #include <sys/time.h>
 
+#include "../../../tools/seqlock/seqlock.h"
+
 enum SPEEDFORMAT {
     OMEGA = 0,          /* rad/s */
     FREQ = 1,           /* s⁻1 */
@@ -32,20 +36,128 @@ enum MOT_STATE {                /* see: function mot_run() */
     MOT_START_MD = 0x20,
     MOT_RUN_MD = 0x021,
     MOT_RUN_SPEED_MD = 0x22,
+    MOT_WAIT_MD = 0x23,         /* streaming motion diagram: no move point in the ring, no step */
     
     MOT_JOB_READY = 0x80
 };
 
-struct _thread_state_ {        /* thread state => see: void *run_A4988() */
-    unsigned run: 1;
-    unsigned mc_closed: 1;
-    unsigned kill: 1;
-} extern thread_state;
+enum MOT_CMD {                  /* commands to the driver thread. see: struct _mot_cmd_ */
+    MOT_CMD_ADD = 0,            /* new_mot(): the motor is inserted in the motor list */
+    MOT_CMD_REMOVE = 1,         /* kill_mot(): the motor is stopped and removed from the motor list */
+    MOT_CMD_START = 2,
+    MOT_CMD_START_MD = 3,
+    MOT_CMD_STOP = 4,
+    MOT_CMD_FAST_STOP = 5,
+    MOT_CMD_PARAM = 6,          /* mot_setparam() */
+    MOT_CMD_STEPTIME = 7,       /* mot_set_steptime() */
+    MOT_CMD_STEP = 8,           /* mot_on_step() */
+    MOT_CMD_ENABLE = 9,         /* mot_switch_enable() */
+    MOT_CMD_DIR = 10,           /* mot_set_dir() */
+    MOT_CMD_HIST_RESET = 11,    /* mot_hist_reset() */
+    MOT_CMD_LINE = 12,          /* mot_move_line() */
+    MOT_CMD_QUEUE = 13,         /* mot_queue_move() */
+    MOT_CMD_MICROSTEP = 14,     /* mot_set_ms_pins(), mot_set_microstep() */
+    MOT_CMD_SYNC = 15,          /* no change. The API waits for the end of the loop pass, see: mot_tele_close() */
+    MOT_CMD_CALLBACK = 16,      /* mot_set_job_callback() */
+    MOT_CMD_LIST = 17           /* mot_list(): copy of the motor list */
+};
+
+#define MOT_CMD_SIZE 64         /* size of the command ring. power of 2 */
+
+#define MOT_MAX 32             /* max. number of motors of a controller */
+
+#define MOT_LINE_AXES 8         /* max. number of motors of a linear move. see: mot_move_line() */
+
+#define MOT_QUEUE_SIZE 16       /* moves in the move queue of a motor. power of 2. see: mot_queue_move() */
+
+#define MOT_DONE_SIZE 64        /* finished jobs for the callback worker of a controller. power of 2. see: mot_notify.c */
+
+#define MOT_REPORT_MS 100       /* min. time between two job reports of a controller. see: job_ready() */
+
+enum MOT_GPIO {                 /* gpio access. see: mot_set_gpio() and tools/gpio/gpio.h */
+    MOT_GPIO_WIRINGPI = 0,      /* digitalWrite(). default with target = bmc */
+    MOT_GPIO_MEM = 1,           /* gpio registers via /dev/gpiomem. The steps of one loop pass are one pulse. */
+    MOT_GPIO_MEM_EMULATED = 2,  /* like MOT_GPIO_MEM with an emulated register file, for hosts without gpio */
+    MOT_GPIO_CHARDEV = 3,       /* gpio character device /dev/gpiochip0 */
+    MOT_GPIO_SIM = 4,           /* simulator, every pin change is recorded. default with target = amd64 */
+    MOT_GPIO_NULL = 5           /* pin changes are dropped. see: init_mot_offline() */
+};
+
+enum MOT_SCHED_MODE {           /* wait for the next step. see: run_A4988() */
+    MOT_SCHED_BUSY = 0,         /* polls the clock until the deadline */
+    MOT_SCHED_SLEEP = 1         /* clock_nanosleep() until deadline - spin time, then polls the clock */
+};
+
+enum MOT_RAMP_ENGINE {          /* generator of the constant acceleration ramps. see: step_table.c */
+    MOT_RAMP_DOUBLE = 0,        /* sqrt() per step */
+    MOT_RAMP_FIXED = 1          /* recursive step delay in fixed-point, one multiply and one divide per step */
+};
+
+#define MOT_RAMP_FRAC 8         /* MOT_RAMP_FIXED: fractional bits of the step delay [us] */
+
+#define MOT_HIST_SUB_BITS 3
+#define MOT_HIST_SUB (1 << MOT_HIST_SUB_BITS)  /* linear buckets per power of 2 */
+#define MOT_HIST_BUCKETS 256                    /* values >= 2^33 ns are in the last bucket */
+
+struct _mot_hist_ {            /* log-linear histogram [ns]. see: mot_hist.c */
+    uint64_t count[MOT_HIST_BUCKETS];
+    uint64_t n;                 /* number of values */
+    uint64_t sum;               /* [ns] */
+    uint64_t max;               /* [ns] */
+};
+
+struct _thread_state_ {        /* thread state of a controller => see: void *run_A4988() */
+    volatile uint8_t run;
+    volatile uint8_t kill;
+    volatile uint8_t ready;     /* policy and cpus are set. see: mot_thread_apply() */
+};
+
+enum MOT_POLICY {               /* scheduling policy of the driver thread. see: mot_thread.c */
+    MOT_POLICY_OTHER = 0,       /* SCHED_OTHER */
+    MOT_POLICY_FIFO = 1,        /* SCHED_FIFO with priority */
+    MOT_POLICY_RR = 2,          /* SCHED_RR with priority */
+    MOT_POLICY_DEADLINE = 3     /* SCHED_DEADLINE with runtime, deadline and period */
+};
+
+#define MOT_THREAD_POLICY MOT_POLICY_FIFO   /* default policy */
+#define MOT_THREAD_PRIORITY 95              /* default priority */
+#define MOT_CPUS_LEN 64                     /* max. length of a cpu list */
+
+struct _mot_thread_cfg_ {      /* driver thread. see: mot_thread.c */
+    uint8_t policy;             /* see: enum MOT_POLICY */
+    int priority;               /* MOT_POLICY_FIFO, MOT_POLICY_RR: 1 ... 99 */
+    uint32_t runtime_us;        /* MOT_POLICY_DEADLINE */
+    uint32_t deadline_us;
+    uint32_t period_us;
+    char cpus[MOT_CPUS_LEN];    /* cpu list, e.g. "3" or "2-3". "" = all cpus */
+    uint8_t pinned;             /* used: the thread runs on cpus */
+    uint8_t fallback;           /* used: a setting has failed, see: mot_thread_get() */
+};
 
 struct _mot_pin_ {             /* motor gpio-pins */
     uint8_t dir_pin;
     uint8_t step_pin; 
     uint8_t enable_pin;
+    uint8_t ms_pin[3];          /* MS1, MS2, MS3. MOT_MS_PIN_NC = hard wired. see: mot_set_ms_pins() */
+};
+
+#define MOT_MS_PIN_NC 0xff      /* MS pin is not connected to the gpio */
+
+enum MOT_MS {                   /* microstep resolution of the A4988. see: mot_set_microstep() */
+    MOT_MS_FULL = 0,            /* MS1=0 MS2=0 MS3=0 */
+    MOT_MS_HALF = 1,            /* MS1=1 MS2=0 MS3=0 */
+    MOT_MS_QUARTER = 2,         /* MS1=0 MS2=1 MS3=0 */
+    MOT_MS_EIGHTH = 3,          /* MS1=1 MS2=1 MS3=0 */
+    MOT_MS_SIXTEENTH = 4        /* MS1=1 MS2=1 MS3=1 */
+};
+
+struct _mot_ms_ {              /* automatic microstep switching. see: mot_set_microstep() */
+    uint8_t fine;               /* resolution of the step unit (steps_per_turn). see: enum MOT_MS */
+    uint8_t coarse;             /* resolution at high speed. coarse == fine: no switching */
+    float omega_coarse;         /* |omega| >= omega_coarse: coarse [rad/s] */
+    float omega_fine;           /* |omega| < omega_fine: fine [rad/s] */
+    uint8_t shift;              /* one pulse = 1 << shift steps. Only written by the driver thread */
+    uint32_t switches;          /* number of switches. Only written by the driver thread */
 };
 
 struct _mot_flags_ {
@@ -53,15 +165,108 @@ struct _mot_flags_ {
     unsigned enable : 1;        /* chip enable */
     unsigned endless : 1;       /* motor runs forever, void mot_stop() stops the run. */
     unsigned aktiv : 1;         /* motor running */
+    unsigned queue : 1;         /* the job runs the move queue */
+};
+
+struct _mot_move_ {            /* move of the move queue. see: mot_queue_move() */
+    uint64_t steps;
+    double omega;               /* cruise speed [rad/s] */
+    double a_start, a_stop;     /* [s⁻2] */
+    double exit;                /* speed at the end of the move [rad/s]. Set by the look-ahead planner */
+    uint8_t dir;                /* MOT_CW, MOT_CCW */
+};
+
+/*! --------------------------------------------------------------------
+ * Step table
+ * The step intervals are compiled ahead of time into two chunks (double buffer).
+ * The driver thread only reads the active chunk, the generator refills the back chunk.
+ * see: step_table.c
+ */
+#define STEP_CHUNK_SIZE 64
+
+struct _step_entry_ {
+    uint32_t steptime;          /* time since the previous step [us] */
+    float omega;                /* angle-speed of this step [rad/s]. CCW < 0 */
+    float alpha;                /* angle acceleration of this step [s⁻2]. > 0 speed-up, < 0 speed-down */
+    uint8_t dir;                /* MOT_CW, MOT_CCW */
+    uint8_t mode;               /* motor state reported during this step. see: enum MOT_STATE */
+};
+
+struct _step_chunk_ {
+    struct _step_entry_ entry[STEP_CHUNK_SIZE];
+    uint16_t count;             /* number of valid entries */
+    uint8_t last;               /* 1 = last chunk of the job */
+};
+
+struct _step_gen_ {             /* compile state of the step generator */
+    uint8_t state;              /* MOT_SPEED_UP, MOT_RUN, MOT_SPEED_DOWN, MOT_START_MD, MOT_RUN_MD, MOT_JOB_READY */
+    uint8_t dir;
+    uint64_t count;             /* number of compiled steps */
+    uint64_t rest;              /* remaining steps */
+    uint32_t steptime;          /* steptime of the last compiled step [us] */
+    double omega;               /* angle-speed of the last compiled step [rad/s] */
+    double alpha;               /* S-curve: angle acceleration [s⁻2]. > 0 speed-up, < 0 speed-down */
+    double jerk;                /* S-curve: [s⁻3]. 0 = constant acceleration ramp */
+    double t;                   /* S-curve: time of the last compiled step [s] */
+    double t_frac;              /* rounding error of the compiled steptimes [us], see: step_us() */
+    double omega_min;           /* S-curve: speed of the first step, used at the end of the speed-down [rad/s] */
+    uint8_t phase;              /* S-curve: see: step_table.c enum SCURVE_PHASE */
+    uint8_t engine;             /* see: enum MOT_RAMP_ENGINE */
+    uint32_t c;                 /* MOT_RAMP_FIXED: step delay [us << MOT_RAMP_FRAC] */
+    uint32_t c_min;             /* MOT_RAMP_FIXED: step delay of the target speed [us << MOT_RAMP_FRAC] */
+    uint64_t brake_at;          /* MOT_RAMP_FIXED: speed-down starts after this step. 0 = never */
+    float phi_us;               /* MOT_RAMP_FIXED: phi_per_step * 1e6 << MOT_RAMP_FRAC, omega = phi_us / c */
+    struct _mot_move_ *mv;      /* move queue: current move. NULL = next move of the queue */
+    struct _mot_move_ stop;     /* move queue: speed-down of mot_stop() */
+    struct _move_point_ *mp;    /* current motion point, used by motion diagram */
+    uint64_t mp_step;           /* compiled steps of the current motion point */
+    double mp_t;                /* time of the compiled steps of the current motion point [s] */
+};
+
+struct _step_table_ {
+    struct _step_chunk_ chunk[2];   /* double buffer */
+    uint8_t active;                 /* chunk used by the driver thread */
+    uint16_t pos;                   /* read position in the active chunk */
+    uint8_t back_ready;             /* 1 = back chunk is filled */
+    struct _step_gen_ gen;
+};
+
+struct _mot_ctrl_;
+
+struct _mot_snapshot_ {        /* coherent state of a motor. see: mot_snapshot() */
+    uint8_t mode;               /* see: enum MOT_STATE */
+    uint8_t aktiv;
+    uint8_t dir;
+    uint8_t enable;             /* 1 = disenabled */
+    uint8_t ms_shift;           /* 0 = fine microstep. see: mot_set_microstep() */
+    int64_t position;           /* real_stepcount */
+    uint64_t stepcount;         /* current_stepcount */
+    uint64_t num_rest;          /* remaining steps of the job */
+    uint64_t runtime;           /* [us] */
+    uint64_t t;                 /* deadline of the last step, CLOCK_MONOTONIC [ns] */
+    uint32_t steptime;          /* current steptime [us] */
+    double omega;               /* current angle-speed [rad/s] */
+    double alpha;               /* current angle acceleration [s⁻2] */
+    int64_t latency;            /* lateness of the last step [ns] */
+    uint64_t max_latency;       /* [us] */
+    uint32_t overruns;          /* steps, that were later than one steptime. see: execute_step() */
+    uint64_t lost_time;         /* time skipped by the overruns [us] */
+    uint32_t seq;               /* number of updates */
 };
 
 struct _mot_ctl_ {             /* motor control */
     struct _mot_flags_ flag;   
+    uint16_t id;                /* motor number, used by mot_hist_dump_all() */
+    struct _mot_ctrl_ *ctrl;    /* controller, that steps the motor. see: new_mot() */
     
-    uint8_t mode;               /* used in mot_run function. see: enum MOT_STATE */
+    volatile uint8_t mode;      /* used in mot_run function. see: enum MOT_STATE. Only written by the driver thread */
     uint32_t steps_per_turn;    /* steps per revolution */
     
-    uint64_t max_latency;        
+    uint64_t max_latency;       /* [us] */
+    int64_t latency;            /* lateness of the last step [ns] */
+    uint64_t sum_latency;       /* sum of the lateness [ns]. mean = sum_latency / current_stepcount */
+    uint32_t overruns;          /* steps later than one steptime, the next deadline starts from the step */
+    uint64_t lost_time;         /* time skipped by the overruns [ns] */
     int64_t num_steps;          /* num_step < 0 parameter failed, num_step == 0 the motor runs endless */
     uint64_t num_rest;
     uint64_t current_stepcount; /* Current number of steps */
@@ -74,17 +279,133 @@ struct _mot_ctl_ {             /* motor control */
     double phi_per_step;        /* angle per step [rad] */
     double omega;               /* angle-speed{rad/s] */
     double current_omega;       /* current angle-speed{rad/s] */
+    double current_alpha;       /* current angle acceleration [s⁻2]. > 0 speed-up, < 0 speed-down */
     double a_start, a_stop;     /* spped-up[s⁻2], speed-down[s⁻2] */
+    double jerk;                /* [s⁻3]. > 0 S-curve ramps, see: mot_setparam_scurve() */
     
     struct _move_point_ *mc_mp;     /* Motion Point default = NULL; for define use function mot_start_md()  */
+    struct _step_table_ st;         /* precompiled steps. see: step_table.c */
+    int16_t heap_pos;               /* position in the heap of the driver thread. -1 = not running */
+    
+    struct _mot_ctl_ *lead;         /* linear move: dominant axis, that steps this motor. see: mot_move_line() */
+    struct _mot_ctl_ *follow;       /* linear move: first motor stepped by this motor */
+    struct _mot_ctl_ *next_follow;  /* linear move: next motor of the same lead */
+    uint64_t dda_steps;             /* linear move: lead = steps of the dominant axis, follower = own steps */
+    uint64_t dda_err;               /* linear move: Bresenham accumulator of a follower */
+    
+    struct _mot_move_ queue[MOT_QUEUE_SIZE];   /* move queue. see: mot_queue_move() */
+    uint32_t q_posted;              /* moves posted by the API */
+    uint32_t q_in;                  /* moves appended by the driver thread */
+    uint32_t q_out;                 /* moves compiled or dropped by the driver thread */
     
-    struct timeval start, stop, run_start;
+    uint64_t run_start;         /* CLOCK_MONOTONIC [ns] */
+    uint64_t step_time;         /* deadline of the last executed step [ns] */
+    uint64_t deadline;          /* deadline of the next step [ns] */
     struct _mot_pin_ mp;       /* motor gpio-pins */
+    uint32_t step_mask;         /* step pin in GPSET0/GPCLR0. see: MOT_GPIO_MEM */
+    struct _mot_ms_ ms;         /* microstep resolution. see: mot_set_microstep() */
+    
+    struct _seqlock_ hist_lock;     /* written by the driver thread. see: mot_hist_snapshot() */
+    struct _mot_hist_ hist_late;    /* step after the deadline [ns] */
+    struct _mot_hist_ hist_early;   /* step before the deadline [ns] */
+    
+    struct _seqlock_ snap_lock;     /* written by the driver thread. see: mot_snapshot() */
+    struct _mot_snapshot_ snap;
+    
+    uint32_t job_done;              /* finished jobs. futex of mot_wait_job() */
+    uint32_t job_wait;              /* 1 = the API waits in mot_wait_job() */
+    int job_fd;                     /* eventfd, -1 = off. see: mot_job_fd() */
+    void (*job_cb)(struct _mot_ctl_ *mc, void *arg);   /* see: mot_set_job_callback(). atomic, set by MOT_CMD_CALLBACK */
+    void *job_arg;
     
     struct _mot_ctl_ *next, *prev;
 };
 
-extern struct _mot_ctl_ *first_mc, *last_mc; 
+struct _mot_line_ {            /* linear move. see: mot_move_line() */
+    uint8_t n;                  /* number of motors */
+    struct _mot_ctl_ *mc[MOT_LINE_AXES];
+    int64_t steps[MOT_LINE_AXES];   /* > 0 CW, < 0 CCW */
+    uint32_t steptime;          /* steptime of the dominant axis [us] */
+    double a_start, a_stop;     /* speed-up, speed-down of the dominant axis [s⁻2] */
+};
+
+struct _mot_cmd_ {             /* slot of the command ring */
+    uint8_t cmd;                /* see: enum MOT_CMD */
+    uint8_t value;              /* dir or enable */
+    int *result;                /* EXIT_SUCCESS or EXIT_FAILURE, set by the driver thread. Storage of the waiting API, see: cmd_call() */
+    struct _mot_ctl_ *mc;
+    struct _move_point_ *mp;    /* MOT_CMD_START_MD: first motion point */
+    uint64_t num_steps;         /* MOT_CMD_PARAM */
+    double a_start, a_stop;     /* MOT_CMD_PARAM */
+    double jerk;                /* MOT_CMD_PARAM */
+    uint32_t steptime;          /* MOT_CMD_STEPTIME */
+    const struct _mot_line_ *line;  /* MOT_CMD_LINE. The API waits, so the data can be on its stack */
+    const struct _mot_pin_ *pin;    /* MOT_CMD_MICROSTEP: MS pins. The API waits */
+    const struct _mot_ms_ *ms;      /* MOT_CMD_MICROSTEP */
+    void (*cb)(struct _mot_ctl_ *mc, void *arg);   /* MOT_CMD_CALLBACK */
+    void *arg;                      /* MOT_CMD_CALLBACK */
+    struct _mot_ctl_ **list;        /* MOT_CMD_LIST: MOT_MAX motors. The API waits */
+};
+
+/*! --------------------------------------------------------------------
+ * Controller
+ * A driver thread with its motors, its command ring and its heap.
+ * A process can have several controllers, e.g. one per isolated core.
+ * see: new_mot_ctrl(). init_mot_ctl() creates the default controller.
+ */
+struct _heap_node_ {           /* min-heap of the running motors. see: driver_A4988.c */
+    uint64_t deadline;          /* copy of mc->deadline */
+    struct _mot_ctl_ *mc;
+};
+
+struct _mot_done_ {            /* finished job for the callback worker. see: mot_notify.c */
+    struct _mot_ctl_ *mc;       /* NULL = the worker ends */
+    void (*cb)(struct _mot_ctl_ *mc, void *arg);
+    void *arg;
+};
+
+struct _mot_ctrl_ {
+    uint16_t id;                /* controller number, used by mot_hist_dump_all() */
+    pthread_t thread;
+    struct _thread_state_ state;
+    struct _mot_thread_cfg_ cfg;    /* cpus and policy of the thread. see: mot_thread.c */
+    struct _mot_thread_cfg_ used;   /* set by the thread. see: mot_thread_get() */
+    
+    struct _mot_cmd_ cmd_ring[MOT_CMD_SIZE];   /* see: cmd_post() */
+    uint32_t cmd_head;          /* number of posted commands */
+    uint32_t cmd_tail;          /* number of executed commands. futex of cmd_wait() */
+    uint32_t tail_wait;         /* API threads in cmd_wait() */
+    pthread_mutex_t cmd_lock;   /* producers of the API and the callbacks. see: cmd_post() */
+    pthread_mutex_t exec_lock;  /* API as consumer without driver thread. see: api_commands() */
+    uint32_t sleep;             /* 1 = the driver thread waits for a command. see: wait_command() */
+    
+    struct _heap_node_ heap[MOT_MAX];   /* only used by the driver thread */
+    int heap_count;
+    uint32_t batch_mask;        /* step pins of one loop pass. see: flush_steps() */
+    uint8_t batch_dir;          /* a dir pin has changed in this loop pass */
+    
+    struct _mot_ctl_ *first_mc, *last_mc;   /* motors. Only used by the driver thread, the API uses mot_list() */
+    uint32_t mot_count;         /* motors in the list. Written by the driver thread, see: count_mot() */
+    
+    struct _mot_hist_ loop_hist;    /* duration of a loop pass of the driver thread */
+    struct _seqlock_ loop_hist_lock;
+    
+    uint64_t tele_next;         /* next telemetry records [ns]. 0 = off, see: mot_telemetry.c */
+    uint64_t report_t;          /* last job report [ns], see: job_ready() */
+    uint32_t report_skip;       /* jobs without report since report_t */
+    
+    struct _mot_done_ done_ring[MOT_DONE_SIZE];  /* written by the driver thread, read by the worker */
+    uint32_t done_head;         /* finished jobs with callback. futex of the worker */
+    uint32_t done_tail;         /* executed callbacks */
+    uint32_t done_lost;         /* callbacks dropped, the ring was full */
+    uint32_t worker_wait;       /* 1 = the worker sleeps on done_head, see: job_worker() */
+    pthread_t worker;           /* callback worker, not real time. see: mot_set_job_callback() */
+    uint8_t worker_run;
+    
+    struct _mot_ctrl_ *next;
+};
+
+extern struct _mot_ctrl_ *first_ctrl;          /* all controllers. see: new_mot_ctrl() */
 /*! --------------------------------------------------------------------
  * Motion Diagram
  */
@@ -95,18 +416,61 @@ struct _motion_diagram_ {
     double max_omega, min_omega;
     double max_t;
     struct _move_point_ *first_mp, *last_mp;    /* first and last move point of motion diagramm */
+    struct _move_point_ *mp_pool;               /* all move points of the diagram in one block. see: md_reserve() */
+    uint32_t mp_pool_size, mp_pool_used;        /* stream: mp_pool[1...] is a ring, mp_pool_used = written points */
+    struct _move_point_ *free_mp;               /* deleted points, see: kill_mp() */
+    uint8_t stream;                             /* see: enum MD_STREAM. default = MD_STREAM_OFF */
+    uint32_t mp_done;                           /* stream: ring points released by the driver thread */
+    uint32_t underrun;                          /* stream: steps without a move point in the ring */
     struct _motion_diagram_ *next, *prev;
 };
 
 extern struct _motion_diagram_ *first_md, *last_md;
 
+#define MD_POOL_INIT 64                 /* move points of a new diagram, the block grows by doubling */
+
+/*! --------------------------------------------------------------------
+ * @brief   streaming motion diagram. see: md_stream.c
+ */
+#define MD_STREAM_SIZE 256              /* move points in the ring. power of 2 */
+#define MD_STREAM_WAIT_US 1000          /* empty ring: the driver thread checks again after [us] */
+
+enum MD_STREAM {
+    MD_STREAM_OFF = 0,                  /* all points are in memory */
+    MD_STREAM_OPEN = 1,                 /* points are appended to the ring */
+    MD_STREAM_CLOSED = 2                /* end of stream, the motor stops after the last point */
+};
+
+/*! --------------------------------------------------------------------
+ * @brief   binary motion diagram file. see: md_file.c
+ *           header + packed array of points, little endian.
+ */
+#define MD_FILE_MAGIC   0x444d3441      /* "A4MD" */
+#define MD_FILE_VERSION 1
+
+struct _md_file_header_ {
+    uint32_t magic;                     /* MD_FILE_MAGIC */
+    uint16_t version;                   /* MD_FILE_VERSION */
+    uint16_t header_size;               /* offset of the first point [byte] */
+    uint8_t speedformat;                /* unit of speed and t, see: enum SPEEDFORMAT */
+    uint8_t point_size;                 /* sizeof(struct _md_file_point_) */
+    uint16_t reserved;
+    uint32_t count;                     /* number of points */
+    uint64_t reserved_2;
+};
+
+struct _md_file_point_ {
+    double speed;                       /* OMEGA [rad/s], FREQ or STEP [s⁻1], RPM [min⁻1] */
+    double t;                           /* [s], number of steps if speedformat == STEP */
+};
+
 struct _move_point_ {
     double omega;           /* angle-speed[rad/s] */
     double t;               /* [s] t >=  prev->t */
     double a;               /* angle acceleration */
     double phi;
     uint64_t steps;
-    uint64_t current_step;
+    uint64_t current_step;  /* compiled steps of the point in the last run. see: gen_md() */
     uint64_t sum_steps;
     
     double delta_omega;     /* omega - prev->omega */
@@ -119,18 +483,44 @@ struct _move_point_ {
 /*! --------------------------------------------------------------------
  * 
  */
-extern int init_mot_ctl(void);                            /* Initializes the driver thread */
+extern int init_mot_ctl(void);                            /* Initializes the default controller */
+extern struct _mot_ctrl_ *new_mot_ctrl (const struct _mot_thread_cfg_ *cfg);   /* a new controller with its own driver thread. cfg = NULL: see mot_thread.c */
+extern int kill_mot_ctrl (struct _mot_ctrl_ *ctrl);        /* motors are killed, the thread ends. NULL = default controller */
+extern int kill_all_mot_ctrl (void);                       /* at the end of the program */
+extern struct _mot_ctrl_ *mot_default_ctrl (void);         /* controller of init_mot_ctl() */
+extern int mot_ctrl_sync (struct _mot_ctrl_ *ctrl);        /* waits for the end of the loop pass. NULL = default controller */
+extern int mot_set_gpio (uint8_t gpio, uint32_t pulse_ns);   /* see: enum MOT_GPIO. Call before init_mot_ctl() */
+extern int init_mot_offline (void);                        /* controllers without thread, for benchmarks. see: mot_run_offline() */
+extern int mot_run_offline (uint64_t max_ns);              /* steps with a virtual clock. max_ns = 0: until all motors are idle */
+extern uint64_t mot_offline_now (void);                    /* virtual clock [ns] */
+extern int mot_set_sched_mode (uint8_t mode, uint32_t spin_us);  /* see: enum MOT_SCHED_MODE */
 
-extern struct _mot_ctl_ *new_mot (uint8_t pin_enable,   /* create dynamic memory for motor parameter */
+/*! --------------------------------------------------------------------
+ * @brief   cpus and policy of the driver thread. see: mot_thread.c
+ *           Call before init_mot_ctl().
+ */
+extern int mot_set_thread_policy (uint8_t policy, int priority);     /* see: enum MOT_POLICY */
+extern int mot_set_thread_deadline (uint32_t runtime_us, uint32_t deadline_us, uint32_t period_us);
+extern int mot_set_thread_cpus (const char *cpus);                   /* "3", "2-3", "0,2". "" = all cpus */
+extern int mot_thread_config (const char *fname);                    /* config file: key = value */
+extern int mot_thread_env (void);                                    /* A4988_CONFIG and A4988_<KEY>. used by mot_thread_default() */
+extern int mot_thread_default (struct _mot_thread_cfg_ *cfg);        /* configuration of the API, the file and the environment */
+extern void mot_thread_apply (struct _mot_ctrl_ *ctrl);              /* used by the driver thread */
+extern int mot_thread_get (struct _mot_ctrl_ *ctrl, struct _mot_thread_cfg_ *cfg);   /* used configuration and fallback. NULL = default controller */
+
+extern struct _mot_ctl_ *new_mot (struct _mot_ctrl_ *ctrl,   /* NULL = default controller. see: init_mot_ctl() */
+                                     uint8_t pin_enable,   /* create dynamic memory for motor parameter */
                                      uint8_t pin_dir,
                                      uint8_t pin_step,
                                      uint32_t steps_per_turn);
                                      
 extern int kill_mot (struct _mot_ctl_ *mc);
 extern int kill_all_mot (void);
-extern int count_mot (void);
+extern int count_mot (void);                            /* motors of all controllers */
+extern int mot_list (struct _mot_ctrl_ *ctrl, struct _mot_ctl_ **mc);   /* motors of the controller into mc[MOT_MAX]. NULL = default controller */
 extern int check_mc_pointer (struct _mot_ctl_ *mc);
 extern void show_mot_ctl (struct _mot_ctl_ *mc);
+extern int mot_snapshot (struct _mot_ctl_ *mc, struct _mot_snapshot_ *s);   /* position, speed, mode, counters of one step. Never blocks the driver thread */
 
 extern void mot_initpins (struct _mot_ctl_ *mc);        /* configures motor gpio  */
 
@@ -139,6 +529,13 @@ extern int mot_setparam (struct _mot_ctl_ *mc,        /* mc = motor handle */
                           uint64_t num_steps,           /* steps == 0 motor runs endless */
                           double a_start,               /* alpha Start [s⁻2] */
                           double a_stop);               /* alpha stop [s⁻2] */
+
+extern int mot_setparam_scurve (struct _mot_ctl_ *mc,  /* like mot_setparam() with jerk limited S-curve ramps */
+                                 uint8_t dir,
+                                 uint64_t num_steps,
+                                 double a_start,        /* max. alpha Start [s⁻2] */
+                                 double a_stop,         /* max. alpha stop [s⁻2] */
+                                 double jerk);          /* [s⁻3]. jerk == 0 => mot_setparam() */
                           
 extern int mot_start (struct _mot_ctl_ *mc);
 extern int mot_stop (struct _mot_ctl_ *mc);
@@ -147,6 +544,21 @@ extern int mot_on_step (struct _mot_ctl_ *mc, uint8_t dir);     /* dir==0 CW, di
 
 extern int mot_start_md (struct _motion_diagram_ *md);                  /* Engine start. The motor follows the motion diagram. */
 
+extern int mot_queue_move (struct _mot_ctl_ *mc,           /* append a move to the move queue */
+                           uint8_t dir,                     /* dir==0 CW, dir==1 CCW */
+                           uint64_t num_steps,              /* > 0 */
+                           uint32_t steptime,               /* cruise speed [us] */
+                           double a_start,                  /* alpha Start [s⁻2] */
+                           double a_stop);                  /* alpha stop [s⁻2] */
+extern int mot_queue_count (struct _mot_ctl_ *mc);          /* moves in the queue, that are not compiled */
+
+extern int mot_move_line (struct _mot_ctl_ **mc,             /* n motors move on a straight line */
+                          const int64_t *steps,              /* steps of each motor. > 0 CW, < 0 CCW */
+                          uint8_t n,                         /* max. MOT_LINE_AXES */
+                          uint32_t steptime,                 /* steptime of the dominant axis [us] */
+                          double a_start,                    /* alpha Start of the dominant axis [s⁻2] */
+                          double a_stop);                    /* alpha Stop of the dominant axis [s⁻2] */
+
 extern int mot_switch_enable (struct _mot_ctl_ *mc, uint8_t enable);    /* set chip enable/disenable */
 extern int mot_enable (struct _mot_ctl_ *mc);
 extern int mot_disenable (struct _mot_ctl_ *mc);
@@ -154,21 +566,164 @@ extern int mot_disenable (struct _mot_ctl_ *mc);
 extern int mot_set_dir (struct _mot_ctl_ *mc, uint8_t direction);       /* set the direction */
 
 extern int mot_set_steptime (struct _mot_ctl_ *mc, int steptime);       /* set speed in time per step [us] */
+extern int mot_set_ms_pins (struct _mot_ctl_ *mc, uint8_t ms1, uint8_t ms2, uint8_t ms3);   /* MOT_MS_PIN_NC = hard wired */
+extern int mot_set_microstep (struct _mot_ctl_ *mc, uint8_t fine, uint8_t coarse,          /* see: enum MOT_MS */
+                              double omega_coarse, double omega_fine);                    /* switch speeds [rad/s] */
 extern int mot_set_rpm (struct _mot_ctl_ *mc, double rpm);              /* set speed rpm [min⁻1] */
 extern int mot_set_Hz (struct _mot_ctl_ *mc, double Hz);                /* set speed f [s⁻1] */
 
+/*! --------------------------------------------------------------------
+ * @brief   histograms of the step timing. see: mot_hist.c
+ *           The histograms are collected over all jobs until mot_hist_reset().
+ */
+extern void mot_hist_add (struct _mot_hist_ *h, uint64_t v);                 /* used by the driver thread */
+extern uint64_t mot_hist_lower (int i);                                     /* smallest value of bucket i [ns] */
+extern uint64_t mot_hist_percentile (const struct _mot_hist_ *h, double p); /* p = 0.0 ... 1.0 */
+extern int mot_hist_snapshot (struct _mot_ctl_ *mc, struct _mot_hist_ *late, struct _mot_hist_ *early);
+extern int mot_loop_hist_snapshot (struct _mot_ctrl_ *ctrl, struct _mot_hist_ *loop);   /* ctrl = NULL: default controller */
+extern int mot_hist_reset (struct _mot_ctl_ *mc);                           /* mc == NULL: loop histogram */
+extern void mot_hist_dump (FILE *f, const char *name, const char *labels, const struct _mot_hist_ *h);
+extern int mot_hist_dump_all (FILE *f);                                     /* Prometheus text format */
+
+/*! --------------------------------------------------------------------
+ * Telemetry
+ * The driver threads publish the state of their motors periodically into 
+ * a POSIX shared memory ring. Other processes read it without blocking 
+ * the driver threads. see: mot_telemetry.c, monitor_A4988.c
+ */
+#define MOT_TELE_MAGIC 0x34393838u      /* "4988" */
+#define MOT_TELE_VERSION 1
+#define MOT_TELE_NAME "/a4988"          /* default name of the shared memory */
+
+struct _mot_tele_rec_ {        /* state of a motor */
+    struct _seqlock_ lock;      /* seq / 2 = number of writes of this slot */
+    uint16_t motor;             /* mc->id */
+    uint16_t ctrl;              /* controller id */
+    uint8_t mode;               /* see: enum MOT_STATE */
+    uint8_t aktiv;              /* flag.aktiv */
+    uint8_t dir;                /* MOT_CW, MOT_CCW */
+    uint8_t ms_shift;           /* one pulse = 1 << ms_shift steps. see: mot_set_microstep() */
+    uint64_t t;                 /* CLOCK_MONOTONIC of the driver thread [ns] */
+    int64_t position;           /* real_stepcount */
+    uint64_t stepcount;         /* current_stepcount of the job */
+    float omega;                /* current_omega [rad/s] */
+    float alpha;                /* current_alpha [s⁻2] */
+    uint32_t steptime;          /* current_steptime [us] */
+    int32_t latency;            /* lateness of the last step [ns] */
+    uint32_t mean_latency;      /* [ns] */
+    uint32_t max_latency;       /* [us] */
+};
+
+struct _mot_tele_ {            /* shared memory: header and ring */
+    uint32_t magic;             /* MOT_TELE_MAGIC */
+    uint16_t version;           /* MOT_TELE_VERSION */
+    uint16_t rec_size;          /* sizeof(struct _mot_tele_rec_) */
+    uint32_t slots;             /* records of the ring. power of 2 */
+    uint32_t period_us;         /* period of the records of a motor */
+    uint64_t head;              /* number of written records */
+    struct _mot_tele_rec_ rec[];
+};
+
+extern int mot_tele_open (const char *name, uint32_t slots, uint32_t period_us);   /* control process: create the ring */
+extern int mot_tele_close (void);
+extern int mot_tele_pass (struct _mot_ctrl_ *c, uint64_t now);                  /* used by the driver thread */
+extern struct _mot_tele_ *mot_tele_attach (const char *name);                   /* monitor process: read only */
+extern int mot_tele_detach (struct _mot_tele_ *t);
+extern int mot_tele_read (const struct _mot_tele_ *t, uint64_t n, struct _mot_tele_rec_ *rec);     /* record n */
+extern int mot_tele_latest (const struct _mot_tele_ *t, uint16_t motor, struct _mot_tele_rec_ *rec);  /* last record of a motor */
+
+/*! --------------------------------------------------------------------
+ * Completion of a job
+ * The driver thread signals the end of every job (MOT_JOB_READY): 
+ * mot_wait_job() wakes, the eventfd of the motor becomes readable and the
+ * callback is executed by the worker of the controller. see: mot_notify.c
+ */
+extern int mot_wait_job (struct _mot_ctl_ *mc, uint32_t timeout_ms);  /* waits until the motor is idle. timeout_ms = 0: no timeout */
+extern int mot_job_fd (struct _mot_ctl_ *mc);                         /* eventfd for poll(), select(), epoll. counter = finished jobs */
+extern int mot_set_job_callback (struct _mot_ctl_ *mc,               /* cb = NULL: off */
+                                  void (*cb)(struct _mot_ctl_ *mc, void *arg), 
+                                  void *arg);
+extern void mot_job_notify (struct _mot_ctl_ *mc);                    /* used by the driver thread at the end of a job */
+extern int mot_notify_start (struct _mot_ctrl_ *c);                   /* starts the callback worker. used by mot_set_job_callback() */
+extern int mot_notify_pass (struct _mot_ctrl_ *c);                    /* callbacks without worker. used by mot_run_offline() */
+extern int mot_notify_release (struct _mot_ctl_ *mc);                 /* used by kill_mot() */
+extern int mot_notify_stop (struct _mot_ctrl_ *c);                    /* used by kill_mot_ctrl() */
+
+/*! --------------------------------------------------------------------
+ * Real time safe mode
+ * mot_rt_init() locks the memory, allocates fixed pools for controllers,
+ * motors, diagrams and move points and prefaults the stacks of the driver
+ * threads. After the start no object of the driver is allocated with
+ * malloc(). see: mot_rt.c
+ */
+enum MOT_RT_POOL {
+    MOT_RT_CTRL = 0,            /* struct _mot_ctrl_ */
+    MOT_RT_MOT = 1,             /* struct _mot_ctl_ */
+    MOT_RT_MD = 2               /* struct _motion_diagram_ and its move points */
+};
+
+#define MOT_RT_POOLS 3
+#define MOT_RT_STACK_MIN 64             /* [KiB] */
+#define MOT_RT_STACK_RESERVE 32         /* not prefaulted: TLS and the frames of the thread [KiB] */
+#define MOT_RT_NO_CHECK UINT64_MAX      /* mot_rt_allocs(): compiled without MOT_RT_CHECK */
+
+struct _mot_rt_cfg_ {          /* limits of the pools */
+    uint16_t ctrls;             /* controllers */
+    uint16_t motors;            /* motors of all controllers */
+    uint16_t diagrams;          /* motion diagrams */
+    uint32_t points;            /* move points per diagram. min. MD_STREAM_SIZE + 1 */
+    uint32_t stack_kb;          /* stack of a driver thread [KiB]. min. MOT_RT_STACK_MIN */
+};
+
+struct _mot_rt_state_ {
+    uint8_t on;                 /* mot_rt_init() */
+    uint8_t locked;             /* mlockall() succeeded */
+    uint32_t size[MOT_RT_POOLS];        /* objects of the pools, see: enum MOT_RT_POOL */
+    uint32_t used[MOT_RT_POOLS];
+    uint32_t failed;            /* allocations with empty pool */
+    uint64_t allocs;            /* see: mot_rt_allocs() */
+};
+
+extern int mot_rt_default (struct _mot_rt_cfg_ *cfg);                /* default limits */
+extern int mot_rt_init (const struct _mot_rt_cfg_ *cfg);             /* NULL = default limits. Call before init_mot_ctl() */
+extern int mot_rt_get (struct _mot_rt_state_ *s);
+extern uint64_t mot_rt_allocs (void);                                /* malloc() of the driver threads after their start */
+extern void *mot_rt_alloc (uint8_t pool);                            /* see: enum MOT_RT_POOL. used by new_mot_ctrl(), new_mot(), new_md() */
+extern int mot_rt_free (uint8_t pool, void *obj);
+extern struct _move_point_ *mot_rt_points (struct _motion_diagram_ *md, uint32_t *n);  /* block of a diagram. used by new_md() */
+extern int mot_rt_is_points (const struct _move_point_ *mp);         /* used by md_reserve(), kill_md() */
+extern int mot_rt_thread_attr (pthread_attr_t *attr);                /* stack size. used by new_mot_ctrl() */
+extern void mot_rt_thread (void);                                    /* stack prefault. used by run_A4988() */
+
 /*! --------------------------------------------------------------------
  * @brief   calculation functions
  */
 extern double calc_omega (uint32_t steps_per_turn, uint32_t steptime);  /* function for calculation of angle speed */
 extern double calc_steps_for_step_down (struct _mot_ctl_ *mc);
+extern double calc_phi_for_scurve_down (double omega, double alpha, double a_stop, double jerk);  /* braking angle of the S-curve [rad] */
+
+/*! --------------------------------------------------------------------
+ * @brief   step table. see: step_table.c
+ */
+extern int mot_set_ramp_engine (uint8_t engine);                    /* see: enum MOT_RAMP_ENGINE. Used by the next mot_start() */
+extern int step_table_start (struct _mot_ctl_ *mc);                 /* compile the first chunks of a job */
+extern int step_table_stop (struct _mot_ctl_ *mc);                  /* recompile with speed-down from the current step */
+extern int step_table_fill (struct _mot_ctl_ *mc);                  /* fill the back chunk, if it is empty */
+extern struct _step_entry_ *step_table_peek (struct _mot_ctl_ *mc); /* next step or NULL at end of job */
+extern uint32_t step_table_group (struct _mot_ctl_ *mc, uint32_t n, uint32_t *us);  /* next n steps as one pulse. see: mot_set_microstep() */
 
 /*! --------------------------------------------------------------------
  * @brief   motion diagram
  */
 extern struct _motion_diagram_ *new_md (struct _mot_ctl_ *mc);      /* A new diagram is created. */
 extern struct _motion_diagram_ *new_md_from_file (struct _mot_ctl_ *mc, const char *fname, uint8_t speedformat);    /* speedformat see: enum SPEEDFORMAT */
+extern struct _motion_diagram_ *new_md_from_bin (struct _mot_ctl_ *mc, const char *fname);  /* binary file, see: md_file.c */
+extern int md_convert (const char *src, const char *dst, uint8_t speedformat);              /* text file -> binary file */
+extern struct _motion_diagram_ *new_md_from_stream (struct _mot_ctl_ *mc, int fd, uint8_t speedformat);  /* pipe, FIFO or socket, see: md_stream.c */
+extern int md_stream_open (const char *path);                       /* "-" = stdin, FIFO or UNIX socket. return fd */
+extern struct _move_point_ *md_stream_alloc (struct _motion_diagram_ *md);  /* free slot of the ring, used by add_mp_Hz() */
 extern int kill_md (struct _motion_diagram_ *md);
+extern int md_reserve (struct _motion_diagram_ *md, uint32_t n);   /* space for n move points. Not while the motor runs the diagram */
 extern int kill_all_md (void);
 extern int count_md (void);
 extern int check_md_pointer (struct _motion_diagram_ *md);          /* Checks whether a record exists. */
@@ -181,6 +736,7 @@ extern struct _move_point_ *add_mp_omega (struct _motion_diagram_ *md, double om
 extern struct _move_point_ *add_mp_rpm (struct _motion_diagram_ *md, double rpm, double t);
 
 extern struct _move_point_ *add_mp_steps (struct _motion_diagram_ *md, double Hz, double steps);
+extern struct _move_point_ *add_mp (struct _motion_diagram_ *md, uint8_t speedformat, double speed, double t);   /* see: enum SPEEDFORMAT */
 
 extern int kill_mp (struct _move_point_ *mp);                        /* delete move point in motion diagram */
 extern int kill_all_mp (struct _motion_diagram_ *md);                /* delete all move points off motion diagram */
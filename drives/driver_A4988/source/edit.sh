@@ -3,5 +3,7 @@
 # opens all files with geany
 rth="../../../tools/rpi_tools/rpi_tools.h"
 rtc="../../../tools/rpi_tools/rpi_tools.c"
+gmh="../../../tools/gpio/gpio_mem.h"
+gmc="../../../tools/gpio/gpio_mem.c"
 
-geany -s test_driver_A4988.c driver_A4988.c driver_A4988.h $rtc $rth Makefile run.sh edit.sh ../readme.txt &
+geany -s test_driver_A4988.c driver_A4988.c driver_A4988.h step_table.c mot_hist.c md_file.c md_stream.c mot_thread.c mot_telemetry.c mot_notify.c mot_rt.c convert_md.c bench_offline_A4988.c sim_md.c monitor_A4988.c $rtc $rth $gmc $gmh ../../../tools/seqlock/seqlock.h ../../../tools/futex/futex.h ../../../tools/rt_log/rt_log.c ../../../tools/rt_log/rt_log.h Makefile run.sh edit.sh ../readme.txt &
@@ -0,0 +1,160 @@
+/*! --------------------------------------------------------------------
+ *  @file    md_file.c
+ *  @date    10-16-2026
+ *  @name    Ulrich Buettemeier
+ *  @brief   binary motion diagram file.
+ *           struct _md_file_header_ and a packed array of
+ *           struct _md_file_point_ (see: driver_A4988.h).
+ *           new_md_from_bin() maps the file and reads the points in place:
+ *           no parser, and the block of the move points is allocated
+ *           once with the number of points of the file.
+ *           The derived values of a move point (steps, a, phi) depend on
+ *           the steps per turn of the motor, so they are calculated at load
+ *           time and not stored in the file.
+ *           md_convert() converts a text file (e.g. curve_1.dat).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../../../tools/rt_log/rt_log.h"
+#include "driver_A4988.h"
+
+#define MAX_CHAR 1024
+
+/*! --------------------------------------------------------------------
+ * @brief   a new motion diagram is created from a binary file
+ * @return  NULL = file not found or wrong format
+ */
+struct _motion_diagram_ *new_md_from_bin (struct _mot_ctl_ *mc, const char *fname)
+{
+    const struct _md_file_header_ *h;
+    const struct _md_file_point_ *p;
+    struct _motion_diagram_ *md;
+    struct stat st;
+    uint32_t i, n;
+    double last;
+    void *map;
+    int fd;
+
+    if (!mc || !fname)
+        return NULL;
+
+    if ((fd = open (fname, O_RDONLY)) < 0) {
+        rt_log ("-- File <%s> not found\n", fname);
+        return NULL;
+    }
+    if ((fstat (fd, &st) != 0) || ((size_t)st.st_size < sizeof(struct _md_file_header_))) {
+        rt_log ("-- <%s>: no motion diagram\n", fname);
+        close (fd);
+        return NULL;
+    }
+    map = mmap (NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close (fd);
+    if (map == MAP_FAILED) {
+        rt_log ("-- <%s>: mmap failed\n", fname);
+        return NULL;
+    }
+
+    h = (const struct _md_file_header_ *)map;
+    if ((h->magic != MD_FILE_MAGIC) || (h->version != MD_FILE_VERSION) ||
+        (h->header_size < sizeof(struct _md_file_header_)) || (h->header_size % sizeof(double)) ||
+        (h->point_size != sizeof(struct _md_file_point_)) || (h->speedformat > STEP) ||
+        ((size_t)st.st_size < h->header_size) ||                           /* count without overflow */
+        (h->count > ((size_t)st.st_size - h->header_size) / h->point_size)) {
+        rt_log ("-- <%s>: wrong format or version\n", fname);
+        munmap (map, (size_t)st.st_size);
+        return NULL;
+    }
+    p = (const struct _md_file_point_ *)((const uint8_t *)map + h->header_size);
+    madvise (map, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    for (i = 0, n = h->count, last = 0.0; i < h->count; i++) {    /* + zero crossings */
+        if (((last > 0.0) && (p[i].speed < 0.0)) || ((last < 0.0) && (p[i].speed > 0.0)))
+            n++;
+        last = p[i].speed;
+    }
+
+    md = new_md (mc);
+    if ((md == NULL) || (md_reserve (md, n + 1) != EXIT_SUCCESS)) {   /* + first point of new_md() */
+        kill_md (md);
+        munmap (map, (size_t)st.st_size);
+        return NULL;
+    }
+
+    for (i = 0; i < h->count; i++)
+        add_mp (md, h->speedformat, p[i].speed, p[i].t);
+
+    munmap (map, (size_t)st.st_size);
+
+    return md;
+}
+/*! --------------------------------------------------------------------
+ * @brief   converts a text file to a binary file
+ * @param   src = text file, format see: new_md_from_file()
+ *          speedformat = [OMEGA, FREQ, RPM, STEP]; see: enum SPEEDFORMAT
+ */
+int md_convert (const char *src, const char *dst, uint8_t speedformat)
+{
+    struct _md_file_header_ h;
+    struct _md_file_point_ p;
+    FILE *in, *out;
+    char str[MAX_CHAR];
+    float_t speed, t;
+    uint16_t n;
+    int err;
+
+    if (speedformat > STEP)
+        return EXIT_FAILURE;
+
+    if ((in = fopen (src, "rt")) == NULL) {
+        rt_log ("-- File <%s> not found\n", src);
+        return EXIT_FAILURE;
+    }
+    if ((out = fopen (dst, "wb")) == NULL) {
+        rt_log ("-- Can't create <%s>\n", dst);
+        fclose (in);
+        return EXIT_FAILURE;
+    }
+
+    memset (&h, 0, sizeof(h));
+    h.magic = MD_FILE_MAGIC;
+    h.version = MD_FILE_VERSION;
+    h.header_size = sizeof(struct _md_file_header_);
+    h.speedformat = speedformat;
+    h.point_size = sizeof(struct _md_file_point_);
+    err = (fwrite (&h, sizeof(h), 1, out) != 1);    /* count is written at the end */
+
+    while (!err && fgets (str, MAX_CHAR, in)) {
+        n = 0;
+        while (str[n] == ' ') n++;
+        if (str[n] != '#') {
+            int anz_arg;
+            if ((anz_arg = sscanf (str, "%f %f\n", &speed, &t)) != 2) {
+                if (anz_arg > 0)
+                    rt_log ("param count incorrekt: %s\n", str);
+            } else {
+                p.speed = speed;
+                p.t = t;
+                err = (fwrite (&p, sizeof(p), 1, out) != 1);
+                h.count++;
+            }
+        }
+    }
+    fclose (in);
+
+    if (!err)
+        err = (fseek (out, 0, SEEK_SET) != 0) || (fwrite (&h, sizeof(h), 1, out) != 1);
+    if ((fclose (out) != 0) || err) {
+        rt_log ("-- write error <%s>\n", dst);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,166 @@
+/*! --------------------------------------------------------------------
+ *  @file    md_stream.c
+ *  @date    10-17-2026
+ *  @name    Ulrich Buettemeier
+ *  @brief   streaming motion diagram.
+ *           The move points are read from a pipe, FIFO or UNIX socket
+ *           (text format of new_md_from_file()) and written to a ring of
+ *           MD_STREAM_SIZE points, while the motor runs the diagram.
+ *           The driver thread releases the points behind the current one
+ *           (md->mp_done). If the ring is full, the reader waits and
+ *           doesn't read the input, so the writer of the pipe is blocked.
+ *           If the ring is empty, the driver thread makes no steps and
+ *           checks again after MD_STREAM_WAIT_US (md->underrun).
+ * @example
+ *      int fd = md_stream_open ("/tmp/planner.fifo");
+ *      md = new_md_from_stream (m1, fd, RPM);        // returns at end of stream
+ *      mot_wait_job (m1, 0);
+ *      kill_md (md);
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "../../../tools/rt_log/rt_log.h"
+#include "driver_A4988.h"
+
+#define MAX_CHAR 1024
+
+/*! --------------------------------------------------------------------
+ * @return  1 = the motor runs the diagram
+ */
+static int md_running (struct _motion_diagram_ *md)
+{
+    return (md->mc && (__atomic_load_n (&md->mc->mc_mp, __ATOMIC_ACQUIRE) == md->first_mp));
+}
+/*! --------------------------------------------------------------------
+ * @brief   free slot of the ring. Waits, while the ring is full.
+ * @return  NULL = the motor doesn't run the diagram any more (mot_stop)
+ */
+struct _move_point_ *md_stream_alloc (struct _motion_diagram_ *md)
+{
+    while (md->mp_pool_used - __atomic_load_n (&md->mp_done, __ATOMIC_ACQUIRE) >= MD_STREAM_SIZE) {
+        if (!md_running (md))
+            return NULL;
+        usleep (MD_STREAM_WAIT_US);
+    }
+
+    return &md->mp_pool[1 + (md->mp_pool_used++ & (MD_STREAM_SIZE - 1))];    /* mp_pool[0] = first point */
+}
+/*! --------------------------------------------------------------------
+ * @brief   A new motion diagram is read from a stream. The motor is
+ *           started, when the ring is full or at the end of the stream.
+ *           The function returns at the end of the stream, the motor
+ *           runs until the last point. fd is closed.
+ * @param   fd = pipe, FIFO or socket. see: md_stream_open()
+ *          speedformat = [OMEGA, FREQ, RPM, STEP]; see: enum SPEEDFORMAT
+ * @return  NULL = error. Delete the diagram with kill_md() at the end of the job.
+ */
+struct _motion_diagram_ *new_md_from_stream (struct _mot_ctl_ *mc, int fd, uint8_t speedformat)
+{
+    struct _motion_diagram_ *md;
+    char str[MAX_CHAR];
+    float_t speed, t;
+    uint8_t started = 0;
+    uint16_t n;
+    FILE *f;
+
+    if (!mc || (fd < 0) || (speedformat > STEP))
+        return NULL;
+
+    if ((f = fdopen (fd, "r")) == NULL) {
+        rt_log ("-- stream: fdopen failed\n");
+        close (fd);
+        return NULL;
+    }
+
+    md = new_md (mc);
+    if (md_reserve (md, MD_STREAM_SIZE + 1) != EXIT_SUCCESS) {
+        fclose (f);
+        kill_md (md);
+        return NULL;
+    }
+    md->mp_pool_used = 0;                           /* written ring points */
+    md->stream = MD_STREAM_OPEN;
+
+    while (fgets (str, MAX_CHAR, f)) {
+        n = 0;
+        while (str[n] == ' ') n++;
+        if (str[n] == '#')
+            continue;
+
+        int anz_arg;
+        if ((anz_arg = sscanf (str, "%f %f\n", &speed, &t)) != 2) {
+            if (anz_arg > 0)
+                rt_log ("param count incorrekt: %s\n", str);
+            continue;
+        }
+
+        if (!started && (md->mp_pool_used + 2 >= MD_STREAM_SIZE)) {        /* a point can add a zero crossing */
+            if (mot_start_md (md) != EXIT_SUCCESS)
+                break;
+            started = 1;
+        }
+        if (!add_mp (md, speedformat, speed, t) && started && !md_running (md)) {
+            rt_log ("-- stream: motor is stopped\n");
+            break;
+        }
+    }
+    fclose (f);
+
+    __atomic_store_n (&md->stream, MD_STREAM_CLOSED, __ATOMIC_RELEASE);
+    if (!started)
+        mot_start_md (md);
+
+    return md;
+}
+/*! --------------------------------------------------------------------
+ * @brief   opens a stream for new_md_from_stream()
+ * @param   path = "-" stdin, FIFO, file or UNIX socket (connect)
+ * @return  fd or -1
+ */
+int md_stream_open (const char *path)
+{
+    struct sockaddr_un addr;
+    struct stat st;
+    int fd;
+
+    if (!path)
+        return -1;
+
+    if (!strcmp (path, "-"))
+        return dup (STDIN_FILENO);
+
+    if (stat (path, &st) != 0) {
+        rt_log ("-- <%s> not found\n", path);
+        return -1;
+    }
+
+    if (S_ISSOCK (st.st_mode)) {
+        if (strlen (path) >= sizeof(addr.sun_path))
+            return -1;
+        memset (&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        strcpy (addr.sun_path, path);
+        if ((fd = socket (AF_UNIX, SOCK_STREAM, 0)) < 0)
+            return -1;
+        if (connect (fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+            rt_log ("-- <%s>: connect failed\n", path);
+            close (fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    if ((fd = open (path, O_RDONLY)) < 0)           /* FIFO: waits for the writer */
+        rt_log ("-- <%s>: open failed\n", path);
+
+    return fd;
+}
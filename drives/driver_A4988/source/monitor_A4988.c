@@ -0,0 +1,99 @@
+/*! ---------------------------------------------------------------------
+ * @file    monitor_A4988.c
+ * @date    10-17-2026
+ * @name    Ulrich Buettemeier
+ * @brief   shows the live state of all motors of a control process.
+ *          The records are read from the shared memory ring of
+ *          mot_tele_open() (see: mot_telemetry.c), the control process
+ *          is not disturbed.
+ *          usage: monitor_A4988 [name] [period ms] [count]
+ *          default: /a4988, 100 ms, count = 0: endless (Ctrl-C)
+ * @example monitor_A4988 /a4988 50
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "driver_A4988.h"
+#include "../../../tools/rpi_tools/rpi_tools.h"
+
+#define MONITOR_MOTORS 256          /* motors shown */
+
+/*! --------------------------------------------------------------------
+ * @brief   sorted by controller and motor
+ */
+static int cmp_rec (const void *a, const void *b)
+{
+    const struct _mot_tele_rec_ *ra = a, *rb = b;
+
+    if (ra->ctrl != rb->ctrl)
+        return (int)ra->ctrl - (int)rb->ctrl;
+    return (int)ra->motor - (int)rb->motor;
+}
+/*! --------------------------------------------------------------------
+ * @brief   last record of every motor in the ring
+ * @return  number of motors
+ */
+static int read_motors (const struct _mot_tele_ *t, struct _mot_tele_rec_ *rec, uint64_t *head)
+{
+    static uint8_t seen[65536];
+    struct _mot_tele_rec_ r;
+    uint64_t n;
+    int count = 0, i;
+
+    *head = __atomic_load_n (&t->head, __ATOMIC_ACQUIRE);
+    for (n = *head; n && (*head - n < t->slots) && (count < MONITOR_MOTORS); n--) {
+        if ((mot_tele_read (t, n - 1, &r) != EXIT_SUCCESS) || seen[r.motor])
+            continue;
+        seen[r.motor] = 1;
+        rec[count++] = r;
+    }
+    for (i = 0; i < count; i++)
+        seen[rec[i].motor] = 0;
+    qsort (rec, count, sizeof(struct _mot_tele_rec_), cmp_rec);
+
+    return count;
+}
+/*! --------------------------------------------------------------------
+ *
+ */
+int main (int argc, char *argv[])
+{
+    static struct _mot_tele_rec_ rec[MONITOR_MOTORS];
+    const char *name = (argc > 1) ? argv[1] : MOT_TELE_NAME;
+    uint32_t period = (argc > 2) ? (uint32_t)atoi (argv[2]) : 100;
+    long count = (argc > 3) ? atol (argv[3]) : 0;
+    struct _mot_tele_ *t;
+    uint64_t head, now;
+    long loop;
+    int n, i;
+
+    if (!period) {
+        printf ("usage: monitor_A4988 [name] [period ms] [count]\n");
+        return EXIT_FAILURE;
+    }
+    if ((t = mot_tele_attach (name)) == NULL)
+        return EXIT_FAILURE;
+
+    printf ("-- %s: %u records, one record per motor every %u us\n", name, t->slots, t->period_us);
+    for (loop = 0; !count || (loop < count); loop++) {
+        n = read_motors (t, rec, &head);
+        now = monotonic_ns ();
+        printf ("-- records=%llu\n", (long long unsigned)head);
+        printf ("-- ctrl motor  mode aktiv dir  position   stepcount  omega[s⁻1]  steptime[us]  latency[us]  max[us]  age[ms]\n");
+        for (i = 0; i < n; i++) {
+            printf ("-- %4u %5u  0x%02x %5u %3u %9lli  %10llu  %10.3f  %12u  %11.1f  %7u  %7.1f\n",
+                     rec[i].ctrl, rec[i].motor, rec[i].mode, rec[i].aktiv, rec[i].dir,
+                     (long long int)rec[i].position, (long long unsigned)rec[i].stepcount,
+                     rec[i].omega, rec[i].steptime, (double)rec[i].latency / 1000.0, rec[i].max_latency,
+                     (now > rec[i].t) ? (double)(now - rec[i].t) / 1e6 : 0.0);
+        }
+        usleep (period * 1000);
+    }
+    mot_tele_detach (t);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,180 @@
+/*! --------------------------------------------------------------------
+ *  @file    mot_hist.c
+ *  @date    10-16-2026
+ *  @name    Ulrich Buettemeier
+ *  @brief   log-linear histograms of the step timing.
+ *           Every power of 2 is divided into MOT_HIST_SUB linear buckets,
+ *           so the relative resolution is 12.5 % over the full range
+ *           (0 ns ... 8.6 s). mot_hist_add() is used on the hot path of
+ *           the driver thread: no allocation, no division.
+ *           The driver thread writes the histograms in a seqlock, the
+ *           snapshot functions copy them without blocking the driver thread.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../../../tools/seqlock/seqlock.h"
+#include "driver_A4988.h"
+
+/*! --------------------------------------------------------------------
+ * @return  bucket of value v [ns]
+ */
+static inline int hist_index (uint64_t v)
+{
+    int msb, i;
+
+    if (v < MOT_HIST_SUB)
+        return (int)v;
+
+    msb = 63 - __builtin_clzll (v);
+    i = (msb - MOT_HIST_SUB_BITS + 1) * MOT_HIST_SUB + (int)((v >> (msb - MOT_HIST_SUB_BITS)) & (MOT_HIST_SUB - 1));
+
+    return (i < MOT_HIST_BUCKETS) ? i : MOT_HIST_BUCKETS - 1;
+}
+/*! --------------------------------------------------------------------
+ * @return  smallest value of bucket i [ns]
+ */
+uint64_t mot_hist_lower (int i)
+{
+    int g = i / MOT_HIST_SUB;
+
+    if (g == 0)
+        return (uint64_t)i;
+
+    return (uint64_t)(MOT_HIST_SUB + i % MOT_HIST_SUB) << (g - 1);
+}
+/*! --------------------------------------------------------------------
+ * @brief   used by the driver thread
+ */
+void mot_hist_add (struct _mot_hist_ *h, uint64_t v)
+{
+    h->count[hist_index (v)]++;
+    h->n++;
+    h->sum += v;
+    if (v > h->max)
+        h->max = v;
+}
+/*! --------------------------------------------------------------------
+ * @param   p = 0.0 ... 1.0
+ * @return  upper limit of the bucket with the p-quantile [ns]
+ */
+uint64_t mot_hist_percentile (const struct _mot_hist_ *h, double p)
+{
+    uint64_t sum = 0, target;
+    int i;
+
+    if (!h->n)
+        return 0;
+
+    target = (uint64_t)(p * (double)h->n);
+    if (target >= h->n)
+        target = h->n - 1;
+
+    for (i = 0; i < MOT_HIST_BUCKETS - 1; i++) {
+        sum += h->count[i];
+        if (sum > target)
+            return (mot_hist_lower (i + 1) - 1 < h->max) ? mot_hist_lower (i + 1) - 1 : h->max;
+    }
+
+    return h->max;
+}
+/*! --------------------------------------------------------------------
+ * @brief   copy of the histograms of a motor. late or early can be NULL.
+ */
+int mot_hist_snapshot (struct _mot_ctl_ *mc, struct _mot_hist_ *late, struct _mot_hist_ *early)
+{
+    uint32_t seq;
+
+    if (!mc)
+        return EXIT_FAILURE;
+
+    do {
+        seq = seqlock_read_begin (&mc->hist_lock);
+        if (late)
+            memcpy (late, &mc->hist_late, sizeof(struct _mot_hist_));
+        if (early)
+            memcpy (early, &mc->hist_early, sizeof(struct _mot_hist_));
+    } while (seqlock_read_retry (&mc->hist_lock, seq));
+
+    return EXIT_SUCCESS;
+}
+/*! --------------------------------------------------------------------
+ * @brief   copy of the loop histogram of the driver thread of a controller
+ * @param   ctrl = NULL: default controller
+ */
+int mot_loop_hist_snapshot (struct _mot_ctrl_ *ctrl, struct _mot_hist_ *loop)
+{
+    uint32_t seq;
+
+    if (!ctrl)
+        ctrl = mot_default_ctrl ();
+    if (!ctrl || !loop)
+        return EXIT_FAILURE;
+
+    do {
+        seq = seqlock_read_begin (&ctrl->loop_hist_lock);
+        memcpy (loop, &ctrl->loop_hist, sizeof(struct _mot_hist_));
+    } while (seqlock_read_retry (&ctrl->loop_hist_lock, seq));
+
+    return EXIT_SUCCESS;
+}
+/*! --------------------------------------------------------------------
+ * @brief   Prometheus text format. The buckets are cumulative,
+ *           empty buckets are not printed.
+ * @param   name = metric name
+ *          labels = e.g. motor="1", can be NULL
+ * @example a4988_step_late_ns_bucket{motor="1",le="15"} 12
+ */
+void mot_hist_dump (FILE *f, const char *name, const char *labels, const struct _mot_hist_ *h)
+{
+    const char *sep = (labels && *labels) ? "," : "";
+    uint64_t sum = 0;
+    int i;
+
+    if (!labels)
+        labels = "";
+
+    fprintf (f, "# TYPE %s histogram\n", name);
+    for (i = 0; i < MOT_HIST_BUCKETS - 1; i++) {
+        if (!h->count[i])
+            continue;
+        sum += h->count[i];
+        fprintf (f, "%s_bucket{%s%sle=\"%llu\"} %llu\n", name, labels, sep,
+                 (long long unsigned)(mot_hist_lower (i + 1) - 1), (long long unsigned)sum);
+    }
+    fprintf (f, "%s_bucket{%s%sle=\"+Inf\"} %llu\n", name, labels, sep, (long long unsigned)h->n);
+    fprintf (f, "%s_sum{%s} %llu\n", name, labels, (long long unsigned)h->sum);
+    fprintf (f, "%s_count{%s} %llu\n", name, labels, (long long unsigned)h->n);
+}
+/*! --------------------------------------------------------------------
+ * @brief   histograms of all motors and of the driver threads.
+ *           Must be called by the thread, that uses the API.
+ */
+int mot_hist_dump_all (FILE *f)
+{
+    static struct _mot_hist_ late, early;
+    struct _mot_ctl_ *mc[MOT_MAX];
+    struct _mot_ctrl_ *c;
+    char labels[32];
+    int i, n;
+
+    if (!f)
+        return EXIT_FAILURE;
+
+    for (c = first_ctrl; c; c = c->next) {
+        for (i = 0, n = mot_list (c, mc); i < n; i++) {        /* copy of the driver thread */
+            mot_hist_snapshot (mc[i], &late, &early);
+            snprintf (labels, sizeof(labels), "ctrl=\"%u\",motor=\"%u\"", c->id, mc[i]->id);
+            mot_hist_dump (f, "a4988_step_late_ns", labels, &late);
+            mot_hist_dump (f, "a4988_step_early_ns", labels, &early);
+        }
+        mot_loop_hist_snapshot (c, &late);
+        snprintf (labels, sizeof(labels), "ctrl=\"%u\"", c->id);
+        mot_hist_dump (f, "a4988_loop_ns", labels, &late);
+    }
+
+    return EXIT_SUCCESS;
+}
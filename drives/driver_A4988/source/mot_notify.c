@@ -0,0 +1,254 @@
+/*! --------------------------------------------------------------------
+ *  @file    mot_notify.c
+ *  @date    10-17-2026
+ *  @name    Ulrich Buettemeier
+ *  @brief   completion of the jobs of a motor (MOT_JOB_READY) without
+ *           polling the motor.
+ *           mot_wait_job():   the API thread sleeps on the futex
+ *                             mc->job_done, optional with timeout.
+ *           mot_job_fd():     eventfd of the motor for the event loop of
+ *                             the application (poll, select, epoll).
+ *           mot_set_job_callback(): the callback is executed by a worker
+ *                             thread of the controller (not real time).
+ *           The driver thread writes the finished job into a ring (single
+ *           producer, single consumer), it never waits for the worker.
+ * @example
+ *      mot_start (m1);
+ *      mot_wait_job (m1, 0);                   // returns at the end of the job
+ *
+ *      struct pollfd p = { .fd = mot_job_fd (m1), .events = POLLIN };
+ *      uint64_t n;
+ *      if ((poll (&p, 1, 1000) > 0) && (read (p.fd, &n, sizeof(n)) == sizeof(n)))
+ *          rt_log ("%llu jobs finished\n", (long long unsigned)n);
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/eventfd.h>
+
+#include "../../../tools/rpi_tools/rpi_tools.h"
+#include "../../../tools/futex/futex.h"
+#include "../../../tools/rt_log/rt_log.h"
+#include "driver_A4988.h"
+
+/*! --------------------------------------------------------------------
+ * @brief   end of a job. used by the driver thread (job_ready()), after
+ *           the state of the motor is published (see: mot_snapshot()).
+ *           No call blocks: futex_wake, write to a non blocking eventfd.
+ */
+void mot_job_notify (struct _mot_ctl_ *mc)
+{
+    struct _mot_ctrl_ *c = mc->ctrl;
+    int fd = __atomic_load_n (&mc->job_fd, __ATOMIC_ACQUIRE);
+    void (*cb)(struct _mot_ctl_ *mc, void *arg) = __atomic_load_n (&mc->job_cb, __ATOMIC_ACQUIRE);
+    uint64_t one = 1;
+    uint32_t head;
+
+    __atomic_fetch_add (&mc->job_done, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n (&mc->job_wait, __ATOMIC_SEQ_CST))     /* see: mot_wait_job() */
+        futex_wake (&mc->job_done, INT32_MAX);
+
+    if (cb) {
+        head = c->done_head;
+        if (head - __atomic_load_n (&c->done_tail, __ATOMIC_ACQUIRE) >= MOT_DONE_SIZE) {
+            c->done_lost++;                                     /* the worker is too slow */
+        } else {
+            c->done_ring[head & (MOT_DONE_SIZE - 1)] = (struct _mot_done_){ .mc = mc, .cb = cb, .arg = __atomic_load_n (&mc->job_arg, __ATOMIC_RELAXED) };
+            __atomic_store_n (&c->done_head, head + 1, __ATOMIC_SEQ_CST);
+            if (__atomic_load_n (&c->worker_wait, __ATOMIC_SEQ_CST))   /* see: job_worker() */
+                futex_wake (&c->done_head, 1);
+        }
+    }
+
+    if ((fd >= 0) && (write (fd, &one, sizeof(one)) != sizeof(one)))    /* counter overflow: never */
+        return;
+}
+/*! --------------------------------------------------------------------
+ * @brief   waits until the motor is idle and no move of mot_queue_move()
+ *           is waiting. Without driver thread (see: init_mot_offline())
+ *           the motors run with mot_run_offline().
+ * @param   timeout_ms = 0: no timeout
+ * @return  EXIT_FAILURE = timeout
+ */
+int mot_wait_job (struct _mot_ctl_ *mc, uint32_t timeout_ms)
+{
+    uint64_t end = (timeout_ms) ? monotonic_ns () + (uint64_t)timeout_ms * 1000000ull : 0;
+    struct _mot_snapshot_ s;
+    uint32_t done;
+
+    if (!mc)
+        return EXIT_FAILURE;
+
+    if (!mc->ctrl->state.run) {                                 /* virtual clock */
+        mot_run_offline ((uint64_t)timeout_ms * 1000000ull);
+        mot_snapshot (mc, &s);
+        return (!s.aktiv && !mot_queue_count (mc)) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    for (;;) {
+        done = __atomic_load_n (&mc->job_done, __ATOMIC_SEQ_CST);
+        mot_snapshot (mc, &s);
+        if (!s.aktiv && !mot_queue_count (mc))
+            return EXIT_SUCCESS;
+        if (end && (monotonic_ns () >= end))
+            return EXIT_FAILURE;
+
+        __atomic_store_n (&mc->job_wait, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n (&mc->job_done, __ATOMIC_SEQ_CST) == done)     /* no job finished since the snapshot */
+            futex_wait (&mc->job_done, done, end);
+        __atomic_store_n (&mc->job_wait, 0, __ATOMIC_RELAXED);
+    }
+}
+/*! --------------------------------------------------------------------
+ * @brief   eventfd of the motor. Is readable after the end of a job,
+ *           read() returns the number of finished jobs since the last read.
+ *           The fd is closed by kill_mot().
+ * @return  fd, -1 = error
+ */
+int mot_job_fd (struct _mot_ctl_ *mc)
+{
+    int fd;
+
+    if (!mc)
+        return -1;
+    if (mc->job_fd >= 0)
+        return mc->job_fd;
+
+    if ((fd = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0) {
+        rt_log ("-- can't create the eventfd of motor %u\n", mc->id);
+        return -1;
+    }
+    __atomic_store_n (&mc->job_fd, fd, __ATOMIC_RELEASE);      /* from now on written by the driver thread */
+
+    return fd;
+}
+/*! --------------------------------------------------------------------
+ * @brief   callbacks of the finished jobs up to head
+ * @return  0 = stop entry (mc == NULL) found
+ */
+static int run_callbacks (struct _mot_ctrl_ *c, uint32_t head)
+{
+    uint32_t tail = c->done_tail;
+    struct _mot_done_ d;
+
+    while (tail != head) {
+        d = c->done_ring[tail & (MOT_DONE_SIZE - 1)];
+        if (d.mc)
+            d.cb (d.mc, d.arg);
+        __atomic_store_n (&c->done_tail, ++tail, __ATOMIC_RELEASE);    /* after the callback, see: mot_notify_release() */
+        if (!d.mc)
+            return 0;
+    }
+
+    return 1;
+}
+/*! --------------------------------------------------------------------
+ * @brief   worker of a controller. Sleeps until the driver thread writes
+ *           a finished job. SCHED_OTHER, the callbacks can block.
+ */
+static void *job_worker (void *data)
+{
+    struct _mot_ctrl_ *c = (struct _mot_ctrl_ *)data;
+    uint32_t head;
+
+    do {
+        while ((head = __atomic_load_n (&c->done_head, __ATOMIC_ACQUIRE)) == c->done_tail) {
+            __atomic_store_n (&c->worker_wait, 1, __ATOMIC_SEQ_CST);
+            if (__atomic_load_n (&c->done_head, __ATOMIC_SEQ_CST) == head)     /* no entry since the check */
+                futex_wait (&c->done_head, head, 0);
+            __atomic_store_n (&c->worker_wait, 0, __ATOMIC_RELAXED);
+        }
+    } while (run_callbacks (c, head));
+
+    return NULL;
+}
+/*! --------------------------------------------------------------------
+ * @brief   starts the worker of the controller, if it doesn't run.
+ *           used by mot_set_job_callback()
+ */
+int mot_notify_start (struct _mot_ctrl_ *c)
+{
+    pthread_attr_t attr;
+    struct sched_param param = { .sched_priority = 0 };
+    int ret;
+
+    if (!c->state.run || c->worker_run)                         /* offline: see mot_notify_pass() */
+        return EXIT_SUCCESS;
+
+    pthread_attr_init (&attr);                                  /* not the policy of the API thread */
+    pthread_attr_setinheritsched (&attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy (&attr, SCHED_OTHER);
+    pthread_attr_setschedparam (&attr, &param);
+    ret = pthread_create (&c->worker, &attr, job_worker, c);
+    pthread_attr_destroy (&attr);
+    if (ret != 0) {
+        rt_log ("-- can't create the callback worker of controller %u\n", c->id);
+        return EXIT_FAILURE;
+    }
+    c->worker_run = 1;
+
+    return EXIT_SUCCESS;
+}
+/*! --------------------------------------------------------------------
+ * @brief   controller without driver thread: the callbacks are executed
+ *           by the API thread. used by mot_run_offline()
+ */
+int mot_notify_pass (struct _mot_ctrl_ *c)
+{
+    if (c->worker_run)
+        return EXIT_FAILURE;
+
+    run_callbacks (c, c->done_head);
+
+    return EXIT_SUCCESS;
+}
+/*! --------------------------------------------------------------------
+ * @brief   the motor is removed: waits for its callbacks, closes the
+ *           eventfd. A callback must not call kill_mot() of an other
+ *           motor of the same controller. used by kill_mot()
+ */
+int mot_notify_release (struct _mot_ctl_ *mc)
+{
+    struct _mot_ctrl_ *c = mc->ctrl;
+    uint32_t head = __atomic_load_n (&c->done_head, __ATOMIC_ACQUIRE);
+
+    if (!c->worker_run)
+        mot_notify_pass (c);
+    else if (!pthread_equal (pthread_self (), c->worker)) {
+        while ((int32_t)(__atomic_load_n (&c->done_tail, __ATOMIC_ACQUIRE) - head) < 0)
+            usleep (100);
+    }
+
+    if (mc->job_fd >= 0) {
+        close (mc->job_fd);
+        mc->job_fd = -1;
+    }
+
+    return EXIT_SUCCESS;
+}
+/*! --------------------------------------------------------------------
+ * @brief   the worker ends after the last callback. Call after the end
+ *           of the driver thread, the API thread writes the stop entry.
+ *           used by kill_mot_ctrl()
+ */
+int mot_notify_stop (struct _mot_ctrl_ *c)
+{
+    uint32_t head = c->done_head;
+
+    if (!c->worker_run)
+        return mot_notify_pass (c);
+
+    while (head - __atomic_load_n (&c->done_tail, __ATOMIC_ACQUIRE) >= MOT_DONE_SIZE)
+        usleep (100);
+    c->done_ring[head & (MOT_DONE_SIZE - 1)] = (struct _mot_done_){ .mc = NULL };
+    __atomic_store_n (&c->done_head, head + 1, __ATOMIC_RELEASE);
+    futex_wake (&c->done_head, 1);
+    pthread_join (c->worker, NULL);
+    c->worker_run = 0;
+
+    return EXIT_SUCCESS;
+}
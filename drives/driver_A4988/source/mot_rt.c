@@ -0,0 +1,396 @@
+/*! --------------------------------------------------------------------
+ *  @file    mot_rt.c
+ *  @date    10-17-2026
+ *  @name    Ulrich Buettemeier
+ *  @brief   real time safe mode (opt-in). mot_rt_init() before init_mot_ctl():
+ *           - mlockall (MCL_CURRENT | MCL_FUTURE): no page faults of locked
+ *             memory. Without CAP_IPC_LOCK or RLIMIT_MEMLOCK the memory
+ *             is not locked, this is reported.
+ *           - malloc never returns memory to the system (mallopt).
+ *           - fixed pools for controllers, motors and diagrams. Every
+ *             diagram has its own block of move points (cfg.points),
+ *             the block doesn't grow (see: md_reserve()).
+ *           - the driver threads get a stack of cfg.stack_kb, the stack is
+ *             prefaulted at the start of the thread (mot_rt_thread()).
+ *           An empty pool is reported, the object is not created.
+ *
+ *           Checker: with -DMOT_RT_CHECK (make rtcheck=1, default of test/Makefile) malloc(),
+ *           calloc(), realloc(), memalign(), posix_memalign(), 
+ *           aligned_alloc(), valloc() and pvalloc() are counted, if they are 
+ *           called by a driver thread after its start (see: mot_rt_allocs()).
+ *           strdup(), strndup() and asprintf() of glibc call malloc() and 
+ *           are counted. Not counted: mmap(), brk() and the internal 
+ *           allocations of the C library, that don't call malloc() (glibc).
+ * @example
+ *      struct _mot_rt_cfg_ cfg;
+ *      mot_rt_default (&cfg);
+ *      cfg.motors = 12;
+ *      mot_rt_init (&cfg);
+ *      init_mot_ctl ();
+ *      ...
+ *      if (mot_rt_allocs () != 0)
+ *          printf ("-- the driver thread has allocated memory\n");
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include "../../../tools/rt_log/rt_log.h"
+#include "driver_A4988.h"
+
+struct _rt_pool_ {                      /* fixed size objects */
+    uint8_t *base;
+    size_t size;                        /* bytes of an object */
+    uint32_t n;                         /* objects */
+    void **free;                        /* stack of the free objects */
+    uint32_t top;
+    uint32_t failed;                    /* allocations with empty pool */
+};
+
+static const size_t obj_size[MOT_RT_POOLS] = {
+    sizeof(struct _mot_ctrl_),
+    sizeof(struct _mot_ctl_),
+    sizeof(struct _motion_diagram_)
+};
+static const char *pool_name[MOT_RT_POOLS] = {"controllers", "motors", "diagrams"};
+
+static struct _mot_rt_cfg_ rt_cfg = {   /* default configuration */
+    .ctrls = 4,
+    .motors = 64,
+    .diagrams = 16,
+    .points = 1024,
+    .stack_kb = 256
+};
+static struct _rt_pool_ pool[MOT_RT_POOLS];
+static struct _move_point_ *points = NULL;      /* blocks of the diagrams */
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint8_t rt_on = 0, rt_locked = 0;
+
+static __thread uint8_t rt_path = 0;            /* 1 = driver thread after its start */
+
+#ifdef MOT_RT_CHECK
+static uint64_t rt_allocs = 0;
+
+/*! --------------------------------------------------------------------
+ * @brief   allocation counter of the driver threads. Replaces the 
+ *           allocators of the C library for the whole program.
+ */
+extern void *__libc_malloc (size_t size);
+extern void *__libc_calloc (size_t n, size_t size);
+extern void *__libc_realloc (void *p, size_t size);
+extern void *__libc_memalign (size_t align, size_t size);
+extern void *__libc_valloc (size_t size);
+extern void *__libc_pvalloc (size_t size);
+
+void *malloc (size_t size)
+{
+    if (rt_path)
+        __atomic_fetch_add (&rt_allocs, 1, __ATOMIC_RELAXED);
+    return __libc_malloc (size);
+}
+
+void *calloc (size_t n, size_t size)
+{
+    if (rt_path)
+        __atomic_fetch_add (&rt_allocs, 1, __ATOMIC_RELAXED);
+    return __libc_calloc (n, size);
+}
+
+void *realloc (void *p, size_t size)
+{
+    if (rt_path)
+        __atomic_fetch_add (&rt_allocs, 1, __ATOMIC_RELAXED);
+    return __libc_realloc (p, size);
+}
+
+void *memalign (size_t align, size_t size)
+{
+    if (rt_path)
+        __atomic_fetch_add (&rt_allocs, 1, __ATOMIC_RELAXED);
+    return __libc_memalign (align, size);
+}
+
+void *aligned_alloc (size_t align, size_t size)
+{
+    if (rt_path)
+        __atomic_fetch_add (&rt_allocs, 1, __ATOMIC_RELAXED);
+    return __libc_memalign (align, size);
+}
+
+int posix_memalign (void **p, size_t align, size_t size)
+{
+    void *m;
+
+    if (rt_path)
+        __atomic_fetch_add (&rt_allocs, 1, __ATOMIC_RELAXED);
+    if ((align % sizeof(void *)) || (align & (align - 1)) || !align)
+        return EINVAL;
+    if ((m = __libc_memalign (align, size)) == NULL)
+        return ENOMEM;
+    *p = m;
+    return 0;
+}
+
+void *valloc (size_t size)
+{
+    if (rt_path)
+        __atomic_fetch_add (&rt_allocs, 1, __ATOMIC_RELAXED);
+    return __libc_valloc (size);
+}
+
+void *pvalloc (size_t size)
+{
+    if (rt_path)
+        __atomic_fetch_add (&rt_allocs, 1, __ATOMIC_RELAXED);
+    return __libc_pvalloc (size);
+}
+#endif
+
+/*! --------------------------------------------------------------------
+ * @return  1 = obj is an object of the pool
+ */
+static int pool_owns (const struct _rt_pool_ *p, const void *obj)
+{
+    return (p->base && ((const uint8_t *)obj >= p->base) && ((const uint8_t *)obj < p->base + p->n * p->size));
+}
+/*! --------------------------------------------------------------------
+ * @brief   pools and blocks are freed. used by mot_rt_init()
+ */
+static void pool_release (void)
+{
+    int i;
+
+    for (i = 0; i < MOT_RT_POOLS; i++) {
+        free (pool[i].base);
+        free (pool[i].free);
+    }
+    memset (pool, 0, sizeof(pool));
+    free (points);
+    points = NULL;
+}
+/*! --------------------------------------------------------------------
+ * @brief   the stack is written page by page, so the pages exist (and
+ *           are locked) before the first step.
+ */
+static void __attribute__((noinline)) prefault_stack (size_t size)
+{
+    uint8_t buf[size];
+    volatile uint8_t *p = buf;          /* the writes are not optimized away */
+    size_t i, page = (size_t)sysconf (_SC_PAGESIZE);
+
+    for (i = 0; i < size; i += page)
+        p[i] = 0;
+}
+/*! --------------------------------------------------------------------
+ * @brief   default limits of the pools
+ */
+int mot_rt_default (struct _mot_rt_cfg_ *cfg)
+{
+    if (!cfg)
+        return EXIT_FAILURE;
+
+    *cfg = rt_cfg;
+
+    return EXIT_SUCCESS;
+}
+/*! --------------------------------------------------------------------
+ * @brief   switches on the real time safe mode. Must be called before
+ *           init_mot_ctl() (or init_mot_offline()) and before new_md().
+ *           A second call does nothing.
+ * @param   cfg = limits of the pools, NULL = mot_rt_default()
+ */
+int mot_rt_init (const struct _mot_rt_cfg_ *cfg)
+{
+    uint32_t n[MOT_RT_POOLS], k;
+    int i;
+
+    if (rt_on)
+        return EXIT_SUCCESS;
+
+    if (first_ctrl || first_md) {
+        rt_log ("-- rt: mot_rt_init() must be called before init_mot_ctl()\n");
+        return EXIT_FAILURE;
+    }
+    if (cfg)
+        rt_cfg = *cfg;
+    if (!rt_cfg.ctrls || !rt_cfg.motors || !rt_cfg.diagrams ||
+        (rt_cfg.points < MD_STREAM_SIZE + 1) || (rt_cfg.stack_kb < MOT_RT_STACK_MIN)) {
+        rt_log ("-- rt: wrong pool parameter\n");
+        return EXIT_FAILURE;
+    }
+
+    if (mlockall (MCL_CURRENT | MCL_FUTURE) == 0)
+        rt_locked = 1;
+    else
+        rt_log ("-- rt: mlockall failed: %s, the memory is not locked\n", strerror (errno));
+    mallopt (M_TRIM_THRESHOLD, -1);                 /* freed memory stays in the process */
+    mallopt (M_MMAP_MAX, 0);                        /* no mmap() for large blocks */
+
+    n[MOT_RT_CTRL] = rt_cfg.ctrls;
+    n[MOT_RT_MOT] = rt_cfg.motors;
+    n[MOT_RT_MD] = rt_cfg.diagrams;
+    for (i = 0; i < MOT_RT_POOLS; i++) {
+        pool[i].size = obj_size[i];
+        pool[i].n = n[i];
+        pool[i].base = (uint8_t *) malloc (n[i] * obj_size[i]);
+        pool[i].free = (void **) malloc (n[i] * sizeof(void *));
+        if (!pool[i].base || !pool[i].free)
+            break;
+        memset (pool[i].base, 0, n[i] * obj_size[i]);          /* prefault */
+        for (k = 0; k < n[i]; k++)                              /* the first object is on top */
+            pool[i].free[k] = pool[i].base + (size_t)(n[i] - 1 - k) * obj_size[i];
+        pool[i].top = n[i];
+    }
+    points = (struct _move_point_ *) malloc ((size_t)rt_cfg.diagrams * rt_cfg.points * sizeof(struct _move_point_));
+    if ((i < MOT_RT_POOLS) || !points) {
+        pool_release ();
+        rt_log ("-- rt: no memory for the pools\n");
+        return EXIT_FAILURE;
+    }
+    memset (points, 0, (size_t)rt_cfg.diagrams * rt_cfg.points * sizeof(struct _move_point_));
+    rt_on = 1;
+
+    rt_log ("-- rt: %u controllers, %u motors, %u diagrams with %u move points, stack %u KiB%s\n",
+            rt_cfg.ctrls, rt_cfg.motors, rt_cfg.diagrams, rt_cfg.points, rt_cfg.stack_kb,
+            (rt_locked) ? ", memory locked" : "");
+
+    return EXIT_SUCCESS;
+}
+/*! --------------------------------------------------------------------
+ * @brief   state of the pools
+ */
+int mot_rt_get (struct _mot_rt_state_ *s)
+{
+    int i;
+
+    if (!s)
+        return EXIT_FAILURE;
+
+    memset (s, 0, sizeof(struct _mot_rt_state_));
+    s->on = rt_on;
+    s->locked = rt_locked;
+    pthread_mutex_lock (&pool_lock);
+    for (i = 0; i < MOT_RT_POOLS; i++) {
+        s->size[i] = pool[i].n;
+        s->used[i] = pool[i].n - pool[i].top;
+        s->failed += pool[i].failed;
+    }
+    pthread_mutex_unlock (&pool_lock);
+    s->allocs = mot_rt_allocs ();
+
+    return EXIT_SUCCESS;
+}
+/*! --------------------------------------------------------------------
+ * @return  malloc(), calloc() and realloc() of the driver threads after
+ *           their start. MOT_RT_NO_CHECK = compiled without MOT_RT_CHECK
+ */
+uint64_t mot_rt_allocs (void)
+{
+#ifdef MOT_RT_CHECK
+    return __atomic_load_n (&rt_allocs, __ATOMIC_RELAXED);
+#else
+    return MOT_RT_NO_CHECK;
+#endif
+}
+/*! --------------------------------------------------------------------
+ * @brief   new object, set to 0. Without real time safe mode: calloc()
+ *           used by new_mot_ctrl(), new_mot(), new_md()
+ * @param   p = see: enum MOT_RT_POOL
+ * @return  NULL = the pool is empty
+ */
+void *mot_rt_alloc (uint8_t p)
+{
+    void *obj = NULL;
+
+    if (p >= MOT_RT_POOLS)
+        return NULL;
+    if (!rt_on)
+        return calloc (1, obj_size[p]);
+
+    pthread_mutex_lock (&pool_lock);
+    if (pool[p].top)
+        obj = pool[p].free[--pool[p].top];
+    else
+        pool[p].failed++;
+    pthread_mutex_unlock (&pool_lock);
+
+    if (!obj) {
+        rt_log ("-- rt: the pool of the %s is empty (%u)\n", pool_name[p], pool[p].n);
+        return NULL;
+    }
+    memset (obj, 0, pool[p].size);
+
+    return obj;
+}
+/*! --------------------------------------------------------------------
+ * @brief   the object of mot_rt_alloc() is free again
+ */
+int mot_rt_free (uint8_t p, void *obj)
+{
+    if (!obj || (p >= MOT_RT_POOLS))
+        return EXIT_FAILURE;
+
+    if (!rt_on || !pool_owns (&pool[p], obj)) {
+        free (obj);
+        return EXIT_SUCCESS;
+    }
+
+    pthread_mutex_lock (&pool_lock);
+    pool[p].free[pool[p].top++] = obj;
+    pthread_mutex_unlock (&pool_lock);
+
+    return EXIT_SUCCESS;
+}
+/*! --------------------------------------------------------------------
+ * @brief   block of move points of a diagram of the pool. used by new_md()
+ * @param   n = points of the block
+ * @return  NULL = no real time safe mode
+ */
+struct _move_point_ *mot_rt_points (struct _motion_diagram_ *md, uint32_t *n)
+{
+    size_t i;
+
+    if (!rt_on || !pool_owns (&pool[MOT_RT_MD], md))
+        return NULL;
+
+    i = (size_t)((uint8_t *)md - pool[MOT_RT_MD].base) / pool[MOT_RT_MD].size;
+    *n = rt_cfg.points;
+
+    return &points[i * rt_cfg.points];
+}
+/*! --------------------------------------------------------------------
+ * @return  1 = mp is a block of mot_rt_points(), it is not freed and
+ *           doesn't grow. used by md_reserve() and kill_md()
+ */
+int mot_rt_is_points (const struct _move_point_ *mp)
+{
+    return (rt_on && points && (mp >= points) && (mp < points + (size_t)rt_cfg.diagrams * rt_cfg.points));
+}
+/*! --------------------------------------------------------------------
+ * @brief   stack size of a driver thread. used by new_mot_ctrl()
+ */
+int mot_rt_thread_attr (pthread_attr_t *attr)
+{
+    if (!rt_on)
+        return EXIT_SUCCESS;
+
+    return (pthread_attr_setstacksize (attr, (size_t)rt_cfg.stack_kb * 1024) == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+/*! --------------------------------------------------------------------
+ * @brief   start of a driver thread: the stack is prefaulted. From now on
+ *           the allocations of the thread are counted (see: mot_rt_allocs()).
+ *           used by run_A4988()
+ */
+void mot_rt_thread (void)
+{
+    if (rt_on)
+        prefault_stack (((size_t)rt_cfg.stack_kb - MOT_RT_STACK_RESERVE) * 1024);
+    rt_path = 1;
+}
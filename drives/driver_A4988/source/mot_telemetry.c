@@ -0,0 +1,273 @@
+/*! --------------------------------------------------------------------
+ *  @file    mot_telemetry.c
+ *  @date    10-17-2026
+ *  @name    Ulrich Buettemeier
+ *  @brief   live state of the motors in a POSIX shared memory ring.
+ *           Every driver thread writes a record of each of its motors
+ *           every period_us (position, speed, mode, latency, time).
+ *           The ring has one seqlock per record: the driver thread never
+ *           waits, a reader copies the record and checks the sequence.
+ *           The sequence of a record is 2 * (n / slots + 1), so a reader
+ *           sees, if the record n is overwritten or not yet written.
+ *           Other processes (HMI, monitor_A4988) map the ring read only,
+ *           the control process is not involved.
+ * @example control process:
+ *      init_mot_ctl ();
+ *      mot_tele_open (MOT_TELE_NAME, 4096, 1000);     // 4096 records, 1 kHz per motor
+ *      ...
+ *      mot_tele_close ();
+ *
+ *          monitor process:
+ *      struct _mot_tele_ *t = mot_tele_attach (MOT_TELE_NAME);
+ *      struct _mot_tele_rec_ rec;
+ *      if (mot_tele_latest (t, 1, &rec) == EXIT_SUCCESS)
+ *          printf ("%lli\n", (long long int)rec.position);
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../../../tools/seqlock/seqlock.h"
+#include "../../../tools/rt_log/rt_log.h"
+#include "driver_A4988.h"
+
+static struct _mot_tele_ *tele = NULL;          /* ring of the control process. Read by the driver threads */
+static size_t tele_size = 0;
+static char tele_name[64];
+
+/*! --------------------------------------------------------------------
+ * @brief   size of the shared memory
+ */
+static size_t ring_size (uint32_t slots)
+{
+    return sizeof(struct _mot_tele_) + (size_t)slots * sizeof(struct _mot_tele_rec_);
+}
+/*! --------------------------------------------------------------------
+ * @brief   creates the ring, from now on the driver threads write the
+ *           records. Call after init_mot_ctl().
+ * @param   name = name of the shared memory, e.g. MOT_TELE_NAME
+ *          slots = records of the ring. power of 2,
+ *                  min. motors * time of a reader pass / period_us
+ *          period_us = time between two records of a motor [us]
+ */
+int mot_tele_open (const char *name, uint32_t slots, uint32_t period_us)
+{
+    struct _mot_tele_ *t;
+    int fd;
+
+    if (tele) {
+        rt_log ("-- telemetry is open\n");
+        return EXIT_FAILURE;
+    }
+    if (!name || (strlen (name) >= sizeof(tele_name)) || (slots < 2) || (slots & (slots - 1)) || !period_us) {
+        rt_log ("-- telemetry: wrong parameter\n");
+        return EXIT_FAILURE;
+    }
+
+    if ((fd = shm_open (name, O_CREAT | O_RDWR | O_TRUNC, 0644)) < 0) {
+        rt_log ("-- telemetry: can't create <%s>\n", name);
+        return EXIT_FAILURE;
+    }
+    if (ftruncate (fd, (off_t)ring_size (slots)) != 0) {
+        rt_log ("-- telemetry: can't set the size of <%s>\n", name);
+        close (fd);
+        shm_unlink (name);
+        return EXIT_FAILURE;
+    }
+    t = (struct _mot_tele_ *) mmap (NULL, ring_size (slots), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close (fd);
+    if (t == MAP_FAILED) {
+        rt_log ("-- telemetry: can't map <%s>\n", name);
+        shm_unlink (name);
+        return EXIT_FAILURE;
+    }
+
+    t->version = MOT_TELE_VERSION;
+    t->rec_size = sizeof(struct _mot_tele_rec_);
+    t->slots = slots;
+    t->period_us = period_us;
+    t->head = 0;
+    __atomic_store_n (&t->magic, MOT_TELE_MAGIC, __ATOMIC_RELEASE);    /* the header is complete */
+
+    strcpy (tele_name, name);
+    tele_size = ring_size (slots);
+    __atomic_store_n (&tele, t, __ATOMIC_RELEASE);
+
+    return EXIT_SUCCESS;
+}
+/*! --------------------------------------------------------------------
+ * @brief   the driver threads stop writing, the ring is removed.
+ *           Attached readers keep their mapping until mot_tele_detach().
+ */
+int mot_tele_close (void)
+{
+    struct _mot_tele_ *t = tele;
+    struct _mot_ctrl_ *c;
+
+    if (!t)
+        return EXIT_FAILURE;
+
+    __atomic_store_n (&tele, NULL, __ATOMIC_RELEASE);
+    for (c = first_ctrl; c; c = c->next)        /* no driver thread writes into the ring */
+        mot_ctrl_sync (c);
+
+    munmap (t, tele_size);
+    shm_unlink (tele_name);
+
+    return EXIT_SUCCESS;
+}
+/*! --------------------------------------------------------------------
+ * @brief   record of a motor. used by the driver thread
+ */
+static void publish (struct _mot_tele_ *t, struct _mot_ctrl_ *c, struct _mot_ctl_ *mc, uint64_t now)
+{
+    uint64_t n = __atomic_fetch_add (&t->head, 1, __ATOMIC_RELAXED);   /* several controllers write */
+    struct _mot_tele_rec_ *r = &t->rec[n & (t->slots - 1)];
+
+    seqlock_write_begin (&r->lock);
+    r->motor = mc->id;
+    r->ctrl = c->id;
+    r->mode = mc->mode;
+    r->aktiv = mc->flag.aktiv;
+    r->dir = mc->flag.dir;
+    r->ms_shift = mc->ms.shift;
+    r->t = now;
+    r->position = mc->real_stepcount;
+    r->stepcount = mc->current_stepcount;
+    r->omega = (float)mc->current_omega;
+    r->alpha = (float)mc->current_alpha;
+    r->steptime = mc->current_steptime;
+    r->latency = (int32_t)mc->latency;
+    r->mean_latency = (mc->current_stepcount) ? (uint32_t)(mc->sum_latency / mc->current_stepcount) : 0;
+    r->max_latency = (uint32_t)mc->max_latency;
+    seqlock_write_end (&r->lock);
+}
+/*! --------------------------------------------------------------------
+ * @brief   records of all motors of the controller, if the period is over.
+ *           used by driver_pass()
+ * @return  number of records
+ */
+int mot_tele_pass (struct _mot_ctrl_ *c, uint64_t now)
+{
+    struct _mot_tele_ *t = __atomic_load_n (&tele, __ATOMIC_ACQUIRE);
+    struct _mot_ctl_ *mc;
+    uint64_t period;
+    int n = 0;
+
+    if (!t) {
+        c->tele_next = 0;
+        return 0;
+    }
+    if (c->tele_next > now)
+        return 0;
+
+    for (mc = c->first_mc; mc; mc = mc->next, n++)
+        publish (t, c, mc, now);
+
+    period = (uint64_t)t->period_us * 1000;
+    if (c->tele_next && (now - c->tele_next < period))      /* fixed rate */
+        c->tele_next += period;
+    else
+        c->tele_next = now + period;
+
+    return n;
+}
+/*! --------------------------------------------------------------------
+ * @brief   monitor process: maps the ring read only
+ * @return  NULL = not found or wrong version
+ */
+struct _mot_tele_ *mot_tele_attach (const char *name)
+{
+    struct _mot_tele_ *t;
+    struct stat st;
+    int fd;
+
+    if (!name)
+        name = MOT_TELE_NAME;
+
+    if ((fd = shm_open (name, O_RDONLY, 0)) < 0) {
+        rt_log ("-- telemetry <%s> not found\n", name);
+        return NULL;
+    }
+    if ((fstat (fd, &st) != 0) || (st.st_size < (off_t)sizeof(struct _mot_tele_))) {
+        rt_log ("-- telemetry <%s> is empty\n", name);
+        close (fd);
+        return NULL;
+    }
+    t = (struct _mot_tele_ *) mmap (NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close (fd);
+    if (t == MAP_FAILED) {
+        rt_log ("-- telemetry: can't map <%s>\n", name);
+        return NULL;
+    }
+
+    if ((__atomic_load_n (&t->magic, __ATOMIC_ACQUIRE) != MOT_TELE_MAGIC) || (t->version != MOT_TELE_VERSION) ||
+        (t->rec_size != sizeof(struct _mot_tele_rec_)) || ((size_t)st.st_size < ring_size (t->slots))) {
+        rt_log ("-- telemetry <%s>: wrong version\n", name);
+        munmap (t, (size_t)st.st_size);
+        return NULL;
+    }
+
+    return t;
+}
+/*! --------------------------------------------------------------------
+ *
+ */
+int mot_tele_detach (struct _mot_tele_ *t)
+{
+    if (!t)
+        return EXIT_FAILURE;
+
+    munmap (t, ring_size (t->slots));
+
+    return EXIT_SUCCESS;
+}
+/*! --------------------------------------------------------------------
+ * @brief   copy of the record n. Never waits for the driver thread longer
+ *           than the write of one record.
+ * @return  EXIT_FAILURE = the record is overwritten or not yet written
+ */
+int mot_tele_read (const struct _mot_tele_ *t, uint64_t n, struct _mot_tele_rec_ *rec)
+{
+    const struct _mot_tele_rec_ *r;
+    uint32_t seq, expect;
+
+    if (!t || !rec)
+        return EXIT_FAILURE;
+
+    r = &t->rec[n & (t->slots - 1)];
+    expect = (uint32_t)(2 * (n / t->slots + 1));
+    do {
+        if ((seq = seqlock_read_begin (&r->lock)) != expect)
+            return EXIT_FAILURE;
+        memcpy (rec, r, sizeof(struct _mot_tele_rec_));
+    } while (seqlock_read_retry (&r->lock, seq));
+
+    return EXIT_SUCCESS;
+}
+/*! --------------------------------------------------------------------
+ * @brief   last record of a motor. The ring is searched backwards.
+ * @param   motor = mc->id
+ * @return  EXIT_FAILURE = no record of the motor in the ring
+ */
+int mot_tele_latest (const struct _mot_tele_ *t, uint16_t motor, struct _mot_tele_rec_ *rec)
+{
+    uint64_t head, n;
+
+    if (!t || !rec)
+        return EXIT_FAILURE;
+
+    head = __atomic_load_n (&t->head, __ATOMIC_ACQUIRE);
+    for (n = head; n && (head - n < t->slots); n--) {
+        if ((mot_tele_read (t, n - 1, rec) == EXIT_SUCCESS) && (rec->motor == motor))
+            return EXIT_SUCCESS;
+    }
+
+    return EXIT_FAILURE;
+}
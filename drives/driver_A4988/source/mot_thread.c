@@ -0,0 +1,366 @@
+/*! --------------------------------------------------------------------
+ *  @file    mot_thread.c
+ *  @date    10-17-2026
+ *  @name    Ulrich Buettemeier
+ *  @brief   cpu affinity and scheduling policy of the driver threads.
+ *           The default configuration is set by the API, by a config file 
+ *           and by environment variables, in this order (the last one wins):
+ *             mot_set_thread_policy(), mot_set_thread_deadline(), mot_set_thread_cpus()
+ *             file of A4988_CONFIG or mot_thread_config()
+ *             A4988_CPUS, A4988_POLICY, A4988_PRIORITY,
+ *             A4988_RUNTIME_US, A4988_DEADLINE_US, A4988_PERIOD_US
+ *           A controller gets the default configuration or its own one
+ *           (new_mot_ctrl()). Every driver thread sets its configuration 
+ *           itself at its start (mot_thread_apply()). If a setting fails, e.g. without
+ *           CAP_SYS_NICE, the next weaker policy is used and reported:
+ *           DEADLINE -> FIFO -> OTHER, RR -> OTHER.
+ * @example config file:
+ *      # driver thread on the isolated core 3
+ *      cpus = 3
+ *      policy = fifo
+ *      priority = 95
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/syscall.h>
+
+#include "../../../tools/rt_log/rt_log.h"
+#include "driver_A4988.h"
+
+#ifndef SCHED_DEADLINE
+#define SCHED_DEADLINE 6
+#endif
+
+#define MAX_CHAR 256
+
+struct _sched_attr_ {                   /* see: man sched_setattr */
+    uint32_t size;
+    uint32_t sched_policy;
+    uint64_t sched_flags;
+    int32_t sched_nice;
+    uint32_t sched_priority;
+    uint64_t sched_runtime;             /* [ns] */
+    uint64_t sched_deadline;
+    uint64_t sched_period;
+};
+
+static struct _mot_thread_cfg_ thread_cfg = {   /* default configuration */
+    .policy = MOT_THREAD_POLICY,
+    .priority = MOT_THREAD_PRIORITY,
+    .runtime_us = 200,
+    .deadline_us = 1000,
+    .period_us = 1000,
+    .cpus = ""
+};
+
+static const char *policy_name[4] = {"other", "fifo", "rr", "deadline"};
+
+/*! --------------------------------------------------------------------
+ * @brief   cpu list, e.g. "3", "2-3", "0,2-3"
+ * @param   set = NULL: check only
+ */
+static int parse_cpus (const char *cpus, cpu_set_t *set)
+{
+    const char *s = cpus;
+    char *end;
+    long a, b;
+
+    if (set)
+        CPU_ZERO (set);
+
+    while (*s) {
+        a = b = strtol (s, &end, 10);
+        if ((end == s) || (a < 0) || (a >= CPU_SETSIZE))
+            return EXIT_FAILURE;
+        s = end;
+        if (*s == '-') {
+            b = strtol (++s, &end, 10);
+            if ((end == s) || (b < a) || (b >= CPU_SETSIZE))
+                return EXIT_FAILURE;
+            s = end;
+        }
+        for (; set && (a <= b); a++)
+            CPU_SET (a, set);
+        if (*s == ',')
+            s++;
+        else if (*s)
+            return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+/*! --------------------------------------------------------------------
+ * @brief   set a parameter of the config file or of the environment
+ * @param   key = cpus, policy, priority, runtime_us, deadline_us, period_us
+ */
+static int set_key (const char *key, const char *value)
+{
+    int i;
+
+    if (!strcasecmp (key, "cpus"))
+        return mot_set_thread_cpus (value);
+
+    if (!strcasecmp (key, "policy")) {
+        for (i = MOT_POLICY_OTHER; i <= MOT_POLICY_DEADLINE; i++)
+            if (!strcasecmp (value, policy_name[i]))
+                return mot_set_thread_policy ((uint8_t)i, thread_cfg.priority);
+        rt_log ("-- thread: unknown policy <%s>\n", value);
+        return EXIT_FAILURE;
+    }
+
+    if (!strcasecmp (key, "priority"))
+        return mot_set_thread_policy (thread_cfg.policy, atoi (value));
+    if (!strcasecmp (key, "runtime_us"))
+        thread_cfg.runtime_us = (uint32_t)strtoul (value, NULL, 10);
+    else if (!strcasecmp (key, "deadline_us"))
+        thread_cfg.deadline_us = (uint32_t)strtoul (value, NULL, 10);
+    else if (!strcasecmp (key, "period_us"))
+        thread_cfg.period_us = (uint32_t)strtoul (value, NULL, 10);
+    else {
+        rt_log ("-- thread: unknown parameter <%s>\n", key);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+/*! --------------------------------------------------------------------
+ * @brief   scheduling policy of the driver thread. Used by the next 
+ *           controller (init_mot_ctl(), new_mot_ctrl (NULL)).
+ * @param   policy = see: enum MOT_POLICY
+ *          priority = 1 ... 99 with MOT_POLICY_FIFO and MOT_POLICY_RR
+ */
+int mot_set_thread_policy (uint8_t policy, int priority)
+{
+    if ((policy > MOT_POLICY_DEADLINE) ||
+        (((policy == MOT_POLICY_FIFO) || (policy == MOT_POLICY_RR)) && ((priority < 1) || (priority > 99)))) {
+        rt_log ("-- thread: wrong policy %u or priority %i\n", policy, priority);
+        return EXIT_FAILURE;
+    }
+
+    thread_cfg.policy = policy;
+    thread_cfg.priority = priority;
+
+    return EXIT_SUCCESS;
+}
+/*! --------------------------------------------------------------------
+ * @brief   MOT_POLICY_DEADLINE: the thread gets runtime_us in every
+ *           period_us, finished after deadline_us.
+ *           runtime_us <= deadline_us <= period_us
+ */
+int mot_set_thread_deadline (uint32_t runtime_us, uint32_t deadline_us, uint32_t period_us)
+{
+    if (!runtime_us || (runtime_us > deadline_us) || (deadline_us > period_us)) {
+        rt_log ("-- thread: wrong deadline parameter\n");
+        return EXIT_FAILURE;
+    }
+
+    thread_cfg.policy = MOT_POLICY_DEADLINE;
+    thread_cfg.runtime_us = runtime_us;
+    thread_cfg.deadline_us = deadline_us;
+    thread_cfg.period_us = period_us;
+
+    return EXIT_SUCCESS;
+}
+/*! --------------------------------------------------------------------
+ * @brief   cpus of the driver thread, e.g. the core isolated with isolcpus=3
+ * @param   cpus = cpu list "3", "2-3", "0,2". NULL or "" = all cpus
+ */
+int mot_set_thread_cpus (const char *cpus)
+{
+    if (!cpus)
+        cpus = "";
+
+    if ((strlen (cpus) >= MOT_CPUS_LEN) || (parse_cpus (cpus, NULL) != EXIT_SUCCESS)) {
+        rt_log ("-- thread: wrong cpu list <%s>\n", cpus);
+        return EXIT_FAILURE;
+    }
+    strcpy (thread_cfg.cpus, cpus);
+
+    return EXIT_SUCCESS;
+}
+/*! --------------------------------------------------------------------
+ * @brief   reads a config file. One parameter per line: key = value
+ *           or key value. # is a comment.
+ * @return  EXIT_FAILURE = file not found or wrong parameter
+ */
+int mot_thread_config (const char *fname)
+{
+    char str[MAX_CHAR], key[MAX_CHAR], value[MAX_CHAR];
+    int ret = EXIT_SUCCESS;
+    char *c;
+    FILE *f;
+
+    if (!fname || ((f = fopen (fname, "rt")) == NULL)) {
+        rt_log ("-- thread: config file <%s> not found\n", (fname) ? fname : "");
+        return EXIT_FAILURE;
+    }
+
+    while (fgets (str, MAX_CHAR, f)) {
+        if ((c = strchr (str, '#')) != NULL)
+            *c = 0;
+        for (c = str; *c; c++)
+            if (*c == '=')
+                *c = ' ';
+        if (sscanf (str, "%255s %255s", key, value) == 2) {
+            if (set_key (key, value) != EXIT_SUCCESS)
+                ret = EXIT_FAILURE;
+        } else if (sscanf (str, "%255s", key) == 1) {
+            if (!strcasecmp (key, "cpus"))          /* cpus = : all cpus */
+                mot_set_thread_cpus ("");
+            else {
+                rt_log ("-- thread: <%s> without value\n", key);
+                ret = EXIT_FAILURE;
+            }
+        }
+    }
+    fclose (f);
+
+    return ret;
+}
+/*! --------------------------------------------------------------------
+ * @brief   config file A4988_CONFIG and environment variables A4988_<KEY>.
+ *           used by mot_thread_default()
+ */
+int mot_thread_env (void)
+{
+    static const char *key[6] = {"cpus", "policy", "priority", "runtime_us", "deadline_us", "period_us"};
+    char name[32];
+    const char *v;
+    int ret = EXIT_SUCCESS;
+    int i, k;
+
+    if ((v = getenv ("A4988_CONFIG")) != NULL)
+        ret = mot_thread_config (v);
+
+    for (i = 0; i < 6; i++) {
+        strcpy (name, "A4988_");
+        for (k = 0; key[i][k]; k++)
+            name[6 + k] = (char)toupper (key[i][k]);
+        name[6 + k] = 0;
+        if (((v = getenv (name)) != NULL) && (set_key (key[i], v) != EXIT_SUCCESS))
+            ret = EXIT_FAILURE;
+    }
+
+    return ret;
+}
+/*! --------------------------------------------------------------------
+ * @brief   default configuration of a controller. At the first call the 
+ *           config file and the environment are read (mot_thread_env()).
+ */
+int mot_thread_default (struct _mot_thread_cfg_ *cfg)
+{
+    static uint8_t env = 0;
+
+    if (!cfg)
+        return EXIT_FAILURE;
+
+    if (!env) {
+        env = 1;
+        mot_thread_env ();
+    }
+    *cfg = thread_cfg;
+    cfg->pinned = cfg->fallback = 0;
+
+    return EXIT_SUCCESS;
+}
+/*! --------------------------------------------------------------------
+ * @brief   set the policy of the calling thread
+ * @return  0 or errno
+ */
+static int set_policy (const struct _mot_thread_cfg_ *cfg)
+{
+    uint8_t policy = cfg->policy;
+    int priority = cfg->priority;
+
+    struct _sched_attr_ attr;
+    struct sched_param sp;
+
+    if (policy == MOT_POLICY_DEADLINE) {
+        memset (&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.sched_policy = SCHED_DEADLINE;
+        attr.sched_runtime = (uint64_t)cfg->runtime_us * 1000;
+        attr.sched_deadline = (uint64_t)cfg->deadline_us * 1000;
+        attr.sched_period = (uint64_t)cfg->period_us * 1000;
+        return (syscall (SYS_sched_setattr, 0, &attr, 0) == 0) ? 0 : errno;
+    }
+
+    sp.sched_priority = (policy == MOT_POLICY_OTHER) ? 0 : priority;
+    return (sched_setscheduler (0, (policy == MOT_POLICY_FIFO) ? SCHED_FIFO :
+                                   (policy == MOT_POLICY_RR) ? SCHED_RR : SCHED_OTHER, &sp) == 0) ? 0 : errno;
+}
+/*! --------------------------------------------------------------------
+ * @brief   the driver thread sets the cpus and the policy of its controller.
+ *           Failures are reported, the thread runs with the next weaker
+ *           policy or on all cpus.
+ *           used by run_A4988()
+ */
+void mot_thread_apply (struct _mot_ctrl_ *ctrl)
+{
+    struct _mot_thread_cfg_ *u = &ctrl->used;
+    char param[80] = "";
+    cpu_set_t set;
+    uint8_t failed;
+    int err;
+
+    *u = ctrl->cfg;
+    u->fallback = 0;
+    u->pinned = 0;
+
+    if (u->cpus[0]) {
+        parse_cpus (u->cpus, &set);
+        if (sched_setaffinity (0, sizeof(set), &set) == 0)
+            u->pinned = 1;
+        else {
+            rt_log ("-- thread %u: cpus <%s> failed: %s, runs on all cpus\n", ctrl->id, u->cpus, strerror (errno));
+            u->cpus[0] = 0;
+            u->fallback = 1;
+        }
+    }
+
+    while ((err = set_policy (u)) != 0) {
+        failed = u->policy;
+        u->policy = (u->policy == MOT_POLICY_DEADLINE) ? MOT_POLICY_FIFO : MOT_POLICY_OTHER;
+        u->fallback = 1;
+        rt_log ("-- thread %u: policy %s failed: %s%s, fallback %s\n", ctrl->id, policy_name[failed], strerror (err),
+                ((failed == MOT_POLICY_DEADLINE) && u->pinned) ? " (DEADLINE needs all cpus of the root domain)" : "",
+                policy_name[u->policy]);
+        if (u->policy == MOT_POLICY_OTHER)
+            break;
+    }
+    if (u->policy == MOT_POLICY_OTHER)
+        u->priority = 0;
+
+    if ((u->policy == MOT_POLICY_FIFO) || (u->policy == MOT_POLICY_RR))     /* one record per line, see: rt_log() */
+        snprintf (param, sizeof(param), " priority=%i", u->priority);
+    else if (u->policy == MOT_POLICY_DEADLINE)
+        snprintf (param, sizeof(param), " runtime=%u us deadline=%u us period=%u us", u->runtime_us, u->deadline_us, u->period_us);
+    rt_log ("-- thread %u: policy=%s%s  cpus=%s%s\n", ctrl->id, policy_name[u->policy], param,
+            (u->pinned) ? u->cpus : "all", (u->fallback) ? "  (fallback)" : "");
+}
+/*! --------------------------------------------------------------------
+ * @brief   configuration, that is used by the driver thread.
+ *           fallback = 1: a setting has failed
+ * @param   ctrl = NULL: default controller
+ */
+int mot_thread_get (struct _mot_ctrl_ *ctrl, struct _mot_thread_cfg_ *cfg)
+{
+    if (!ctrl)
+        ctrl = mot_default_ctrl ();
+    if (!ctrl || !cfg)
+        return EXIT_FAILURE;
+
+    *cfg = ctrl->used;
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,208 @@
+/*! ---------------------------------------------------------------------
+ * @file    sim_md.c
+ * @date    10-17-2026
+ * @name    Ulrich Buettemeier
+ * @brief   checks a motion diagram without motor and without waiting.
+ *          The driver runs without thread on the virtual clock of
+ *          mot_run_offline(), the gpio simulator records every pin change
+ *          with the virtual time (MOT_GPIO_SIM). The result is the same
+ *          for every run:
+ *          - real_stepcount, current_stepcount and runtime of the job
+ *          - steps and end time of every segment (move point) compared
+ *            with the diagram
+ *          - the step/dir timeline (optional file) and its hash, to
+ *            compare two versions of the driver
+ *          usage: sim_md <file> [omega|freq|rpm|step|bin] [steps per turn] [timeline file]
+ *          default: rpm, 400 steps per turn
+ * @example sim_md curve_1.dat rpm 400 curve_1.tl
+ *          sim_md curve_2.dat step
+ * @return  EXIT_FAILURE = the diagram is incorrect or steps are missing
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "driver_A4988.h"
+#include "../../../tools/rpi_tools/rpi_tools.h"
+#include "../../../tools/gpio/gpio_sim.h"
+
+#define ENABLE_PIN 25       /* GPIO.25  PIN 37 */
+#define STEP_PIN   24       /* GPIO.24  PIN 35 */
+#define DIR_PIN    23       /* GPIO.23  PIN 33 */
+
+#define SIM_RING (1u << 18)             /* events of the gpio simulator */
+#define SIM_SLICE_NS 10000000ull        /* virtual time between two reads of the ring [ns] */
+#define FORMAT_BIN 4                    /* binary file, see: md_file.c */
+
+struct _sim_ {
+    struct _mot_ctl_ *mc;
+    struct _move_point_ *seg;           /* segment, that ends with the step seg_end */
+    int seg_nr;                         /* number of seg, first_mp = 0 */
+    uint64_t seg_end;                   /* step number of the end of seg */
+    double *t_end;                      /* end time of the segments in the timeline [s] */
+    uint64_t steps;                     /* step pulses of the timeline */
+    uint64_t events, lost;              /* events of the ring, overwritten events */
+    uint64_t hash;                      /* FNV-1a of the timeline */
+    double max_dt;                      /* max. |t_sim - t| of the segment ends [s] */
+    FILE *f;                            /* timeline file or NULL */
+};
+
+/*! --------------------------------------------------------------------
+ * @brief   next segment with steps
+ */
+static void next_seg (struct _sim_ *s)
+{
+    while (s->seg && (s->seg->sum_steps <= s->steps)) {
+        s->seg = s->seg->next;
+        s->seg_nr++;
+    }
+    s->seg_end = (s->seg) ? s->seg->sum_steps : UINT64_MAX;
+}
+/*! --------------------------------------------------------------------
+ * @brief   reads the new events of the gpio simulator
+ */
+static void read_events (struct _sim_ *s)
+{
+    static const char *pin_name[3] = {"enable", "dir", "step"};
+    struct _gpio_sim_event_ ev;
+    uint64_t n = gpio_sim_count ();
+    uint64_t t;
+    int p, i;
+
+    if (n - s->events > SIM_RING) {
+        s->lost += n - s->events - SIM_RING;
+        s->events = n - SIM_RING;
+    }
+
+    for (; s->events < n; s->events++) {
+        if (gpio_sim_event (s->events, &ev) != EXIT_SUCCESS) {
+            s->lost++;
+            continue;
+        }
+        if (ev.pin == s->mc->mp.step_pin)
+            p = 2;
+        else if (ev.pin == s->mc->mp.dir_pin)
+            p = 1;
+        else if (ev.pin == s->mc->mp.enable_pin)
+            p = 0;
+        else
+            continue;
+
+        for (i = 0; i < (int)sizeof(ev.t); i++)
+            s->hash = (s->hash ^ ((ev.t >> (8 * i)) & 0xff)) * 0x100000001b3ull;
+        s->hash = (s->hash ^ (uint64_t)(p * 2 + ev.value)) * 0x100000001b3ull;
+
+        t = ev.t - s->mc->run_start;
+        if (s->f)
+            fprintf (s->f, "%llu %s %u\n", (long long unsigned)t, pin_name[p], ev.value);
+
+        if ((p == 2) && ev.value && (++s->steps == s->seg_end)) {     /* last step of the segment */
+            s->t_end[s->seg_nr] = (double)t / 1e9;
+            if (fabs (s->t_end[s->seg_nr] - s->seg->t) > s->max_dt)
+                s->max_dt = fabs (s->t_end[s->seg_nr] - s->seg->t);
+            next_seg (s);
+        }
+    }
+}
+/*! --------------------------------------------------------------------
+ *
+ */
+int main (int argc, char *argv[])
+{
+    const char *name[5] = {"omega", "freq", "rpm", "step", "bin"};
+    struct _motion_diagram_ *md;
+    struct _move_point_ *mp;
+    struct _sim_ s;
+    uint8_t format = RPM;
+    uint32_t steps_per_turn = 400;
+    uint64_t t, planned;
+    int i, err = 0;
+
+    if (argc < 2) {
+        printf ("usage: sim_md <file> [omega|freq|rpm|step|bin] [steps per turn] [timeline file]\n");
+        return EXIT_FAILURE;
+    }
+    if (argc > 2) {
+        for (format = OMEGA; format <= FORMAT_BIN; format++)
+            if (!strcmp (argv[2], name[format]))
+                break;
+        if (format > FORMAT_BIN) {
+            printf ("-- unknown format <%s>\n", argv[2]);
+            return EXIT_FAILURE;
+        }
+    }
+    if ((argc > 3) && ((steps_per_turn = (uint32_t)atoi (argv[3])) == 0)) {
+        printf ("-- wrong steps per turn <%s>\n", argv[3]);
+        return EXIT_FAILURE;
+    }
+
+    memset (&s, 0, sizeof(s));
+    s.hash = 0xcbf29ce484222325ull;
+    if ((argc > 4) && ((s.f = fopen (argv[4], "wt")) == NULL)) {
+        printf ("-- Can't create <%s>\n", argv[4]);
+        return EXIT_FAILURE;
+    }
+
+    mot_set_gpio (MOT_GPIO_SIM, 0);
+    gpio_sim_ring_size (SIM_RING);
+    if (init_mot_offline () != EXIT_SUCCESS)
+        return EXIT_FAILURE;
+
+    s.mc = new_mot (NULL, ENABLE_PIN, DIR_PIN, STEP_PIN, steps_per_turn);
+    md = (format == FORMAT_BIN) ? new_md_from_bin (s.mc, argv[1]) : new_md_from_file (s.mc, argv[1], format);
+    if (!md || ((s.t_end = (double *) calloc (count_mp (md), sizeof(double))) == NULL))
+        return EXIT_FAILURE;
+
+    t = monotonic_ns ();
+    gpio_sim_clear ();                          /* the timeline starts with the job */
+    if (mot_start_md (md) != EXIT_SUCCESS)
+        return EXIT_FAILURE;
+    if (s.f)
+        fprintf (s.f, "# %s  t[ns] pin value\n", argv[1]);
+    s.seg = md->first_mp;
+    next_seg (&s);
+    while (s.mc->mode != MOT_IDLE) {
+        mot_run_offline (SIM_SLICE_NS);
+        read_events (&s);
+    }
+    read_events (&s);
+    t = monotonic_ns () - t;
+    if (s.f)
+        fclose (s.f);
+
+    printf ("-- %s  %s  steps_per_turn=%u\n", argv[1], name[format], steps_per_turn);
+    printf ("-- segment        t[s]    t_sim[s]       steps   steps_sim\n");
+    for (mp = md->first_mp->next, i = 1, planned = 0; mp; mp = mp->next, i++) {
+        planned += mp->steps;
+        if (mp->steps != mp->current_step)
+            err = 1;
+        if (mp->steps)
+            printf ("-- %7i  %10.6f  %10.6f  %10llu  %10llu\n", i, mp->t, s.t_end[i],
+                     (long long unsigned)mp->steps, (long long unsigned)mp->current_step);
+        else
+            printf ("-- %7i  %10.6f           -  %10llu  %10llu\n", i, mp->t,
+                     (long long unsigned)mp->steps, (long long unsigned)mp->current_step);
+    }
+    if ((planned != s.mc->current_stepcount) || (s.steps != s.mc->current_stepcount))
+        err = 1;
+
+    printf ("-- real_stepcount=%lli  current_stepcount=%llu  planned=%llu  timeline steps=%llu\n",
+             (long long int)s.mc->real_stepcount, (long long unsigned)s.mc->current_stepcount,
+             (long long unsigned)planned, (long long unsigned)s.steps);
+    printf ("-- runtime=%llu us  diagram=%.6f s  max. |t_sim - t|=%.1f us\n",
+             (long long unsigned)s.mc->runtime, md->last_mp->t, s.max_dt * 1e6);
+    printf ("-- timeline: %llu events  hash=%016llx%s\n", (long long unsigned)s.events,
+             (long long unsigned)s.hash, (s.lost) ? "  (events lost)" : "");
+    printf ("-- simulated in %.1f ms\n", (double)t / 1e6);
+    if (err || s.lost)
+        printf ("-- ERROR: steps of the simulation differ from the diagram\n");
+
+    free (s.t_end);
+    kill_md (md);
+    kill_mot (s.mc);
+
+    return (err || s.lost) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
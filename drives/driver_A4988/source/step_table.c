@@ -0,0 +1,772 @@
+/*! --------------------------------------------------------------------
+ *  @file    step_table.c
+ *  @date    10-16-2026
+ *  @name    Ulrich Buettemeier
+ *  @brief   Compile stage of the step engine.
+ *           The ramps (mot_setparam) and the motion diagrams (mot_start_md)
+ *           are compiled into chunks of step intervals. The driver thread
+ *           only reads the active chunk, so there is no sqrt() and no
+ *           double division on the hot path.
+ *           The back chunk is refilled by step_table_fill() while the
+ *           driver thread waits for the next step.
+ *           S-curve ramps (mot_setparam_scurve) are integrated step by step:
+ *           the time of a step is the root of 
+ *             phi_per_step = omega*t + alpha*t²/2 + jerk*t³/6
+ *           found by Newton iteration from the time of the last step.
+ *           MOT_RAMP_FIXED: recursive step delay (D. Austin, "Generate 
+ *           stepper-motor speed profiles in real time", 2005)
+ *             speed-up    c[n] = c[n-1] - 2*c[n-1] / (4*n + 1)
+ *             speed-down  c[m] = c[m+1] + 2*c[m+1] / (4*m - 1), m = rest
+ *           The approximation is poor for the first steps, so the first
+ *           RAMP_EXACT steps of a ramp use the exact ratios 
+ *           (sqrt(n+1) - sqrt(n)) / (sqrt(n) - sqrt(n-1)) from a table.
+ *           The braking point is calculated once per job. The number of 
+ *           steps is the same as with MOT_RAMP_DOUBLE, the braking point 
+ *           differs max. 1 step, the step delays differ max. 1 %
+ *           (see: bench_driver_A4988 ramp).
+ *           Move queue (mot_queue_move): the moves are compiled one after
+ *           another without stop. The speed at the end of a move (exit) 
+ *           is set by the look-ahead planner in driver_A4988.c.
+ *           Streaming motion diagram (md_stream.c): if the ring is empty,
+ *           a MOT_WAIT_MD entry without step ends the chunk.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "driver_A4988.h"
+
+static uint8_t ramp_engine = MOT_RAMP_DOUBLE;      /* see: mot_set_ramp_engine() */
+
+#define RAMP_EXACT 4
+static const uint32_t ramp_up[RAMP_EXACT+1] = {0, 27146, 50288, 55249, 57738};      /* c[n] / c[n-1] << 16 */
+static const uint32_t ramp_down[RAMP_EXACT+1] = {0, 158218, 85408, 77738, 74387};   /* c[m] / c[m+1] << 16 */
+
+enum SCURVE_PHASE {             /* phase of a S-curve speed-up or speed-down */
+    SC_JERK = 0,                /* |alpha| rises with jerk */
+    SC_CONST = 1,               /* |alpha| = a_start or a_stop */
+    SC_RELEASE = 2              /* |alpha| falls with jerk to zero */
+};
+
+/*! --------------------------------------------------------------------
+ * @brief   number of steps for speed-down from steptime [us] to zero
+ */
+static double steps_for_step_down (struct _mot_ctl_ *mc, uint32_t steptime)
+{
+    double omega = calc_omega (mc->steps_per_turn, steptime);
+
+    return omega * omega / 2.0 / mc->a_stop / mc->phi_per_step;
+}
+/*! --------------------------------------------------------------------
+ * @brief   steptime of a step, rounded to us. The rounding error is 
+ *           carried to the next step, so the time of the job doesn't drift.
+ * @param   t = time of the step [s]
+ * @return  steptime [us]
+ */
+static uint32_t step_us (struct _step_gen_ *g, double t)
+{
+    double us = t * 1000000.0 + g->t_frac;
+    uint32_t steptime = (us > 0.0) ? (uint32_t)(us + 0.5) : 0;
+
+    g->t_frac = us - (double)steptime;
+    return steptime;
+}
+/*! --------------------------------------------------------------------
+ * @brief   generator for mot_setparam(). Speed-up, run, speed-down.
+ * @return  1 = step compiled, 0 = end of job
+ */
+static int gen_ramp (struct _mot_ctl_ *mc, struct _step_gen_ *g, struct _step_entry_ *e)
+{
+    switch (g->state) {
+        case MOT_SPEED_UP: {
+                if ((mc->num_steps > 0) && (g->count >= (uint64_t)mc->num_steps))   /* target number of steps reached */
+                    return 0;
+
+                double phi = mc->phi_per_step * (double)(g->count + 1);
+                double new_omega = sqrt(2.0 * mc->a_start * phi);
+                if (new_omega >= mc->omega) {                       /* target speed reached */
+                    g->steptime = mc->steptime;
+                    g->omega = mc->omega;
+                    g->state = MOT_RUN;                             /* constant speed */
+                } else {
+                    double t = 2.0 * mc->phi_per_step / (new_omega + g->omega);   /* new time for step */
+                    g->steptime = step_us (g, t);                               /* steptime in us */
+                    g->omega = new_omega;
+                }
+            }
+            break;
+
+        case MOT_RUN:
+            break;
+
+        case MOT_SPEED_DOWN: {
+                if (!g->rest)
+                    return 0;
+
+                double phi1 = (double)g->rest * mc->phi_per_step;
+                double phi0 = phi1 - mc->phi_per_step;
+                double t1 = sqrt(phi1 * 2.0 / mc->a_stop);
+                double t0 = sqrt(phi0 * 2.0 / mc->a_stop);
+                g->steptime = step_us (g, t1 - t0);                     /* steptime in us */
+                g->omega = calc_omega (mc->steps_per_turn, g->steptime);
+            }
+            break;
+
+        default:
+            return 0;
+    }
+
+    e->steptime = g->steptime;
+    e->omega = (g->dir == MOT_CCW) ? -g->omega : g->omega;
+    e->alpha = (g->state == MOT_SPEED_UP) ? mc->a_start : (g->state == MOT_SPEED_DOWN) ? -mc->a_stop : 0.0;
+    e->dir = g->dir;
+    e->mode = g->state;
+    g->count++;
+
+    if (!mc->flag.endless || (g->state == MOT_SPEED_DOWN)) {    /* check step counter */
+        if (!--g->rest) {
+            g->state = MOT_JOB_READY;
+            return 1;
+        }
+    }
+
+    if (((g->state == MOT_RUN) || (g->state == MOT_SPEED_UP)) &&
+        (mc->a_stop > 0.0) && (mc->num_steps != 0)) {           /* See if you need to brake. */
+        if (g->rest <= steps_for_step_down (mc, g->steptime))
+            g->state = MOT_SPEED_DOWN;
+    }
+
+    return 1;
+}
+/*! --------------------------------------------------------------------
+ * @brief   generator for mot_setparam() with MOT_RAMP_FIXED. 
+ *           No sqrt(), no double division: one multiply (2*c) and one 
+ *           integer division per step of a ramp.
+ * @return  1 = step compiled, 0 = end of job
+ */
+static int gen_fixed (struct _mot_ctl_ *mc, struct _step_gen_ *g, struct _step_entry_ *e)
+{
+    float alpha = 0.0;
+
+    switch (g->state) {
+        case MOT_SPEED_UP:
+            if ((mc->num_steps > 0) && (g->count >= (uint64_t)mc->num_steps))   /* target number of steps reached */
+                return 0;
+            if (g->count > RAMP_EXACT) 
+                g->c -= (uint32_t)((((uint64_t)g->c << 1) + 2 * g->count) / (4 * g->count + 1));   /* rounded */
+            else if (g->count)
+                g->c = (uint32_t)(((uint64_t)g->c * ramp_up[g->count]) >> 16);
+            if (g->c <= g->c_min) {                             /* target speed reached */
+                g->c = g->c_min;
+                g->state = MOT_RUN;                             /* constant speed */
+            } else
+                alpha = mc->a_start;
+            break;
+
+        case MOT_RUN:
+            break;
+
+        case MOT_SPEED_DOWN:
+            if (!g->rest)
+                return 0;
+            if (g->rest > RAMP_EXACT)
+                g->c += (uint32_t)((((uint64_t)g->c << 1) + 2 * g->rest - 1) / (4 * g->rest - 1));   /* rounded */
+            else
+                g->c = (uint32_t)(((uint64_t)g->c * ramp_down[g->rest]) >> 16);
+            alpha = -mc->a_stop;
+            break;
+
+        default:
+            return 0;
+    }
+
+    e->steptime = g->c >> MOT_RAMP_FRAC;
+    e->omega = (g->dir == MOT_CCW) ? -g->phi_us / (float)g->c : g->phi_us / (float)g->c;
+    e->alpha = alpha;
+    e->dir = g->dir;
+    e->mode = g->state;
+    g->count++;
+
+    if (!mc->flag.endless || (g->state == MOT_SPEED_DOWN)) {    /* check step counter */
+        if (!--g->rest) {
+            g->state = MOT_JOB_READY;
+            return 1;
+        }
+    }
+
+    if ((g->count == g->brake_at) && (g->state != MOT_SPEED_DOWN))  /* braking point */
+        g->state = MOT_SPEED_DOWN;
+
+    return 1;
+}
+/*! --------------------------------------------------------------------
+ * @brief   MOT_RAMP_FIXED: first step delay and braking point of a job.
+ *           Speed-up steps   n_up   = omega² / (2 * a_start * phi_per_step)
+ *           Speed-down steps n_down = omega² / (2 * a_stop * phi_per_step)
+ *           If n_up + n_down > num_steps, the target speed is not reached
+ *           and the speed-down starts after num_steps * a_stop / (a_start + a_stop).
+ */
+static void fixed_start (struct _mot_ctl_ *mc, struct _step_gen_ *g)
+{
+    double c_min = (double)mc->steptime * (double)(1 << MOT_RAMP_FRAC);
+    double c0, n_down, n_up;
+
+    g->phi_us = (float)(mc->phi_per_step * 1000000.0 * (double)(1 << MOT_RAMP_FRAC));
+    g->c_min = (uint32_t)c_min;
+    g->c = g->c_min;
+    g->brake_at = 0;
+
+    if (mc->a_start > 0.0) {
+        c0 = sqrt (2.0 * mc->phi_per_step / mc->a_start) * 1000000.0 * (double)(1 << MOT_RAMP_FRAC);
+        g->c = (c0 < (double)UINT32_MAX) ? (uint32_t)c0 : UINT32_MAX;
+        if (g->c < g->c_min)
+            g->c = g->c_min;
+    }
+
+    if ((mc->a_stop > 0.0) && (mc->num_steps > 0)) {
+        n_down = steps_for_step_down (mc, mc->steptime);
+        g->brake_at = (mc->num_steps > n_down) ? mc->num_steps - (uint64_t)n_down : 1;
+        if (mc->a_start > 0.0) {
+            n_up = mc->omega * mc->omega / 2.0 / mc->a_start / mc->phi_per_step;
+            if (n_up + n_down > (double)mc->num_steps)              /* target speed is not reached */
+                g->brake_at = (uint64_t)((double)mc->num_steps * mc->a_stop / (mc->a_start + mc->a_stop) + 0.5);
+        }
+        if (!g->brake_at)
+            g->brake_at = 1;
+    }
+}
+/*! --------------------------------------------------------------------
+ * @brief   generator for the move queue. Every step the new speed is 
+ *           the minimum of the speed-up to the cruise speed and of the 
+ *           speed, from which the exit speed is reached with a_stop in the 
+ *           remaining steps. So the last step of a move ends with the exit
+ *           speed and the next move starts with it.
+ *           The compiled moves are released: mc->q_out++
+ * @return  1 = step compiled, 0 = end of job
+ */
+static int gen_queue (struct _mot_ctl_ *mc, struct _step_gen_ *g, struct _step_entry_ *e)
+{
+    struct _mot_move_ *mv;
+    double w = g->omega, w_up, w_down, t;
+
+    while (!g->rest) {                                  /* next move */
+        if (g->mv && (g->mv != &g->stop))
+            __atomic_store_n (&mc->q_out, mc->q_out + 1, __ATOMIC_RELEASE);
+        g->mv = NULL;
+        if (mc->q_out == mc->q_in)
+            return 0;
+        g->mv = &mc->queue[mc->q_out & (MOT_QUEUE_SIZE - 1)];
+        g->stop = *g->mv;                               /* ramps for mot_stop() */
+        g->rest = g->mv->steps;
+        g->dir = g->mv->dir;                            /* the planner stops before a change of direction */
+    }
+    mv = g->mv;
+
+    w_up = (mv->a_start > 0.0) ? sqrt (w * w + 2.0 * mv->a_start * mc->phi_per_step) : mv->omega;
+    if (w_up > mv->omega)
+        w_up = mv->omega;
+    w_down = w_up;
+    if (mv->a_stop > 0.0)
+        w_down = sqrt (mv->exit * mv->exit + 2.0 * mv->a_stop * mc->phi_per_step * (double)(g->rest - 1));
+    else if (g->rest == 1)
+        w_down = mv->exit;
+
+    if (w_down < w_up) {
+        g->omega = w_down;
+        g->state = (w_down < w) ? MOT_SPEED_DOWN : (w_down > w) ? MOT_SPEED_UP : MOT_RUN;
+    } else {
+        g->omega = w_up;
+        g->state = (w_up > w) ? MOT_SPEED_UP : MOT_RUN;
+    }
+
+    if (w + g->omega > 0.0)
+        t = 2.0 * mc->phi_per_step / (w + g->omega);
+    else                                                /* move of one step from standstill */
+        t = sqrt (2.0 * mc->phi_per_step / ((mv->a_start > 0.0) ? mv->a_start : 1.0));
+    g->steptime = step_us (g, t);
+
+    e->steptime = g->steptime;
+    e->omega = (g->dir == MOT_CCW) ? -g->omega : g->omega;
+    e->alpha = (g->omega - w) / t;
+    e->dir = g->dir;
+    e->mode = g->state;
+    g->count++;
+    g->rest--;
+
+    return 1;
+}
+/*! --------------------------------------------------------------------
+ * @brief   time of the next step [s]. Newton iteration, started with 
+ *           the time of the last step. 
+ * @param   w = speed [rad/s], a = acceleration [s⁻2], j = jerk [s⁻3]
+ *           phi = angle per step [rad], t = time of the last step [s]
+ * @return  0.0 = the speed reaches zero during the step
+ */
+static double scurve_step_time (double w, double a, double j, double phi, double t)
+{
+    double v, f;
+    int i;
+
+    for (i = 0; i < 8; i++) {
+        v = w + a * t + j * t * t / 2.0;                /* speed at the end of the step */
+        if (v <= 0.0) {                                 /* t is too long */
+            t /= 2.0;
+            continue;
+        }
+        f = (w + a * t / 2.0 + j * t * t / 6.0) * t - phi;
+        t -= f / v;
+        if (t <= 0.0)
+            return 0.0;
+        if (fabs (f) < phi * 1e-6)
+            return t;
+    }
+
+    return (w + a * t + j * t * t / 2.0 > 0.0) ? t : 0.0;
+}
+/*! --------------------------------------------------------------------
+ * @brief   1 = the S-curve speed-down needs rest steps or more.
+ *           Like calc_phi_for_scurve_down() without sqrt().
+ */
+static int scurve_must_brake (struct _mot_ctl_ *mc, struct _step_gen_ *g)
+{
+    double w = g->omega, a = g->alpha, j = g->jerk, d = mc->a_stop;
+    double phi = (double)g->rest * mc->phi_per_step;
+    double t, phi0 = 0.0;
+
+    if (a > 0.0) {                                      /* acceleration => 0 */
+        t = a / j;
+        phi0 = w * t + a * t * t / 2.0 - j * t * t * t / 6.0;
+        w += a * a / 2.0 / j;
+    }
+    if (w * j >= d * d)
+        return (phi0 + w / 2.0 * (w / d + d / j) >= phi);
+    if (phi <= phi0)
+        return 1;
+
+    return (w * w * w / j >= (phi - phi0) * (phi - phi0));  /* phi0 + w * sqrt(w/j) >= phi */
+}
+/*! --------------------------------------------------------------------
+ * @brief   generator for mot_setparam_scurve(). Speed-up, run, speed-down
+ *           with limited jerk. Every state has the phases SC_JERK, 
+ *           SC_CONST and SC_RELEASE. The changes of the phases are checked 
+ *           after every step.
+ * @return  1 = step compiled, 0 = end of job
+ */
+static int gen_scurve (struct _mot_ctl_ *mc, struct _step_gen_ *g, struct _step_entry_ *e)
+{
+    double j = 0.0, t, a;
+
+    switch (g->state) {
+        case MOT_SPEED_UP:
+            if ((mc->num_steps > 0) && (g->count >= (uint64_t)mc->num_steps))   /* target number of steps reached */
+                return 0;
+            if (g->phase == SC_JERK)
+                j = g->jerk;
+            else if (g->phase == SC_RELEASE)
+                j = -g->jerk;
+            break;
+
+        case MOT_RUN:
+            break;
+
+        case MOT_SPEED_DOWN:
+            if (!g->rest)
+                return 0;
+            if (g->phase == SC_JERK)
+                j = -g->jerk;
+            else if (g->phase == SC_RELEASE)
+                j = g->jerk;
+            break;
+
+        default:
+            return 0;
+    }
+
+    if (g->state != MOT_RUN) {
+        t = scurve_step_time (g->omega, g->alpha, j, mc->phi_per_step, g->t);
+        if (t == 0.0) {                                 /* speed-down: the speed reaches zero before the last step */
+            g->omega = g->omega_min;
+            g->alpha = 0.0;
+            g->phase = SC_CONST;
+            t = mc->phi_per_step / g->omega;
+        } else {
+            g->omega += (g->alpha + j * t / 2.0) * t;
+            g->alpha += j * t;
+        }
+        g->t = t;
+        g->steptime = step_us (g, t);                   /* steptime in us */
+
+        a = g->alpha;
+        if (g->state == MOT_SPEED_UP) {
+            if ((g->phase == SC_JERK) && (a >= mc->a_start)) {
+                g->alpha = mc->a_start;
+                g->phase = SC_CONST;
+            }
+            if ((g->phase != SC_RELEASE) && (g->omega + a * t >= mc->omega - a * a / 2.0 / g->jerk))
+                g->phase = SC_RELEASE;                  /* alpha reaches zero at the target speed */
+            if ((g->phase == SC_RELEASE) && ((a <= 0.0) || (g->omega >= mc->omega))) {
+                g->omega = mc->omega;
+                g->alpha = 0.0;
+                g->state = MOT_RUN;                     /* constant speed */
+            }
+        } else {
+            if ((g->phase == SC_JERK) && (a <= -mc->a_stop)) {
+                g->alpha = -mc->a_stop;
+                g->phase = SC_CONST;
+            }
+            if ((g->phase != SC_RELEASE) && (a < 0.0) && (g->omega + a * t <= a * a / 2.0 / g->jerk))
+                g->phase = SC_RELEASE;                  /* alpha reaches zero at speed zero */
+            if (((g->phase == SC_RELEASE) && (a >= 0.0)) || (g->omega < g->omega_min)) {
+                g->omega = (g->omega < g->omega_min) ? g->omega_min : g->omega;
+                g->alpha = 0.0;
+                g->phase = SC_CONST;                    /* the last steps with constant speed */
+            }
+        }
+    }
+
+    e->steptime = g->steptime;
+    e->omega = (g->dir == MOT_CCW) ? -g->omega : g->omega;
+    e->alpha = g->alpha;
+    e->dir = g->dir;
+    e->mode = g->state;
+    g->count++;
+
+    if (!mc->flag.endless || (g->state == MOT_SPEED_DOWN)) {    /* check step counter */
+        if (!--g->rest) {
+            g->state = MOT_JOB_READY;
+            return 1;
+        }
+    }
+
+    if (((g->state == MOT_RUN) || (g->state == MOT_SPEED_UP)) &&
+        (mc->a_stop > 0.0) && (mc->num_steps != 0)) {           /* See if you need to brake. */
+        if (scurve_must_brake (mc, g)) {
+            g->state = MOT_SPEED_DOWN;
+            g->phase = SC_JERK;
+        }
+    }
+
+    return 1;
+}
+/*! --------------------------------------------------------------------
+ * @brief   generator for motion diagrams. see: mot_start_md()
+ * @return  1 = step compiled, 0 = end of job
+ */
+static int gen_md (struct _mot_ctl_ *mc, struct _step_gen_ *g, struct _step_entry_ *e)
+{
+    for (;;) {
+        switch (g->state) {
+            case MOT_START_MD: {                        /* set the next motion-point */
+                    struct _motion_diagram_ *md = g->mp->owner;
+                    struct _move_point_ *next = __atomic_load_n (&g->mp->next, __ATOMIC_ACQUIRE);
+
+                    if (!next && md->stream) {          /* stream: the last point can be appended before closing */
+                        if (__atomic_load_n (&md->stream, __ATOMIC_ACQUIRE) == MD_STREAM_OPEN) {
+                            md->underrun++;             /* ring is empty: no step, check again later */
+                            e->steptime = MD_STREAM_WAIT_US;
+                            e->omega = 0.0;
+                            e->alpha = 0.0;
+                            e->dir = g->dir;
+                            e->mode = MOT_WAIT_MD;
+                            return 1;
+                        }
+                        next = __atomic_load_n (&g->mp->next, __ATOMIC_ACQUIRE);
+                    }
+                    if (!next) {
+                        g->state = MOT_JOB_READY;
+                        return 0;
+                    }
+                    if (next->delta_t != 0.0) {
+                        g->mp_step = 0;
+                        g->mp_t = 0.0;
+                        g->omega = g->mp->omega;        /* next->prev */
+                        g->state = MOT_RUN_MD;
+                    }
+                    if (md->stream && (g->mp != md->first_mp))      /* the point is released for the reader of the stream */
+                        __atomic_store_n (&md->mp_done, md->mp_done + 1, __ATOMIC_RELEASE);
+                    g->mp = next;
+                    g->mp->current_step = 0;
+                }
+                break;
+
+            case MOT_RUN_MD: {
+                    if (g->mp_step >= g->mp->steps) {    /* end of motion point */
+                        g->t_frac += (g->mp->delta_t - g->mp_t) * 1000000.0;   /* the angle of a part step is not */
+                        g->mp_t = 0.0;                          /* stepped, its time is carried */
+                        g->state = MOT_START_MD;
+                        break;
+                    }
+
+                    double t;
+                    double new_omega;
+                    if (g->mp->a == 0.0) {                  /* omega const. */
+                        new_omega = g->mp->omega;
+                        t = mc->phi_per_step / new_omega;
+                    } else {
+                        double faktor = 1.0;                /* CW */
+                        if ((g->omega < 0.0) ||             /* CCW */
+                            ((g->omega == 0.0) && (g->mp->a < 0.0))) {
+                            faktor = -1.0;
+                        }
+                        new_omega = sqrt((g->omega * g->omega) + 2.0*(g->mp->a)*faktor*mc->phi_per_step) * faktor;
+                        t = (2.0 * faktor*mc->phi_per_step) / (g->omega + new_omega);
+                    }
+
+                    if (new_omega < 0.0)
+                        g->dir = MOT_CCW;
+                    else if (new_omega > 0.0)
+                        g->dir = MOT_CW;
+
+                    g->steptime = step_us (g, fabs(t));
+                    g->mp_t += fabs(t);
+                    g->omega = new_omega;
+                    g->mp->current_step = ++g->mp_step;
+
+                    e->steptime = g->steptime;
+                    e->omega = new_omega;
+                    e->alpha = (new_omega < 0.0) ? -g->mp->a : g->mp->a;
+                    e->dir = g->dir;
+                    e->mode = MOT_RUN_MD;
+                    g->count++;
+                }
+                return 1;
+
+            default:
+                return 0;
+        }
+    }
+}
+/*! --------------------------------------------------------------------
+ * @brief   select the generator of the constant acceleration ramps.
+ *           The engine of a running job is not changed.
+ * @param   engine = MOT_RAMP_DOUBLE or MOT_RAMP_FIXED
+ */
+int mot_set_ramp_engine (uint8_t engine)
+{
+    if ((engine != MOT_RAMP_DOUBLE) && (engine != MOT_RAMP_FIXED))
+        return EXIT_FAILURE;
+
+    ramp_engine = engine;
+
+    return EXIT_SUCCESS;
+}
+/*! --------------------------------------------------------------------
+ * @brief   compile steps until the chunk is full or the job is finished
+ */
+static void fill_chunk (struct _mot_ctl_ *mc, struct _step_chunk_ *ch)
+{
+    struct _step_gen_ *g = &mc->st.gen;
+    int (*gen)(struct _mot_ctl_ *, struct _step_gen_ *, struct _step_entry_ *);
+
+    if (g->mp)
+        gen = gen_md;
+    else if (mc->flag.queue)
+        gen = gen_queue;
+    else if (g->jerk > 0.0)
+        gen = gen_scurve;
+    else 
+        gen = (g->engine == MOT_RAMP_FIXED) ? gen_fixed : gen_ramp;
+    ch->count = 0;
+    ch->last = 0;
+    while (ch->count < STEP_CHUNK_SIZE) {
+        if (!gen (mc, g, &ch->entry[ch->count])) {
+            ch->last = 1;
+            break;
+        }
+        if (ch->entry[ch->count++].mode == MOT_WAIT_MD)     /* stream: the next points are compiled after the wait */
+            break;
+    }
+}
+/*! --------------------------------------------------------------------
+ * @brief   both chunks are compiled from the current generator state
+ */
+static void reset_table (struct _mot_ctl_ *mc)
+{
+    struct _step_table_ *st = &mc->st;
+
+    st->active = 0;
+    st->pos = 0;
+    st->back_ready = 0;
+    fill_chunk (mc, &st->chunk[0]);
+    step_table_fill (mc);
+}
+/*! --------------------------------------------------------------------
+ * @brief   compile the first chunks of a job.
+ *           mc->mc_mp != NULL => motion diagram, else ramp of mot_setparam()
+ */
+int step_table_start (struct _mot_ctl_ *mc)
+{
+    struct _step_gen_ *g;
+
+    if (!mc)
+        return EXIT_FAILURE;
+
+    g = &mc->st.gen;
+    g->count = 0;
+    g->dir = mc->flag.dir;
+    g->mp_step = 0;
+    g->jerk = mc->jerk;
+    g->alpha = 0.0;
+    g->t_frac = 0.0;
+    g->phase = SC_JERK;
+    g->engine = ramp_engine;
+
+    g->mv = NULL;
+    if (mc->flag.queue) {                           /* move queue */
+        g->mp = NULL;
+        g->omega = 0.0;
+        g->steptime = 0;
+        g->rest = 0;
+        g->state = MOT_SPEED_UP;
+    } else if (mc->mc_mp) {                         /* motion diagram */
+        g->mp = mc->mc_mp;
+        g->omega = mc->mc_mp->omega;
+        g->steptime = 0;
+        g->rest = 0;
+        g->state = MOT_START_MD;
+    } else {                                        /* ramp */
+        g->mp = NULL;
+        g->omega = (mc->a_start <= 0.0) ? mc->omega : 0.0;
+        g->steptime = mc->steptime;
+        g->rest = (mc->num_steps >= 0) ? mc->num_steps : 0;
+        g->state = (mc->a_start <= 0.0) ? MOT_RUN : MOT_SPEED_UP;
+        g->t = (double)mc->steptime / 1000000.0;
+        if (g->jerk > 0.0) {                        /* S-curve: first step from speed zero */
+            double t0 = cbrt (6.0 * mc->phi_per_step / g->jerk);
+            g->omega_min = g->jerk * t0 * t0 / 2.0;
+            if (g->state == MOT_SPEED_UP)
+                g->t = t0;
+        }
+        if (g->engine == MOT_RAMP_FIXED)
+            fixed_start (mc, g);
+    }
+    reset_table (mc);
+
+    return EXIT_SUCCESS;
+}
+/*! --------------------------------------------------------------------
+ * @brief   The compiled steps are dropped. A speed-down is compiled,
+ *           starting at the last executed step.
+ */
+int step_table_stop (struct _mot_ctl_ *mc)
+{
+    struct _step_gen_ *g;
+
+    if (!mc)
+        return EXIT_FAILURE;
+
+    g = &mc->st.gen;
+    g->mp = NULL;
+    g->dir = mc->flag.dir;
+    g->steptime = mc->current_steptime;
+    g->omega = fabs(mc->current_omega);
+    g->alpha = mc->current_alpha;
+    g->jerk = mc->jerk;
+    g->phase = SC_JERK;
+    g->t = (double)mc->current_steptime / 1000000.0;
+    if (g->jerk > 0.0) {
+        double t0 = cbrt (6.0 * mc->phi_per_step / g->jerk);
+        g->omega_min = g->jerk * t0 * t0 / 2.0;
+    }
+    g->state = MOT_JOB_READY;
+    g->c = mc->current_steptime << MOT_RAMP_FRAC;
+    g->brake_at = 0;
+    if (mc->flag.queue) {                           /* move queue: the moves are dropped, speed-down with a_stop of the move */
+        __atomic_store_n (&mc->q_out, mc->q_in, __ATOMIC_RELEASE);
+        g->mv = &g->stop;
+        g->stop.exit = 0.0;
+        g->stop.omega = g->omega;
+        g->rest = 0;
+        if (g->stop.a_stop > 0.0) 
+            g->rest = (uint64_t) ceil (g->omega * g->omega / 2.0 / g->stop.a_stop / mc->phi_per_step);
+        g->stop.steps = g->rest;
+        if (g->rest)
+            g->state = MOT_SPEED_DOWN;
+    } else if (mc->a_stop > 0.0) {                         /* stop with speed-down */
+        g->rest = (uint64_t) calc_steps_for_step_down (mc);
+        if (g->rest)
+            g->state = MOT_SPEED_DOWN;
+    }
+    reset_table (mc);
+
+    return EXIT_SUCCESS;
+}
+/*! --------------------------------------------------------------------
+ * @brief   fill the back chunk, if it is empty.
+ */
+int step_table_fill (struct _mot_ctl_ *mc)
+{
+    struct _step_table_ *st = &mc->st;
+
+    if (st->back_ready || st->chunk[st->active].last)
+        return EXIT_SUCCESS;
+
+    fill_chunk (mc, &st->chunk[st->active ^ 1]);
+    st->back_ready = 1;
+
+    return EXIT_SUCCESS;
+}
+/*! --------------------------------------------------------------------
+ * @brief   next step of the job. The chunks are switched, if the
+ *           active chunk is empty.
+ * @return  NULL = end of job
+ */
+struct _step_entry_ *step_table_peek (struct _mot_ctl_ *mc)
+{
+    struct _step_table_ *st = &mc->st;
+    struct _step_chunk_ *ch = &st->chunk[st->active];
+
+    if (st->pos < ch->count)
+        return &ch->entry[st->pos];
+
+    if (ch->last)
+        return NULL;
+
+    if (!st->back_ready)                            /* generator is too slow */
+        step_table_fill (mc);
+
+    st->active ^= 1;
+    st->pos = 0;
+    st->back_ready = 0;
+    ch = &st->chunk[st->active];
+
+    return (ch->count) ? &ch->entry[0] : NULL;
+}
+/*! --------------------------------------------------------------------
+ * @brief   coarse microstep: the next n steps are one pulse. 
+ *           see: mot_set_microstep()
+ * @param   us = sum of the steptimes of the steps [us]
+ * @return  number of the next steps (max. n) in the same direction, 
+ *           without MOT_WAIT_MD. The back chunk is used, if it is filled.
+ */
+uint32_t step_table_group (struct _mot_ctl_ *mc, uint32_t n, uint32_t *us)
+{
+    struct _step_table_ *st = &mc->st;
+    struct _step_chunk_ *ch = &st->chunk[st->active];
+    struct _step_entry_ *e;
+    uint16_t pos = st->pos;
+    uint8_t dir = ch->entry[pos].dir;
+    uint32_t i;
+
+    *us = 0;
+    for (i = 0; i < n; i++, pos++) {
+        if (pos >= ch->count) {                     /* continue with the back chunk */
+            if ((ch != &st->chunk[st->active]) || ch->last)
+                break;
+            if (!st->back_ready)
+                step_table_fill (mc);
+            ch = &st->chunk[st->active ^ 1];
+            pos = 0;
+            if (!ch->count)
+                break;
+        }
+        e = &ch->entry[pos];
+        if ((e->dir != dir) || (e->mode == MOT_WAIT_MD))
+            break;
+        *us += e->steptime;
+    }
+
+    return i;
+}
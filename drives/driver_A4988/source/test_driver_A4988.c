@@ -131,11 +131,12 @@ int main(int argc, char *argv[])
     int sn = 0;
     double speed_rpm[3] = {150.0, 53.5, 250.0};
     struct _motion_diagram_ *md = NULL;
+    struct _mot_snapshot_ st;                           /* state of m1. see: mot_snapshot() */
     
     init_mot_ctl ();
     show_usleep (1000000, 100000/2);       /* see: rpi_tools.h */
     
-    m1 = new_mot (ENABLE_PIN_M1, DIR_PIN_M1, STEP_PIN_M1, STEPS_PER_TURN);  /* create motor 1 */
+    m1 = new_mot (NULL, ENABLE_PIN_M1, DIR_PIN_M1, STEP_PIN_M1, STEPS_PER_TURN);  /* create motor 1 */
 
     md = new_md(m1);                     /* new motion diagram for motor 1 */
     init_motion_diagram (md);
@@ -146,11 +147,10 @@ int main(int argc, char *argv[])
     
     while (!ende) {        
         if ((key = check_keypressed(&c)) > 0) {         /* look for keypressed */        
+            mot_snapshot (m1, &st);
             switch ( c ) {
                 case 27:                                /* quit by ESC */                
-                    kill_all_mot ();                    /* make motors disenabled */
-                    thread_state.kill = 1;              /* set terminat flag */
-                    while (!thread_state.run);          /* wait for thread ending */
+                    kill_all_mot_ctrl ();               /* make motors disenabled, wait for thread ending */
                     ende = 1;
                     break;
                 case 'h':                   /* help */
@@ -158,15 +158,17 @@ int main(int argc, char *argv[])
                     break;
                 case 'x':                   /* one step CW */
                     mot_on_step (m1, MOT_CW);
-                    printf ("real_stepcount=%lli\n", (long long int) m1->real_stepcount);
+                    mot_snapshot (m1, &st);
+                    printf ("real_stepcount=%lli\n", (long long int) st.position);
                     break;
                 case 'y':                   /* one step CCW */
                     mot_on_step (m1, MOT_CCW);
-                    printf ("real_stepcount=%lli\n", (long long int) m1->real_stepcount);
+                    mot_snapshot (m1, &st);
+                    printf ("real_stepcount=%lli\n", (long long int) st.position);
                     break;
                 case '1':
                 case '2':                  /* set motor sequence */
-                    if (m1->mode == MOT_IDLE) {
+                    if (st.mode == MOT_IDLE) {
                         mot_setparam (m1, (c == '1') ? MOT_CW : MOT_CCW, 400, 3*G, 5*G);
                         mot_start (m1);
                     } else 
@@ -177,13 +179,13 @@ int main(int argc, char *argv[])
                     mot_set_rpm (m1, speed_rpm[sn]);                                      
                     break;
                 case '9':
-                    if (m1->flag.enable == 1) 
+                    if (st.enable == 1) 
                         mot_enable (m1);
                     else 
                         mot_disenable (m1);                        
                     break;                
                 case 'e':                   /* set endless motor sequence (steps = 0) */
-                    if (m1->mode == MOT_IDLE) {
+                    if (st.mode == MOT_IDLE) {
                         mot_setparam (m1, MOT_CW, 0, 3*G, 5*G);
                         mot_set_rpm (m1, 200.0);
                         mot_start (m1);
@@ -197,7 +199,7 @@ int main(int argc, char *argv[])
                     mot_fast_stop (m1);
                     break;
                 case 'r':                   /* repeat motor sequence */
-                    if (m1->mode == MOT_IDLE) 
+                    if (st.mode == MOT_IDLE) 
                         mot_start (m1);
                     else 
                         printf ("Can't start motor. Motor is running\n");
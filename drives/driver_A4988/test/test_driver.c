@@ -8,21 +8,60 @@
 #include <unistd.h>
 #include "../source/driver_A4988.h"
 
+#define JOBS  10                            /* jobs of m2, started by the callback */
+
+static int jobs = 0;
+
+/*! --------------------------------------------------------------------
+ * @brief  callback of m2 (worker thread of the controller): starts the 
+ *          next job, while main() posts the moves of m1
+ */
+static void restart (struct _mot_ctl_ *mc, void *arg)
+{
+    (void)arg;
+    if (__atomic_add_fetch (&jobs, 1, __ATOMIC_RELEASE) < JOBS) {
+        mot_setparam (mc, MOT_CW, 40, 200.0, 200.0);
+        mot_start (mc);
+    }
+}
+
 int main() {
-    struct _mot_ctl_ *m1 = NULL; 
+    struct _mot_ctl_ *m1 = NULL, *m2 = NULL; 
+    struct _mot_snapshot_ s1, s2;
+    int i;
     
+    mot_rt_init (NULL);                     /* optional: locked memory and fixed pools, see: mot_rt.c */
     init_mot_ctl ();    
-    sleep (1);
-    m1 = new_mot (25, 23, 24, 400);              /* GPIO_ENABLE PIN, GPIO_DIR PIN, GPIO_STEP PIN, steps_per_turn */
+    m1 = new_mot (NULL, 25, 23, 24, 400);        /* default controller, GPIO_ENABLE PIN, GPIO_DIR PIN, GPIO_STEP PIN, steps_per_turn */
     mot_setparam (m1, MOT_CW, 400, 20.0, 40.0);  /* 400 steps, speed up=20 s⁻2, speed down=40 s⁻2 */    
     mot_start (m1);
     
-    while (m1->flag.aktiv) sleep(1);        
+    mot_wait_job (m1, 0);                   /* sleeps until the end of the job */
+    
+    m2 = new_mot (NULL, 5, 6, 13, 400);          /* API of the callback and of main() at the same time */
+    mot_set_job_callback (m2, restart, NULL);
+    mot_setparam (m2, MOT_CW, 40, 200.0, 200.0);
+    mot_start (m2);
+    for (i = 0; i < 100; i++)
+        mot_queue_move (m1, MOT_CW, 4, 500, 200.0, 200.0);
+    mot_wait_job (m1, 0);
+    while (__atomic_load_n (&jobs, __ATOMIC_ACQUIRE) < JOBS)
+        usleep (1000);
+    mot_wait_job (m2, 0);
+    mot_snapshot (m1, &s1);
+    mot_snapshot (m2, &s2);
     
     mot_disenable (m1);
-    kill_all_mot ();                    
-    thread_state.kill = 1;
-    while (!thread_state.run); 
+    kill_all_mot_ctrl ();                   /* kills the motors and stops the driver thread */
+    
+    if (mot_rt_allocs () && (mot_rt_allocs () != MOT_RT_NO_CHECK)) {    /* see: rtcheck in Makefile */
+        printf ("-- the driver thread has allocated memory\n");
+        return 1;
+    }
+    if ((s1.position != 800) || (s2.position != 40 * JOBS)) {
+        printf ("-- lost commands: position m1=%lli m2=%lli\n", (long long)s1.position, (long long)s2.position);
+        return 1;
+    }
     
     return 0;
 }
@@ -1,4 +1,10 @@
 #!/bin/bash
 
 # opens all files with geany
-geany -s test_laser_sensor.c Makefile run.sh edit.sh ../readme.txt &
+gph="../../../tools/gpio/gpio.h"
+gpc="../../../tools/gpio/gpio.c"
+
+rlh="../../../tools/rt_log/rt_log.h"
+rlc="../../../tools/rt_log/rt_log.c"
+
+geany -s test_laser_sensor.c $gpc $gph $rlc $rlh Makefile run.sh edit.sh ../readme.txt &
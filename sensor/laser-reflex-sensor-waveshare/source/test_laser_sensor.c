@@ -8,7 +8,9 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <unistd.h>
-#include <wiringPi.h>
+
+#include "../../../tools/gpio/gpio.h"
+#include "../../../tools/rt_log/rt_log.h"
 
 /*! --------------------------------------------------------------------
  * 
@@ -17,24 +19,24 @@ int main(int argc, char *argv[])
 {	
     uint8_t state, last_state; 
 
-    printf ("Exit program with Strg+C\n");
+    rt_log_start (NULL);                        /* messages of gpio and of the test, see: rt_log.h */
+    rt_log ("Exit program with Strg+C\n");
 
-    if( wiringPiSetup() < 0) {
-        printf ("wiringPiSetup failed !\n");
+    if (gpio_init () != EXIT_SUCCESS) {
+        rt_log ("gpio_init failed !\n");
         return EXIT_FAILURE;
     } 
 
-    pinMode (26, INPUT);                        /* laser sensor DOUT-Pin GPIO.26 */
-    pullUpDnControl (26, PUD_OFF);              /* no Pullup no Pulldown */ 
+    gpio_mode (26, GPIO_INPUT);                 /* laser sensor DOUT-Pin GPIO.26, no Pullup no Pulldown */
 
-    last_state = state = digitalRead (26);
-    printf ("state = %i %s\n", state, (!state) ? "object detected" : "no detection");
+    last_state = state = gpio_read (26);
+    rt_log ("state = %i %s\n", state, (!state) ? "object detected" : "no detection");
 
     while (1) {
-        state = digitalRead (26);
+        state = gpio_read (26);
         if (state != last_state) {
             last_state = state;
-            printf ("state = %i %s\n", state, (!state) ? "object detected" : "no detection");
+            rt_log ("state = %i %s\n", state, (!state) ? "object detected" : "no detection");
         }
         usleep (1000);                           /* wait 1ms */
     }
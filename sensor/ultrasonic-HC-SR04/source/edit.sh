@@ -8,4 +8,10 @@ kpc="../../../tools/keypressed/keypressed.c"
 rth="../../../tools/rpi_tools/rpi_tools.h"
 rtc="../../../tools/rpi_tools/rpi_tools.c"
 
-geany -s test_hc_sr04.c  hc_sr04.c hc_sr04.h $kpc $kph $rtc $rth Makefile run.sh edit.sh ../readme.txt &
+gph="../../../tools/gpio/gpio.h"
+gpc="../../../tools/gpio/gpio.c"
+
+rlh="../../../tools/rt_log/rt_log.h"
+rlc="../../../tools/rt_log/rt_log.c"
+
+geany -s test_hc_sr04.c  hc_sr04.c hc_sr04.h $kpc $kph $rtc $rth $gpc $gph $rlc $rlh Makefile run.sh edit.sh ../readme.txt &
@@ -2,7 +2,8 @@
  * @file    hc_sr04.c
  * @date    09-16-2018
  * @name    Ulrich Buettemeier
- * @brief   program use wiringPi
+ * @brief   program use tools/gpio (wiringPi, gpio chardev or simulator)
+ *          messages are written with tools/rt_log
  */
  
 #include <stdio.h>
@@ -10,10 +11,11 @@
 #include <stdint.h>
 #include <unistd.h>
 #include <sys/time.h>
-#include <wiringPi.h>
 #include <pthread.h>
 
 #include "../../../tools/rpi_tools/rpi_tools.h"
+#include "../../../tools/gpio/gpio.h"
+#include "../../../tools/rt_log/rt_log.h"
 #include "hc_sr04.h"
 
 struct _hc_sr04_ *first_hc_sr04 = NULL, *end_hc_sr04 = NULL;   /* pointer to sensor list */
@@ -30,8 +32,8 @@ uint16_t akt_id = 0;                       /* counter for sensor identifire numb
  */
 struct _hc_sr04_ *new_hc_sr04 (uint8_t pin_trig, uint8_t pin_echo)
 {
-  if( wiringPiSetup() < 0) {
-    printf ("wiringPiSetup failed !\n");
+  if (gpio_init () != EXIT_SUCCESS) {
+    rt_log ("gpio_init failed !\n");
     return NULL;
   }    
     
@@ -46,10 +48,9 @@ struct _hc_sr04_ *new_hc_sr04 (uint8_t pin_trig, uint8_t pin_echo)
   sen->hc_sr04_dist_mm = 0;
   sen->last_hc_sr04_run_time = 1;
   
-  pinMode (sen->trig_pin, OUTPUT);    /* init gpio pins for this hc_sr04 */
-  pinMode (sen->echo_pin, INPUT);
-  pullUpDnControl (sen->echo_pin, PUD_UP);  /* pull-up resistor */
-  digitalWrite (sen->trig_pin, 0);	
+  gpio_mode (sen->trig_pin, GPIO_OUTPUT);       /* init gpio pins for this hc_sr04 */
+  gpio_mode (sen->echo_pin, GPIO_INPUT_PULLUP); /* pull-up resistor */
+  gpio_write (sen->trig_pin, 0);	
   
   sen->next = sen->prev = NULL;
   if (first_hc_sr04 == NULL) first_hc_sr04 = end_hc_sr04 = sen;
@@ -111,6 +112,7 @@ void start_hc_04_thread ()
   if ((void *)hc_sr04_thread == NULL) {    
     pthread_mutex_init(&hc_sr04_mutex, NULL);
     hc_sr04_end = 0;
+    rt_log_start (NULL);                                         /* messages of the thread, see: rt_log.h */
     pthread_create (&hc_sr04_thread, NULL, &run_hc_sr04, NULL);  /* starts measuring routine */
     usleep (250000);    
   } 
@@ -124,28 +126,25 @@ void stop_hc_04_thread ()
     hc_sr04_end = 1;
     while (hc_sr04_end == 1);	               /* wait for exit */
     pthread_mutex_destroy(&hc_sr04_mutex); 
+    rt_log_flush ();
     hc_sr04_thread = (pthread_t)NULL;                  /* thread handle */
   }
 }
 /*!	--------------------------------------------------------------------
- * @brief  wait until the echo signal has reached the value "state".
+ * @brief  wait while the echo signal has the value "state".
  *          If the waiting time is >= TIMEOUT, the function is ended.
+ *          With the gpio chardev the time of the edge is the kernel time stamp.
  * @return  waittime
  */
 int while_echo (struct _hc_sr04_ *sen, uint8_t state)
 {
-  int timediff;
-  struct timeval start, stop;
-  uint8_t end = 0;
+  uint64_t start, edge;
 
-  gettimeofday (&start, NULL);
-  while (!end) {
-    gettimeofday (&stop, NULL); 
-    if ((timediff = difference_micro (&start, &stop)) >= TIMEOUT) end = 2;
-    else if (digitalRead (sen->echo_pin) != state) end = 1;        
-  }    
+  start = edge = gpio_time_ns ();
+  if (gpio_wait_edge (sen->echo_pin, (state) ? GPIO_FALLING : GPIO_RISING, TIMEOUT, &edge) != EXIT_SUCCESS)
+    return TIMEOUT;
   
-  return timediff;
+  return (edge > start) ? (int)((edge - start) / 1000) : 0;
 }
 /*! --------------------------------------------------------------------
  * @brief  starts the measurement and calculates the distance
@@ -153,20 +152,25 @@ int while_echo (struct _hc_sr04_ *sen, uint8_t state)
 int get_dist (struct _hc_sr04_ *sen)
 {
   int timediff;
+  uint64_t rise, fall;                         /* time of the echo edges [ns] */
   
   if (sen == NULL) 
     return EXIT_FAILURE;
   
-  if (digitalRead (sen->echo_pin) == 0) {      /* check echo */
-    digitalWrite (sen->trig_pin, 0);
+  if (gpio_read (sen->echo_pin) == 0) {        /* check echo */
+    rise = gpio_time_ns ();                    /* older edges are dropped by gpio_wait_edge() */
+    gpio_write (sen->trig_pin, 0);
     usleep (2);
-    digitalWrite (sen->trig_pin, 1);
+    gpio_write (sen->trig_pin, 1);
     usleep (10);
-    digitalWrite (sen->trig_pin, 0);
+    gpio_write (sen->trig_pin, 0);
   
-    if (while_echo (sen, 0) < TIMEOUT) {
-      if ((timediff = while_echo (sen, 1)) >= TIMEOUT) 
+    if (gpio_wait_edge (sen->echo_pin, GPIO_RISING, TIMEOUT, &rise) == EXIT_SUCCESS) {
+      fall = rise;                             /* the falling edge after the rising one */
+      if (gpio_wait_edge (sen->echo_pin, GPIO_FALLING, TIMEOUT, &fall) != EXIT_SUCCESS) 
         timediff = 0;
+      else
+        timediff = (int)((fall - rise) / 1000);              /* echo time [us] */
       
       pthread_mutex_lock(&hc_sr04_mutex);                  /* enter critical section */
       sen->hc_sr04_run_time = timediff;
@@ -184,7 +188,8 @@ void *run_hc_sr04 (void *data)
 {
   struct _hc_sr04_ *sen;
 
-  printf ("-- thread run_hc_sr04 is running\n");
+  rt_log_thread ("run_hc_sr04");
+  rt_log ("-- thread run_hc_sr04 is running\n");
   while (!hc_sr04_end) {    
     sen = first_hc_sr04;
     while (sen != NULL) {
@@ -194,7 +199,7 @@ void *run_hc_sr04 (void *data)
     }    
   }
   hc_sr04_end = 2;
-  printf ("-- thread run_hc_sr04 killed\n");
+  rt_log ("-- thread run_hc_sr04 killed\n");
   
   return EXIT_SUCCESS;
 }
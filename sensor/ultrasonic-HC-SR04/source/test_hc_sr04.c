@@ -9,9 +9,9 @@
 #include <stdint.h>
 #include <unistd.h>
 #include <pthread.h>
-#include <wiringPi.h>
 
 #include "../../../tools/keypressed/keypressed.h"
+#include "../../../tools/gpio/gpio_sim.h"
 #include "hc_sr04.h"
 
 #define MAX_SENSOR 2
@@ -30,6 +30,10 @@ int main(int argc, char *argv[])
   
   sen = new_hc_sr04 (0, 1);      /* new sensor trig=0, echo=1 */  
   sen = new_hc_sr04 (21, 22);    /* new sensor trig=21, echo=22 */
+  if (gpio_selected () == GPIO_BE_SIM) {             /* simulated objects */
+    gpio_sim_response (0, 1, 500, 1166);          /* 200 mm */
+    gpio_sim_response (21, 22, 500, 2915);        /* 500 mm */
+  }
   start_hc_04_thread();          /* start measurement */
   
   while (!ende) {
@@ -0,0 +1,3 @@
+#!/bin/bash
+
+geany -s futex.h &
@@ -0,0 +1,43 @@
+/*! ---------------------------------------------------------------------
+ * @file    futex.h
+ * @date    10-17-2026
+ * @name    Ulrich Buettemeier
+ * @brief   wait on a 32 bit word of the process (Linux futex).
+ *          futex_wait() sleeps only, if the word has the value val, so a 
+ *          change of the word before the call is never lost.
+ * @example
+ *          waiter:                             waker:
+ *          while ((v = word) == old)           word++;
+ *              futex_wait (&word, old, 0);     futex_wake (&word, 1);
+ */
+
+#ifndef FUTEX_H
+#define FUTEX_H
+
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+/*! --------------------------------------------------------------------
+ * @param   t = CLOCK_MONOTONIC [ns], absolute. 0 = no timeout
+ * @return  0 = woken, -1 = timeout, signal or the word is not val
+ */
+static inline int futex_wait (uint32_t *word, uint32_t val, uint64_t t)
+{
+    struct timespec ts = { .tv_sec = (time_t)(t / 1000000000ull), .tv_nsec = (long)(t % 1000000000ull) };
+
+    return (int)syscall (SYS_futex, word, FUTEX_WAIT_BITSET | FUTEX_PRIVATE_FLAG, val,
+                         (t) ? &ts : NULL, NULL, FUTEX_BITSET_MATCH_ANY);
+}
+
+/*! --------------------------------------------------------------------
+ * @param   n = number of threads, INT32_MAX = all
+ */
+static inline int futex_wake (uint32_t *word, int n)
+{
+    return (int)syscall (SYS_futex, word, FUTEX_WAKE | FUTEX_PRIVATE_FLAG, n, NULL, NULL, 0);
+}
+
+#endif
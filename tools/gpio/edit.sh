@@ -0,0 +1,3 @@
+#!/bin/bash
+
+geany -s gpio.c gpio.h gpio_mem.c gpio_mem.h gpio_sim.c gpio_sim.h &
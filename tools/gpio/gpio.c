@@ -0,0 +1,447 @@
+/*! ---------------------------------------------------------------------
+ * @file    gpio.c
+ * @date    10-16-2026
+ * @name    Ulrich Buettemeier
+ * @brief   gpio access with exchangeable backends.
+ *          The backend is selected with gpio_select() before gpio_init().
+ *          wiringPi is only compiled with -DUSE_WIRINGPI, so the programs
+ *          can be built on hosts without wiringPi (target = amd64) and
+ *          run with the simulator.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/ioctl.h>
+
+#ifdef USE_WIRINGPI
+#include <wiringPi.h>
+#endif
+
+#ifdef __linux__
+#include <linux/gpio.h>
+#endif
+
+#include "gpio.h"
+#include "gpio_mem.h"
+#include "gpio_sim.h"
+#include "../rt_log/rt_log.h"
+
+#define GPIO_CHIP "/dev/gpiochip0"
+#define GPIO_PINS 32                                        /* wiringPi pins */
+
+const struct _gpio_backend_ *gpio_backend = NULL;           /* selected backend */
+
+static uint8_t selected = GPIO_DEFAULT;
+static uint8_t is_init = 0;
+
+/*! --------------------------------------------------------------------
+ * @return  CLOCK_MONOTONIC [ns]
+ */
+uint64_t gpio_time_ns (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+/*! --------------------------------------------------------------------
+ * @brief   wait for a level by polling. used by backends without edge events
+ */
+static int poll_edge (int pin, uint8_t edge, uint32_t timeout_us, uint64_t *t_ns)
+{
+    uint64_t start = gpio_time_ns ();
+    uint64_t now = start;
+
+    for (;;) {
+        if (gpio_backend->read (pin) == edge) {
+            if (t_ns)
+                *t_ns = now;
+            return EXIT_SUCCESS;
+        }
+        now = gpio_time_ns ();
+        if (now - start >= (uint64_t)timeout_us * 1000)
+            return EXIT_FAILURE;
+    }
+}
+
+/* ---------------------------------------------------------------------
+ * wiringPi
+ */
+#ifdef USE_WIRINGPI
+static int wpi_init (void)
+{
+    if (wiringPiSetup () < 0) {
+        rt_log ("-- wiringPiSetup failed !\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+static void wpi_close (void)
+{
+}
+
+static void wpi_mode (int pin, uint8_t mode)
+{
+    if (mode == GPIO_OUTPUT) {
+        pinMode (pin, OUTPUT);
+        return;
+    }
+
+    pinMode (pin, INPUT);
+    pullUpDnControl (pin, (mode == GPIO_INPUT_PULLUP) ? PUD_UP : (mode == GPIO_INPUT_PULLDOWN) ? PUD_DOWN : PUD_OFF);
+}
+
+static void wpi_write (int pin, uint8_t value)
+{
+    digitalWrite (pin, value);
+}
+
+static int wpi_read (int pin)
+{
+    return digitalRead (pin);
+}
+
+static const struct _gpio_backend_ wpi_backend = {
+    "wiringPi", wpi_init, wpi_close, wpi_mode, wpi_write, wpi_read, NULL
+};
+#endif
+
+/* ---------------------------------------------------------------------
+ * gpio registers. The pull-up/down resistors are not set.
+ */
+static int mem_init (void)
+{
+    return gpio_mem_init (GPIO_MEM_HW);
+}
+
+static int emu_init (void)
+{
+    return gpio_mem_init (GPIO_MEM_EMULATED);
+}
+
+static void mem_mode (int pin, uint8_t mode)
+{
+    gpio_mem_mode (pin, (mode == GPIO_OUTPUT));
+}
+
+static const struct _gpio_backend_ mem_backend = {
+    "gpiomem", mem_init, gpio_mem_close, mem_mode, gpio_mem_write, gpio_mem_read, NULL
+};
+
+static const struct _gpio_backend_ emu_backend = {
+    "gpiomem (emulated)", emu_init, gpio_mem_close, mem_mode, gpio_mem_write, gpio_mem_read, NULL
+};
+
+/* ---------------------------------------------------------------------
+ * gpio character device (gpio uAPI v2). Every pin is a line request.
+ * Inputs are requested with edge detection, so gpio_wait_edge() uses
+ * the time stamps of the kernel.
+ */
+#ifdef GPIO_V2_GET_LINE_IOCTL
+static int chip_fd = -1;
+static int line_fd[GPIO_PINS];
+
+static int cdev_init (void)
+{
+    int i;
+
+    if ((chip_fd = open (GPIO_CHIP, O_RDWR | O_CLOEXEC)) < 0) {
+        perror ("-- open " GPIO_CHIP);
+        return EXIT_FAILURE;
+    }
+    for (i = 0; i < GPIO_PINS; i++)
+        line_fd[i] = -1;
+
+    return EXIT_SUCCESS;
+}
+
+static void cdev_close (void)
+{
+    int i;
+
+    for (i = 0; i < GPIO_PINS; i++) {
+        if (line_fd[i] >= 0)
+            close (line_fd[i]);
+        line_fd[i] = -1;
+    }
+    if (chip_fd >= 0)
+        close (chip_fd);
+    chip_fd = -1;
+}
+
+static void cdev_mode (int pin, uint8_t mode)
+{
+    struct gpio_v2_line_request req;
+    int bcm = gpio_mem_bcm (pin);
+
+    if ((bcm < 0) || (chip_fd < 0))
+        return;
+
+    if (line_fd[pin] >= 0) {
+        close (line_fd[pin]);
+        line_fd[pin] = -1;
+    }
+
+    memset (&req, 0, sizeof(req));
+    req.offsets[0] = bcm;
+    req.num_lines = 1;
+    strncpy (req.consumer, "rpi-robotics", sizeof(req.consumer) - 1);
+    if (mode == GPIO_OUTPUT)
+        req.config.flags = GPIO_V2_LINE_FLAG_OUTPUT;
+    else {
+        req.config.flags = GPIO_V2_LINE_FLAG_INPUT | GPIO_V2_LINE_FLAG_EDGE_RISING | GPIO_V2_LINE_FLAG_EDGE_FALLING;
+        if (mode == GPIO_INPUT_PULLUP)
+            req.config.flags |= GPIO_V2_LINE_FLAG_BIAS_PULL_UP;
+        else if (mode == GPIO_INPUT_PULLDOWN)
+            req.config.flags |= GPIO_V2_LINE_FLAG_BIAS_PULL_DOWN;
+        else
+            req.config.flags |= GPIO_V2_LINE_FLAG_BIAS_DISABLED;
+    }
+
+    if (ioctl (chip_fd, GPIO_V2_GET_LINE_IOCTL, &req) < 0) {
+        rt_log ("-- gpio line %i (BCM %i) request failed\n", pin, bcm);
+        return;
+    }
+    fcntl (req.fd, F_SETFL, fcntl (req.fd, F_GETFL) | O_NONBLOCK);
+    line_fd[pin] = req.fd;
+}
+
+static void cdev_write (int pin, uint8_t value)
+{
+    struct gpio_v2_line_values v;
+
+    if ((pin < 0) || (pin >= GPIO_PINS) || (line_fd[pin] < 0))
+        return;
+
+    v.bits = value ? 1 : 0;
+    v.mask = 1;
+    ioctl (line_fd[pin], GPIO_V2_LINE_SET_VALUES_IOCTL, &v);
+}
+
+static int cdev_read (int pin)
+{
+    struct gpio_v2_line_values v;
+
+    if ((pin < 0) || (pin >= GPIO_PINS) || (line_fd[pin] < 0))
+        return 0;
+
+    v.bits = 0;
+    v.mask = 1;
+    if (ioctl (line_fd[pin], GPIO_V2_LINE_GET_VALUES_IOCTL, &v) < 0)
+        return 0;
+
+    return (int)(v.bits & 1);
+}
+
+static int cdev_wait_edge (int pin, uint8_t edge, uint32_t timeout_us, uint64_t *t_ns)
+{
+    struct gpio_v2_line_event ev;
+    struct pollfd pfd;
+    struct timespec ts;
+    uint64_t since = (t_ns) ? *t_ns : 0;
+    uint64_t now, end;
+    uint32_t id = (edge) ? GPIO_V2_LINE_EVENT_RISING_EDGE : GPIO_V2_LINE_EVENT_FALLING_EDGE;
+    uint8_t first = 1, newer = 0;
+
+    if ((pin < 0) || (pin >= GPIO_PINS) || (line_fd[pin] < 0))
+        return EXIT_FAILURE;
+
+    end = gpio_time_ns () + (uint64_t)timeout_us * 1000;
+    pfd.fd = line_fd[pin];
+    pfd.events = POLLIN;
+    for (;;) {
+        while (read (line_fd[pin], &ev, sizeof(ev)) == sizeof(ev)) {   /* the events in the order of the edges */
+            if (ev.timestamp_ns < since)                    /* before the start of the wait, dropped */
+                continue;
+            newer = 1;
+            if (ev.id == id) {                              /* later events stay in the queue */
+                if (t_ns)
+                    *t_ns = ev.timestamp_ns;
+                return EXIT_SUCCESS;
+            }
+        }
+        if (first && !newer && (cdev_read (pin) == edge)) {     /* no edge queued, the line has the level */
+            if (t_ns)
+                *t_ns = gpio_time_ns ();
+            return EXIT_SUCCESS;
+        }
+        first = 0;
+
+        if ((now = gpio_time_ns ()) >= end)
+            return EXIT_FAILURE;
+        ts.tv_sec = (end - now) / 1000000000ull;
+        ts.tv_nsec = (end - now) % 1000000000ull;
+        ppoll (&pfd, 1, &ts, NULL);
+    }
+}
+
+static const struct _gpio_backend_ cdev_backend = {
+    "gpio chardev", cdev_init, cdev_close, cdev_mode, cdev_write, cdev_read, cdev_wait_edge
+};
+#endif
+
+/* ---------------------------------------------------------------------
+ * null backend: the pin changes are dropped
+ */
+static int null_init (void)
+{
+    return EXIT_SUCCESS;
+}
+
+static void null_close (void)
+{
+}
+
+static void null_mode (int pin, uint8_t mode)
+{
+    (void)pin;
+    (void)mode;
+}
+
+static void null_write (int pin, uint8_t value)
+{
+    (void)pin;
+    (void)value;
+}
+
+static int null_read (int pin)
+{
+    (void)pin;
+    return 0;
+}
+
+static const struct _gpio_backend_ null_backend = {
+    "null", null_init, null_close, null_mode, null_write, null_read, NULL
+};
+
+/*! --------------------------------------------------------------------
+ * @brief   select the backend. Must be called before gpio_init().
+ * @param   backend = see: enum GPIO_BACKEND
+ */
+int gpio_select (uint8_t backend)
+{
+    if (is_init) {
+        if (backend == selected)
+            return EXIT_SUCCESS;
+        rt_log ("-- gpio backend can't be changed after gpio_init()\n");
+        return EXIT_FAILURE;
+    }
+
+    switch (backend) {
+#ifdef USE_WIRINGPI
+        case GPIO_BE_WIRINGPI:
+#endif
+#ifdef GPIO_V2_GET_LINE_IOCTL
+        case GPIO_BE_CHARDEV:
+#endif
+        case GPIO_BE_MEM:
+        case GPIO_BE_MEM_EMULATED:
+        case GPIO_BE_SIM:
+        case GPIO_BE_NULL:
+            selected = backend;
+            return EXIT_SUCCESS;
+
+        default:
+            rt_log ("-- gpio backend %u is not available\n", backend);
+            return EXIT_FAILURE;
+    }
+}
+
+uint8_t gpio_selected (void)
+{
+    return selected;
+}
+/*! --------------------------------------------------------------------
+ * @brief   initializes the selected backend. Further calls do nothing.
+ */
+int gpio_init (void)
+{
+    const struct _gpio_backend_ *be = NULL;
+
+    if (is_init)
+        return EXIT_SUCCESS;
+
+    switch (selected) {
+#ifdef USE_WIRINGPI
+        case GPIO_BE_WIRINGPI: be = &wpi_backend; break;
+#endif
+#ifdef GPIO_V2_GET_LINE_IOCTL
+        case GPIO_BE_CHARDEV: be = &cdev_backend; break;
+#endif
+        case GPIO_BE_MEM: be = &mem_backend; break;
+        case GPIO_BE_MEM_EMULATED: be = &emu_backend; break;
+        case GPIO_BE_SIM: be = &gpio_sim_backend; break;
+        case GPIO_BE_NULL: be = &null_backend; break;
+        default: return EXIT_FAILURE;
+    }
+
+    if (be->init () != EXIT_SUCCESS)
+        return EXIT_FAILURE;
+
+    gpio_backend = be;
+    is_init = 1;
+    rt_log ("-- gpio: %s\n", be->name);
+
+    return EXIT_SUCCESS;
+}
+/*! --------------------------------------------------------------------
+ *
+ */
+void gpio_close (void)
+{
+    if (!is_init)
+        return;
+
+    gpio_backend->close ();
+    gpio_backend = NULL;
+    is_init = 0;
+}
+/*! --------------------------------------------------------------------
+ *
+ */
+void gpio_mode (int pin, uint8_t mode)
+{
+    if (gpio_backend)
+        gpio_backend->mode (pin, mode);
+}
+
+void gpio_write (int pin, uint8_t value)
+{
+    if (gpio_backend)
+        gpio_backend->write (pin, value);
+}
+
+int gpio_read (int pin)
+{
+    return (gpio_backend) ? gpio_backend->read (pin) : 0;
+}
+/*! --------------------------------------------------------------------
+ * @brief   wait until the pin has the level of edge.
+ *          Returns at once, if the pin has this level.
+ *          gpio chardev: the edge is taken from the event queue of the 
+ *          line with the kernel time stamp. Events before *t_ns are dropped,
+ *          the events after the edge stay queued for the next call. The 
+ *          current level is only used, if no later event is queued.
+ * @param   t_ns = in: start of the wait [ns], 0 = all queued events.
+ *                 out: time of the edge [ns]. CLOCK_MONOTONIC. Can be NULL.
+ * @return  EXIT_FAILURE = timeout
+ */
+int gpio_wait_edge (int pin, uint8_t edge, uint32_t timeout_us, uint64_t *t_ns)
+{
+    if (!gpio_backend)
+        return EXIT_FAILURE;
+
+    if (gpio_backend->wait_edge)
+        return gpio_backend->wait_edge (pin, edge, timeout_us, t_ns);
+
+    return poll_edge (pin, edge, timeout_us, t_ns);
+}
@@ -0,0 +1,67 @@
+/*! ---------------------------------------------------------------------
+ * @file    gpio.h
+ * @date    10-16-2026
+ * @name    Ulrich Buettemeier
+ * @brief   gpio access with exchangeable backends.
+ *          wiringPi, /dev/gpiomem, gpio character device, a simulator
+ *          and a null backend.
+ *          The pins are wiringPi pin numbers for all backends.
+ */
+
+#ifndef GPIO_H
+#define GPIO_H
+
+#include <stdint.h>
+
+enum GPIO_BACKEND {
+    GPIO_BE_WIRINGPI = 0,           /* wiringPi. Only with -DUSE_WIRINGPI (Makefile target = bmc) */
+    GPIO_BE_MEM = 1,                /* registers via /dev/gpiomem. see: gpio_mem.h */
+    GPIO_BE_MEM_EMULATED = 2,       /* register file in memory */
+    GPIO_BE_CHARDEV = 3,            /* gpio character device /dev/gpiochip0 */
+    GPIO_BE_SIM = 4,                /* simulator. see: gpio_sim.h */
+    GPIO_BE_NULL = 5                /* writes are dropped, reads are 0. For benchmarks of the callers */
+};
+
+#ifdef USE_WIRINGPI
+#define GPIO_DEFAULT GPIO_BE_WIRINGPI
+#else
+#define GPIO_DEFAULT GPIO_BE_SIM
+#endif
+
+enum GPIO_PIN_MODE {
+    GPIO_INPUT = 0,
+    GPIO_OUTPUT = 1,
+    GPIO_INPUT_PULLUP = 2,
+    GPIO_INPUT_PULLDOWN = 3
+};
+
+enum GPIO_EDGE {
+    GPIO_FALLING = 0,               /* wait for level 0 */
+    GPIO_RISING = 1                 /* wait for level 1 */
+};
+
+struct _gpio_backend_ {
+    const char *name;
+    int (*init) (void);
+    void (*close) (void);
+    void (*mode) (int pin, uint8_t mode);
+    void (*write) (int pin, uint8_t value);
+    int (*read) (int pin);
+    int (*wait_edge) (int pin, uint8_t edge, uint32_t timeout_us, uint64_t *t_ns);   /* NULL = polling with read() */
+};
+
+extern const struct _gpio_backend_ *gpio_backend;            /* selected backend */
+
+extern int gpio_select (uint8_t backend);                   /* see: enum GPIO_BACKEND. Before gpio_init() */
+extern uint8_t gpio_selected (void);
+extern int gpio_init (void);                                /* can be called several times */
+extern void gpio_close (void);
+
+extern void gpio_mode (int pin, uint8_t mode);              /* see: enum GPIO_PIN_MODE */
+extern void gpio_write (int pin, uint8_t value);
+extern int gpio_read (int pin);
+extern int gpio_wait_edge (int pin, uint8_t edge, uint32_t timeout_us, uint64_t *t_ns);   /* see: enum GPIO_EDGE. *t_ns in: start, out: edge */
+
+extern uint64_t gpio_time_ns (void);                        /* CLOCK_MONOTONIC [ns] */
+
+#endif
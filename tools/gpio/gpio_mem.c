@@ -0,0 +1,179 @@
+/*! ---------------------------------------------------------------------
+ * @file    gpio_mem.c
+ * @date    10-16-2026
+ * @name    Ulrich Buettemeier
+ * @brief   direct access to the GPIO registers via /dev/gpiomem.
+ *          Several pins are switched with one write to GPSET0 or GPCLR0.
+ *          With GPIO_MEM_EMULATED the registers are a memory block and
+ *          GPLEV0 follows GPSET0/GPCLR0, so the code runs on every host.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/mman.h>
+
+#include "gpio_mem.h"
+
+volatile uint32_t *gpio_mem_reg = NULL;                     /* register block */
+
+static uint8_t emulated = 0;
+static uint32_t emu_reg[GPIO_MEM_WORDS];                    /* emulated register file */
+
+static const int8_t wpi_to_bcm[32] = {                      /* wiringPi pin -> BCM gpio. Pi rev. 2 and later */
+    17, 18, 27, 22, 23, 24, 25,  4,
+     2,  3,  8,  7, 10,  9, 11, 14,
+    15, 28, 29, 30, 31,  5,  6, 13,
+    19, 26, 12, 16, 20, 21,  0,  1
+};
+
+/*! --------------------------------------------------------------------
+ * @brief   mmap the register block
+ * @param   mode = GPIO_MEM_HW or GPIO_MEM_EMULATED
+ */
+int gpio_mem_init (uint8_t mode)
+{
+    int fd;
+    void *map;
+
+    if (gpio_mem_reg)
+        return EXIT_SUCCESS;
+
+    if (mode == GPIO_MEM_EMULATED) {
+        memset (emu_reg, 0, sizeof(emu_reg));
+        emulated = 1;
+        gpio_mem_reg = emu_reg;
+        return EXIT_SUCCESS;
+    }
+
+    if ((fd = open ("/dev/gpiomem", O_RDWR | O_SYNC)) < 0) {
+        perror ("-- open /dev/gpiomem");
+        return EXIT_FAILURE;
+    }
+    map = mmap (NULL, GPIO_MEM_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close (fd);
+    if (map == MAP_FAILED) {
+        perror ("-- mmap /dev/gpiomem");
+        return EXIT_FAILURE;
+    }
+    emulated = 0;
+    gpio_mem_reg = (volatile uint32_t *)map;
+
+    return EXIT_SUCCESS;
+}
+/*! --------------------------------------------------------------------
+ *
+ */
+void gpio_mem_close (void)
+{
+    if (gpio_mem_reg && !emulated)
+        munmap ((void *)gpio_mem_reg, GPIO_MEM_SIZE);
+    gpio_mem_reg = NULL;
+}
+/*! --------------------------------------------------------------------
+ * @return  BCM gpio number, -1 = wiringPi pin does not exist
+ */
+int gpio_mem_bcm (int pin)
+{
+    if ((pin < 0) || (pin >= 32))
+        return -1;
+
+    return wpi_to_bcm[pin];
+}
+/*! --------------------------------------------------------------------
+ * @return  bit of the pin in GPSET0, GPCLR0, GPLEV0
+ */
+uint32_t gpio_mem_mask (int pin)
+{
+    int bcm = gpio_mem_bcm (pin);
+
+    return (bcm < 0) ? 0 : (1u << bcm);
+}
+/*! --------------------------------------------------------------------
+ * @brief   function select register. output = 1 => 001, input = 0 => 000
+ */
+void gpio_mem_mode (int pin, uint8_t output)
+{
+    int bcm = gpio_mem_bcm (pin);
+    uint32_t fsel;
+
+    if ((bcm < 0) || !gpio_mem_reg)
+        return;
+
+    fsel = gpio_mem_reg[GPIO_FSEL0 + bcm / 10];
+    fsel &= ~(7u << ((bcm % 10) * 3));
+    if (output)
+        fsel |= (1u << ((bcm % 10) * 3));
+    gpio_mem_reg[GPIO_FSEL0 + bcm / 10] = fsel;
+}
+/*! --------------------------------------------------------------------
+ *
+ */
+void gpio_mem_set (uint32_t mask)
+{
+    gpio_mem_reg[GPIO_SET0] = mask;
+    if (emulated)
+        gpio_mem_reg[GPIO_LEV0] |= mask;
+}
+
+void gpio_mem_clr (uint32_t mask)
+{
+    gpio_mem_reg[GPIO_CLR0] = mask;
+    if (emulated)
+        gpio_mem_reg[GPIO_LEV0] &= ~mask;
+}
+/*! --------------------------------------------------------------------
+ *
+ */
+void gpio_mem_write (int pin, uint8_t value)
+{
+    uint32_t mask = gpio_mem_mask (pin);
+
+    if (!mask || !gpio_mem_reg)
+        return;
+
+    if (value)
+        gpio_mem_set (mask);
+    else
+        gpio_mem_clr (mask);
+}
+
+int gpio_mem_read (int pin)
+{
+    uint32_t mask = gpio_mem_mask (pin);
+
+    if (!mask || !gpio_mem_reg)
+        return 0;
+
+    return (gpio_mem_reg[GPIO_LEV0] & mask) ? 1 : 0;
+}
+/*! --------------------------------------------------------------------
+ * @brief   busy wait. clock_gettime() is a vdso call, no system call.
+ */
+void gpio_mem_wait_ns (uint32_t t)
+{
+    struct timespec ts;
+    uint64_t end;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    end = (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec + t;
+    do {
+        clock_gettime (CLOCK_MONOTONIC, &ts);
+    } while ((uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec < end);
+}
+/*! --------------------------------------------------------------------
+ * @brief   all pins of mask are high for width_ns
+ */
+void gpio_mem_pulse (uint32_t mask, uint32_t width_ns)
+{
+    if (!mask || !gpio_mem_reg)
+        return;
+
+    gpio_mem_set (mask);
+    gpio_mem_wait_ns (width_ns);
+    gpio_mem_clr (mask);
+}
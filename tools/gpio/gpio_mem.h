@@ -0,0 +1,44 @@
+/*! ---------------------------------------------------------------------
+ * @file    gpio_mem.h
+ * @date    10-16-2026
+ * @name    Ulrich Buettemeier
+ * @brief   direct access to the GPIO registers of the BCM2835/6/7 via
+ *          /dev/gpiomem. The pins are wiringPi pin numbers.
+ */
+
+#ifndef GPIO_MEM_H
+#define GPIO_MEM_H
+
+#include <stdint.h>
+
+#define GPIO_MEM_SIZE   4096        /* size of the register block [byte] */
+#define GPIO_MEM_WORDS  (GPIO_MEM_SIZE / 4)
+
+#define GPIO_FSEL0      0           /* register index (32 bit words) */
+#define GPIO_SET0       7
+#define GPIO_CLR0       10
+#define GPIO_LEV0       13
+
+enum GPIO_MEM_MODE {
+    GPIO_MEM_HW = 0,                /* mmap /dev/gpiomem */
+    GPIO_MEM_EMULATED = 1           /* register file in memory, for hosts without GPIO */
+};
+
+extern volatile uint32_t *gpio_mem_reg;                     /* register block */
+
+extern int gpio_mem_init (uint8_t mode);                    /* see: enum GPIO_MEM_MODE */
+extern void gpio_mem_close (void);
+
+extern int gpio_mem_bcm (int pin);                          /* wiringPi pin -> BCM gpio. -1 = no gpio */
+extern uint32_t gpio_mem_mask (int pin);                    /* bit in GPSET0/GPCLR0/GPLEV0 */
+
+extern void gpio_mem_mode (int pin, uint8_t output);        /* output = 1, input = 0 */
+extern void gpio_mem_write (int pin, uint8_t value);
+extern int gpio_mem_read (int pin);
+
+extern void gpio_mem_set (uint32_t mask);                   /* all pins of mask = 1 */
+extern void gpio_mem_clr (uint32_t mask);                   /* all pins of mask = 0 */
+extern void gpio_mem_pulse (uint32_t mask, uint32_t width_ns);  /* set mask, wait width_ns, clear mask */
+extern void gpio_mem_wait_ns (uint32_t t);                  /* busy wait [ns] */
+
+#endif
@@ -0,0 +1,224 @@
+/*! ---------------------------------------------------------------------
+ * @file    gpio_sim.c
+ * @date    10-16-2026
+ * @name    Ulrich Buettemeier
+ * @brief   gpio simulator. Every change of a pin level is stored in a
+ *          ring buffer. Several threads can write pins: the slot is taken
+ *          with an atomic counter and marked valid with its number.
+ *          If the ring is full, the oldest events are overwritten.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "gpio.h"
+#include "gpio_sim.h"
+#include "../rt_log/rt_log.h"
+
+struct _sim_slot_ {
+    struct _gpio_sim_event_ ev;
+    uint64_t seq;                           /* event number + 1, 0 = empty */
+};
+
+struct _sim_response_ {
+    int trig_pin;                           /* -1 = no response */
+    uint32_t delay_us, width_us;
+    uint64_t start, end;                    /* echo is high from start to end [ns] */
+};
+
+static struct _sim_slot_ *ring = NULL;
+static uint32_t ring_size = GPIO_SIM_RING;
+static uint64_t head = 0;                   /* number of events */
+
+static uint64_t (*sim_now)(void) = gpio_time_ns;  /* time stamp of the events. see: gpio_sim_clock() */
+
+static uint8_t level[GPIO_SIM_PINS];
+static struct _sim_response_ resp[GPIO_SIM_PINS];
+
+/*! --------------------------------------------------------------------
+ * @brief   store a change of a pin level
+ */
+static void record (int pin, uint8_t value)
+{
+    uint64_t n = __atomic_fetch_add (&head, 1, __ATOMIC_RELAXED);
+    struct _sim_slot_ *s = &ring[n & (ring_size - 1)];
+
+    __atomic_store_n (&s->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence (__ATOMIC_RELEASE);
+    s->ev.t = sim_now ();
+    s->ev.pin = pin;
+    s->ev.value = value;
+    __atomic_store_n (&s->seq, n + 1, __ATOMIC_RELEASE);
+}
+/*! --------------------------------------------------------------------
+ *
+ */
+static int sim_init (void)
+{
+    int i;
+
+    if (!ring) {
+        if (!(ring = (struct _sim_slot_ *) calloc (ring_size, sizeof(struct _sim_slot_)))) {
+            rt_log ("-- gpio_sim: no memory for %u events\n", ring_size);
+            return EXIT_FAILURE;
+        }
+    }
+    head = 0;
+    memset (level, 0, sizeof(level));
+    for (i = 0; i < GPIO_SIM_PINS; i++)
+        resp[i].trig_pin = -1;
+
+    return EXIT_SUCCESS;
+}
+
+static void sim_close (void)
+{
+    free (ring);
+    ring = NULL;
+}
+
+static void sim_mode (int pin, uint8_t mode)
+{
+    if ((pin < 0) || (pin >= GPIO_SIM_PINS))
+        return;
+
+    if (mode == GPIO_INPUT_PULLUP)
+        gpio_sim_input (pin, 1);
+    else if (mode == GPIO_INPUT_PULLDOWN)
+        gpio_sim_input (pin, 0);
+}
+/*! --------------------------------------------------------------------
+ * @brief   A falling edge of a trigger pin starts the response of the
+ *          echo pins.
+ */
+static void sim_write (int pin, uint8_t value)
+{
+    int i;
+
+    if ((pin < 0) || (pin >= GPIO_SIM_PINS))
+        return;
+
+    value = (value) ? 1 : 0;
+    if (__atomic_exchange_n (&level[pin], value, __ATOMIC_RELAXED) == value)
+        return;
+
+    record (pin, value);
+
+    if (!value) {
+        for (i = 0; i < GPIO_SIM_PINS; i++) {
+            if (resp[i].trig_pin == pin) {
+                resp[i].start = sim_now () + (uint64_t)resp[i].delay_us * 1000;
+                resp[i].end = resp[i].start + (uint64_t)resp[i].width_us * 1000;
+            }
+        }
+    }
+}
+
+static int sim_read (int pin)
+{
+    uint64_t now;
+
+    if ((pin < 0) || (pin >= GPIO_SIM_PINS))
+        return 0;
+
+    if (resp[pin].trig_pin >= 0) {
+        now = sim_now ();
+        return ((now >= resp[pin].start) && (now < resp[pin].end)) ? 1 : 0;
+    }
+
+    return __atomic_load_n (&level[pin], __ATOMIC_RELAXED);
+}
+
+const struct _gpio_backend_ gpio_sim_backend = {
+    "simulator", sim_init, sim_close, sim_mode, sim_write, sim_read, NULL
+};
+
+/*! --------------------------------------------------------------------
+ * @brief   size of the ring buffer. Must be called before gpio_init().
+ * @param   size = number of events, power of 2
+ */
+int gpio_sim_ring_size (uint32_t size)
+{
+    if (ring || !size || (size & (size - 1)))
+        return EXIT_FAILURE;
+
+    ring_size = size;
+    return EXIT_SUCCESS;
+}
+/*! --------------------------------------------------------------------
+ * @brief   clock of the time stamps and of the responses, e.g. the 
+ *           virtual clock of a simulation.
+ * @param   now = NULL: CLOCK_MONOTONIC (gpio_time_ns)
+ */
+void gpio_sim_clock (uint64_t (*now)(void))
+{
+    sim_now = (now) ? now : gpio_time_ns;
+}
+/*! --------------------------------------------------------------------
+ * @brief   set the level of an input. The change is stored like an output.
+ */
+void gpio_sim_input (int pin, uint8_t value)
+{
+    if (!ring || (pin < 0) || (pin >= GPIO_SIM_PINS))
+        return;
+
+    value = (value) ? 1 : 0;
+    if (__atomic_exchange_n (&level[pin], value, __ATOMIC_RELAXED) != value)
+        record (pin, value);
+}
+/*! --------------------------------------------------------------------
+ * @brief   After a falling edge of trig_pin, echo_pin is high for width_us
+ *           after delay_us. The echo is not stored in the ring buffer.
+ *           trig_pin = -1 removes the response.
+ */
+int gpio_sim_response (int trig_pin, int echo_pin, uint32_t delay_us, uint32_t width_us)
+{
+    if ((echo_pin < 0) || (echo_pin >= GPIO_SIM_PINS) || (trig_pin >= GPIO_SIM_PINS))
+        return EXIT_FAILURE;
+
+    resp[echo_pin].start = resp[echo_pin].end = 0;
+    resp[echo_pin].delay_us = delay_us;
+    resp[echo_pin].width_us = width_us;
+    resp[echo_pin].trig_pin = trig_pin;
+
+    return EXIT_SUCCESS;
+}
+/*! --------------------------------------------------------------------
+ *
+ */
+uint64_t gpio_sim_count (void)
+{
+    return __atomic_load_n (&head, __ATOMIC_ACQUIRE);
+}
+/*! --------------------------------------------------------------------
+ * @brief   copy of event n
+ * @return  EXIT_FAILURE = event is overwritten or not yet written
+ */
+int gpio_sim_event (uint64_t n, struct _gpio_sim_event_ *ev)
+{
+    struct _sim_slot_ *s;
+
+    if (!ring || !ev || (n >= gpio_sim_count ()) || (gpio_sim_count () - n > ring_size))
+        return EXIT_FAILURE;
+
+    s = &ring[n & (ring_size - 1)];
+    if (__atomic_load_n (&s->seq, __ATOMIC_ACQUIRE) != n + 1)
+        return EXIT_FAILURE;
+    *ev = s->ev;
+    __atomic_thread_fence (__ATOMIC_ACQUIRE);
+    if (__atomic_load_n (&s->seq, __ATOMIC_RELAXED) != n + 1)
+        return EXIT_FAILURE;
+
+    return EXIT_SUCCESS;
+}
+/*! --------------------------------------------------------------------
+ *
+ */
+void gpio_sim_clear (void)
+{
+    if (ring)
+        memset (ring, 0, (size_t)ring_size * sizeof(struct _sim_slot_));
+    __atomic_store_n (&head, 0, __ATOMIC_RELEASE);
+}
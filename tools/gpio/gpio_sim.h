@@ -0,0 +1,41 @@
+/*! ---------------------------------------------------------------------
+ * @file    gpio_sim.h
+ * @date    10-16-2026
+ * @name    Ulrich Buettemeier
+ * @brief   gpio simulator. Every change of a pin level is stored with a
+ *          time stamp in a ring buffer (CLOCK_MONOTONIC or a virtual clock,
+ *          see: gpio_sim_clock()). The ring is
+ *          allocated by gpio_init(), so writing a pin never allocates.
+ *          Inputs are set with gpio_sim_input() or with a response:
+ *          after a falling edge of a trigger pin, the echo pin is high
+ *          for a time (e.g. HC-SR04).
+ */
+
+#ifndef GPIO_SIM_H
+#define GPIO_SIM_H
+
+#include <stdint.h>
+
+#include "gpio.h"
+
+#define GPIO_SIM_PINS 64
+#define GPIO_SIM_RING 65536                 /* default size of the ring buffer. power of 2 */
+
+struct _gpio_sim_event_ {
+    uint64_t t;                             /* CLOCK_MONOTONIC or clock of gpio_sim_clock() [ns] */
+    uint8_t pin;
+    uint8_t value;
+};
+
+extern const struct _gpio_backend_ gpio_sim_backend;
+
+extern int gpio_sim_ring_size (uint32_t size);              /* before gpio_init(). power of 2 */
+extern void gpio_sim_clock (uint64_t (*now)(void));         /* clock of the time stamps. NULL = CLOCK_MONOTONIC */
+extern void gpio_sim_input (int pin, uint8_t value);        /* set an input level */
+extern int gpio_sim_response (int trig_pin, int echo_pin, uint32_t delay_us, uint32_t width_us);
+
+extern uint64_t gpio_sim_count (void);                      /* number of stored events since gpio_init() */
+extern int gpio_sim_event (uint64_t n, struct _gpio_sim_event_ *ev);   /* event n. EXIT_FAILURE = overwritten */
+extern void gpio_sim_clear (void);                          /* events are dropped, levels stay */
+
+#endif
@@ -9,6 +9,8 @@
 #include <stdint.h>
 #include <unistd.h>
 #include <sys/time.h>
+#include <time.h>
+#include <errno.h>
 #include <sched.h>
 
 #include "rpi_tools.h"
@@ -45,6 +47,31 @@ int64_t current_difference_micro (struct timeval *start)
     gettimeofday (&stop, NULL);
     return difference_micro (start, &stop);     /* return (current - start) */
 }
+/*! --------------------------------------------------------------------
+ *  @return CLOCK_MONOTONIC [ns]
+ */
+uint64_t monotonic_ns (void)
+{
+    struct timespec ts;
+    
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + (uint64_t) ts.tv_nsec;
+}
+/*! --------------------------------------------------------------------
+ *  @brief  sleep until CLOCK_MONOTONIC >= t
+ *  @param  t = absolute time [ns]. see: monotonic_ns()
+ */
+int sleep_until_ns (uint64_t t)
+{
+    struct timespec ts;
+    int ret;
+    
+    ts.tv_sec = t / 1000000000ull;
+    ts.tv_nsec = t % 1000000000ull;
+    while ((ret = clock_nanosleep (CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL)) == EINTR);
+    
+    return (ret == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
 /*! --------------------------------------------------------------------
  * @brief   function displays progress bar
  * @param   t = sleep time [us]
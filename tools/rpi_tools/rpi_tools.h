@@ -12,5 +12,8 @@ extern void abort_by_error (const char *error_text, const char *func_name);
 extern int64_t difference_micro (struct timeval *start, struct timeval *stop);  /* calculates time difference in us */
 extern int64_t current_difference_micro (struct timeval *start);
 
+extern uint64_t monotonic_ns (void);                                            /* CLOCK_MONOTONIC in ns */
+extern int sleep_until_ns (uint64_t t);                                         /* sleep until CLOCK_MONOTONIC >= t [ns] */
+
 extern void show_usleep (uint64_t t, uint64_t refresh_time);                    /* function displays progress bar */
 extern void show_scheduler_param (void);
@@ -0,0 +1,3 @@
+#!/bin/bash
+
+geany -s rt_log.c rt_log.h &
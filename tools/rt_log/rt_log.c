@@ -0,0 +1,465 @@
+/*! --------------------------------------------------------------------
+ *  @file    rt_log.c
+ *  @date    10-17-2026
+ *  @name    Ulrich Buettemeier
+ *  @brief   asynchronous logger, see: rt_log.h
+ *           Every thread has its own ring (single producer, single consumer),
+ *           the ring is allocated by rt_log_thread() or by the first
+ *           rt_log() of the thread. The ring of an ended thread is used
+ *           again by the next thread, it is never freed.
+ *           The arguments are copied by their conversion (%d, %llu, %f,
+ *           %s ...). Not supported: * as width or precision, %n.
+ *           The writer formats the records of all rings in the order of
+ *           their time.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "rt_log.h"
+
+enum RT_LOG_LEN {                       /* length modifier of a conversion */
+    LEN_NONE = 0,
+    LEN_HH,
+    LEN_H,
+    LEN_L,
+    LEN_LL,
+    LEN_Z,
+    LEN_J,
+    LEN_T,
+    LEN_LD
+};
+
+static struct _rt_log_ring_ *first_ring = NULL;         /* rings of all threads */
+static __thread struct _rt_log_ring_ *my_ring = NULL;   /* ring of the calling thread */
+static pthread_key_t ring_key;                          /* releases the ring at the end of the thread */
+static pthread_once_t key_once = PTHREAD_ONCE_INIT;
+
+static pthread_t writer;
+static uint8_t writer_run = 0;          /* 1 = rt_log() writes into the rings */
+static volatile uint8_t writer_stop = 0;
+static FILE *out = NULL;
+
+/*! --------------------------------------------------------------------
+ * @return  CLOCK_MONOTONIC [ns]
+ */
+static uint64_t now_ns (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+/*! --------------------------------------------------------------------
+ * @brief   next conversion of the format. %% is not a conversion.
+ * @param   start = '%' of the conversion
+ *          conv = conversion character, len = see: enum RT_LOG_LEN
+ * @return  character after the conversion, NULL = no more conversion
+ */
+static const char *next_spec (const char *p, const char **start, char *conv, uint8_t *len)
+{
+    for (; *p; p++) {
+        if (*p != '%')
+            continue;
+        if (p[1] == '%') {
+            p++;
+            continue;
+        }
+        *start = p++;
+        while (*p && strchr ("-+ #0'", *p))                     /* flags */
+            p++;
+        while (((*p >= '0') && (*p <= '9')) || (*p == '.'))     /* width, precision */
+            p++;
+        *len = LEN_NONE;
+        if (*p == 'h') {
+            *len = (*++p == 'h') ? LEN_HH : LEN_H;
+            if (*len == LEN_HH) p++;
+        } else if (*p == 'l') {
+            *len = (*++p == 'l') ? LEN_LL : LEN_L;
+            if (*len == LEN_LL) p++;
+        } else if (*p == 'z') { p++; *len = LEN_Z; }
+        else if (*p == 'j') { p++; *len = LEN_J; }
+        else if (*p == 't') { p++; *len = LEN_T; }
+        else if (*p == 'L') { p++; *len = LEN_LD; }
+        if (!*p)
+            return NULL;
+        *conv = *p;
+        return p + 1;
+    }
+
+    return NULL;
+}
+/*! --------------------------------------------------------------------
+ * @brief   the arguments are copied into the record. used by rt_log()
+ */
+static void fill (struct _rt_log_rec_ *r, va_list ap)
+{
+    const char *p = r->fmt, *start, *s;
+    size_t pos = 0, l;
+    uint8_t len;
+    char conv;
+
+    r->n = 0;
+    while ((r->n < RT_LOG_ARGS) && ((p = next_spec (p, &start, &conv, &len)) != NULL)) {
+        switch (conv) {
+            case 'd': case 'i': case 'c':
+                if ((len == LEN_LL) || (len == LEN_J))
+                    r->arg[r->n].i = va_arg (ap, long long);
+                else if ((len == LEN_L) || (len == LEN_Z) || (len == LEN_T))
+                    r->arg[r->n].i = va_arg (ap, long);
+                else
+                    r->arg[r->n].i = va_arg (ap, int);
+                break;
+
+            case 'u': case 'o': case 'x': case 'X':
+                if ((len == LEN_LL) || (len == LEN_J))
+                    r->arg[r->n].u = va_arg (ap, unsigned long long);
+                else if ((len == LEN_L) || (len == LEN_Z) || (len == LEN_T))
+                    r->arg[r->n].u = va_arg (ap, unsigned long);
+                else
+                    r->arg[r->n].u = va_arg (ap, unsigned int);
+                break;
+
+            case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+                r->arg[r->n].d = (len == LEN_LD) ? (double)va_arg (ap, long double) : va_arg (ap, double);
+                break;
+
+            case 's':
+                if ((s = va_arg (ap, const char *)) == NULL)
+                    s = "(null)";
+                l = (pos < RT_LOG_STR - 1) ? strnlen (s, RT_LOG_STR - 1 - pos) : 0;
+                memcpy (&r->str[pos], s, l);
+                r->str[pos + l] = 0;
+                r->arg[r->n].u = pos;
+                pos = (pos + l + 1 < RT_LOG_STR) ? pos + l + 1 : RT_LOG_STR - 1;
+                break;
+
+            case 'p':
+                r->arg[r->n].u = (uintptr_t)va_arg (ap, void *);
+                break;
+
+            default:                    /* not supported: the rest is text */
+                return;
+        }
+        r->n++;
+    }
+}
+/*! --------------------------------------------------------------------
+ * @brief   text of the format, %% = %
+ */
+static void append (char *buf, size_t size, size_t *n, const char *s, size_t l)
+{
+    size_t i;
+
+    for (i = 0; (i < l) && (*n < size - 1); i++) {
+        if ((s[i] == '%') && (i + 1 < l) && (s[i + 1] == '%'))
+            i++;
+        buf[(*n)++] = s[i];
+    }
+    buf[*n] = 0;
+}
+/*! --------------------------------------------------------------------
+ * @brief   text of a record. used by the writer
+ */
+static void format (const struct _rt_log_rec_ *r, char *buf, size_t size)
+{
+    const char *p = r->fmt, *start, *q;
+    char conv, spec[32];
+    size_t n = 0;
+    uint8_t len, i;
+    int ret = 0;
+
+    buf[0] = 0;
+    for (i = 0; (i < r->n) && ((q = next_spec (p, &start, &conv, &len)) != NULL); i++) {
+        append (buf, size, &n, p, (size_t)(start - p));
+        if ((size_t)(q - start) >= sizeof(spec))
+            break;
+        memcpy (spec, start, (size_t)(q - start));
+        spec[q - start] = 0;
+
+        switch (conv) {
+            case 'd': case 'i': case 'c':
+                if ((len == LEN_LL) || (len == LEN_J))
+                    ret = snprintf (buf + n, size - n, spec, (long long)r->arg[i].i);
+                else if ((len == LEN_L) || (len == LEN_Z) || (len == LEN_T))
+                    ret = snprintf (buf + n, size - n, spec, (long)r->arg[i].i);
+                else
+                    ret = snprintf (buf + n, size - n, spec, (int)r->arg[i].i);
+                break;
+
+            case 'u': case 'o': case 'x': case 'X':
+                if ((len == LEN_LL) || (len == LEN_J))
+                    ret = snprintf (buf + n, size - n, spec, (unsigned long long)r->arg[i].u);
+                else if ((len == LEN_L) || (len == LEN_Z) || (len == LEN_T))
+                    ret = snprintf (buf + n, size - n, spec, (unsigned long)r->arg[i].u);
+                else
+                    ret = snprintf (buf + n, size - n, spec, (unsigned int)r->arg[i].u);
+                break;
+
+            case 's':
+                ret = snprintf (buf + n, size - n, spec, &r->str[r->arg[i].u]);
+                break;
+
+            case 'p':
+                ret = snprintf (buf + n, size - n, spec, (void *)(uintptr_t)r->arg[i].u);
+                break;
+
+            default:
+                if (len == LEN_LD)
+                    ret = snprintf (buf + n, size - n, spec, (long double)r->arg[i].d);
+                else
+                    ret = snprintf (buf + n, size - n, spec, r->arg[i].d);
+                break;
+        }
+        if (ret > 0)
+            n = (n + (size_t)ret < size) ? n + (size_t)ret : size - 1;
+        p = q;
+    }
+    append (buf, size, &n, p, strlen (p));
+}
+/*! --------------------------------------------------------------------
+ * @brief   all records in the order of their time, dropped records
+ * @return  number of records
+ */
+static int drain (void)
+{
+    struct _rt_log_ring_ *r, *min;
+    char buf[512];
+    uint64_t d;
+    int n = 0;
+
+    for (;;) {
+        min = NULL;
+        for (r = __atomic_load_n (&first_ring, __ATOMIC_ACQUIRE); r; r = r->next) {
+            if ((r->tail != __atomic_load_n (&r->head, __ATOMIC_ACQUIRE)) &&
+                (!min || (r->rec[r->tail & (RT_LOG_RING - 1)].t < min->rec[min->tail & (RT_LOG_RING - 1)].t)))
+                min = r;
+        }
+        if (!min)
+            break;
+        format (&min->rec[min->tail & (RT_LOG_RING - 1)], buf, sizeof(buf));
+        fputs (buf, out);
+        __atomic_store_n (&min->tail, min->tail + 1, __ATOMIC_RELEASE);
+        n++;
+    }
+
+    for (r = __atomic_load_n (&first_ring, __ATOMIC_ACQUIRE); r; r = r->next) {
+        if ((d = __atomic_load_n (&r->dropped, __ATOMIC_RELAXED)) != r->reported) {
+            fprintf (out, "-- rt_log: %llu records of <%s> dropped\n", (long long unsigned)(d - r->reported), r->name);
+            r->reported = d;
+            n++;
+        }
+    }
+    if (n)
+        fflush (out);
+
+    return n;
+}
+/*! --------------------------------------------------------------------
+ * @brief   writer thread, SCHED_OTHER
+ */
+static void *write_thread (void *data)
+{
+    (void)data;
+    while (!writer_stop) {
+        drain ();
+        usleep (RT_LOG_PERIOD_US);
+    }
+    drain ();
+
+    return NULL;
+}
+/*! --------------------------------------------------------------------
+ * @brief   the ring of an ended thread is free
+ */
+static void ring_release (void *data)
+{
+    __atomic_store_n (&((struct _rt_log_ring_ *)data)->used, 0, __ATOMIC_RELEASE);
+}
+
+static void key_init (void)
+{
+    pthread_key_create (&ring_key, ring_release);
+}
+/*! --------------------------------------------------------------------
+ * @brief   ring of the calling thread. A free ring of an ended thread
+ *           is used, otherwise a new ring is allocated.
+ * @param   name = name in the report of dropped records. NULL = "thread"
+ */
+int rt_log_thread (const char *name)
+{
+    struct _rt_log_ring_ *r = my_ring;
+    uint32_t expect;
+
+    if (!r) {
+        pthread_once (&key_once, key_init);
+        for (r = __atomic_load_n (&first_ring, __ATOMIC_ACQUIRE); r; r = r->next) {
+            expect = 0;
+            if (__atomic_compare_exchange_n (&r->used, &expect, 1, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+                break;
+        }
+        if (!r) {
+            if ((r = (struct _rt_log_ring_ *) calloc (1, sizeof(struct _rt_log_ring_))) == NULL)
+                return EXIT_FAILURE;
+            r->used = 1;
+            r->next = __atomic_load_n (&first_ring, __ATOMIC_RELAXED);
+            while (!__atomic_compare_exchange_n (&first_ring, &r->next, r, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+                ;
+        }
+        my_ring = r;
+        pthread_setspecific (ring_key, r);
+    }
+    snprintf (r->name, sizeof(r->name), "%s", (name) ? name : "thread");
+
+    return EXIT_SUCCESS;
+}
+/*! --------------------------------------------------------------------
+ * @brief   printf into the ring of the calling thread. No lock, no system
+ *           call. fmt must be a constant string (it is formatted later).
+ *           If the writer doesn't run, the text is printed directly.
+ */
+void rt_log (const char *fmt, ...)
+{
+    struct _rt_log_ring_ *r;
+    struct _rt_log_rec_ *rec;
+    uint32_t head;
+    va_list ap;
+
+    va_start (ap, fmt);
+    if (!__atomic_load_n (&writer_run, __ATOMIC_ACQUIRE)) {
+        vprintf (fmt, ap);
+        va_end (ap);
+        return;
+    }
+    if (!my_ring && (rt_log_thread (NULL) != EXIT_SUCCESS)) {
+        va_end (ap);
+        return;
+    }
+
+    r = my_ring;
+    head = r->head;
+    if (head - __atomic_load_n (&r->tail, __ATOMIC_ACQUIRE) >= RT_LOG_RING) {     /* ring is full */
+        __atomic_store_n (&r->dropped, r->dropped + 1, __ATOMIC_RELAXED);
+        va_end (ap);
+        return;
+    }
+    rec = &r->rec[head & (RT_LOG_RING - 1)];
+    rec->t = now_ns ();
+    rec->fmt = fmt;
+    fill (rec, ap);
+    __atomic_store_n (&r->head, head + 1, __ATOMIC_RELEASE);
+    va_end (ap);
+}
+/*! --------------------------------------------------------------------
+ * @brief   atexit() handler of rt_log_start()
+ */
+static void rt_log_atexit (void)
+{
+    rt_log_stop ();
+}
+/*! --------------------------------------------------------------------
+ * @brief   starts the writer. A second call does nothing.
+ *           At the end of the program the records are written (atexit).
+ * @param   fname = log file (append), NULL = stdout
+ */
+int rt_log_start (const char *fname)
+{
+    static uint8_t exit_set = 0;
+    pthread_attr_t attr;
+    struct sched_param param = { .sched_priority = 0 };
+    int ret;
+
+    if (writer_run)
+        return EXIT_SUCCESS;
+
+    if (!fname)
+        out = stdout;
+    else if ((out = fopen (fname, "a")) == NULL) {
+        printf ("-- rt_log: can't open <%s>\n", fname);
+        return EXIT_FAILURE;
+    }
+
+    pthread_attr_init (&attr);                          /* not the policy of the calling thread */
+    pthread_attr_setinheritsched (&attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy (&attr, SCHED_OTHER);
+    pthread_attr_setschedparam (&attr, &param);
+    writer_stop = 0;
+    ret = pthread_create (&writer, &attr, write_thread, NULL);
+    pthread_attr_destroy (&attr);
+    if (ret != 0) {
+        printf ("-- rt_log: can't create the writer\n");
+        if (out != stdout)
+            fclose (out);
+        return EXIT_FAILURE;
+    }
+    __atomic_store_n (&writer_run, 1, __ATOMIC_RELEASE);
+
+    if (!exit_set) {
+        atexit (rt_log_atexit);
+        exit_set = 1;
+    }
+
+    return EXIT_SUCCESS;
+}
+/*! --------------------------------------------------------------------
+ * @brief   the writer writes all records and ends. From now on rt_log()
+ *           prints directly. Call after the end of the rt threads.
+ */
+int rt_log_stop (void)
+{
+    if (!writer_run)
+        return EXIT_FAILURE;
+
+    __atomic_store_n (&writer_run, 0, __ATOMIC_RELEASE);
+    writer_stop = 1;
+    pthread_join (writer, NULL);
+    if (out != stdout)
+        fclose (out);
+    else
+        fflush (out);
+    out = NULL;
+
+    return EXIT_SUCCESS;
+}
+/*! --------------------------------------------------------------------
+ * @brief   waits until the records, that are written before the call,
+ *           are written by the writer.
+ */
+int rt_log_flush (void)
+{
+    struct _rt_log_ring_ *r;
+    uint32_t head;
+
+    if (!writer_run) {
+        fflush (stdout);
+        return EXIT_SUCCESS;
+    }
+
+    for (r = __atomic_load_n (&first_ring, __ATOMIC_ACQUIRE); r; r = r->next) {
+        head = __atomic_load_n (&r->head, __ATOMIC_ACQUIRE);
+        while (writer_run && ((int32_t)(__atomic_load_n (&r->tail, __ATOMIC_ACQUIRE) - head) < 0))
+            usleep (1000);
+    }
+
+    return EXIT_SUCCESS;
+}
+/*! --------------------------------------------------------------------
+ * @return  dropped records of all threads
+ */
+uint64_t rt_log_dropped (void)
+{
+    struct _rt_log_ring_ *r;
+    uint64_t sum = 0;
+
+    for (r = __atomic_load_n (&first_ring, __ATOMIC_ACQUIRE); r; r = r->next)
+        sum += __atomic_load_n (&r->dropped, __ATOMIC_RELAXED);
+
+    return sum;
+}
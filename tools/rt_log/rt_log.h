@@ -0,0 +1,59 @@
+/*! ---------------------------------------------------------------------
+ * @file    rt_log.h
+ * @date    10-17-2026
+ * @name    Ulrich Buettemeier
+ * @brief   asynchronous logger for real time threads. rt_log() writes a
+ *          binary record (time, format, arguments) into a ring of the
+ *          calling thread, it never locks and never writes to a file.
+ *          A writer thread (SCHED_OTHER) formats the records and writes
+ *          them to stdout or a file. If a ring is full, the record is
+ *          dropped and the writer reports the number of dropped records.
+ *          Without rt_log_start() rt_log() prints directly (printf).
+ * @example
+ *          rt_log_start (NULL);                    // stdout
+ *          rt_log_thread ("run_A4988 1");          // in the rt thread, before the first rt_log()
+ *          rt_log ("-- max_latency=%lli us\n", (long long int)max);
+ *          rt_log_stop ();
+ */
+
+#ifndef RT_LOG_H
+#define RT_LOG_H
+
+#include <stdint.h>
+
+#define RT_LOG_ARGS 8                   /* max. arguments of a record */
+#define RT_LOG_STR 128                  /* bytes for the strings (%s) of a record */
+#define RT_LOG_RING 256                 /* records per thread. power of 2 */
+#define RT_LOG_PERIOD_US 10000          /* the writer checks the rings every 10 ms */
+
+struct _rt_log_rec_ {
+    uint64_t t;                         /* CLOCK_MONOTONIC [ns] */
+    const char *fmt;                    /* printf format. Must be a constant string */
+    uint8_t n;                          /* number of arguments */
+    union {
+        int64_t i;
+        uint64_t u;                     /* %s: position in str */
+        double d;
+    } arg[RT_LOG_ARGS];
+    char str[RT_LOG_STR];               /* copies of the strings */
+};
+
+struct _rt_log_ring_ {                  /* single producer (a thread), single consumer (the writer) */
+    struct _rt_log_rec_ rec[RT_LOG_RING];
+    uint32_t head;                      /* written by the thread */
+    uint32_t tail;                      /* written by the writer */
+    uint64_t dropped;                   /* written by the thread */
+    uint64_t reported;                  /* dropped records reported by the writer */
+    uint32_t used;                      /* 1 = the ring belongs to a running thread */
+    char name[24];
+    struct _rt_log_ring_ *next;
+};
+
+extern int rt_log_start (const char *fname);            /* starts the writer. NULL = stdout */
+extern int rt_log_stop (void);                          /* writes all records, the writer ends */
+extern int rt_log_flush (void);                         /* waits until all records are written */
+extern int rt_log_thread (const char *name);            /* ring of the calling thread. Call before the first rt_log() of a rt thread */
+extern void rt_log (const char *fmt, ...) __attribute__ ((format (printf, 1, 2)));
+extern uint64_t rt_log_dropped (void);                  /* dropped records of all threads */
+
+#endif
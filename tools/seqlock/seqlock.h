@@ -0,0 +1,53 @@
+/*! ---------------------------------------------------------------------
+ * @file    seqlock.h
+ * @date    10-16-2026
+ * @name    Ulrich Buettemeier
+ * @brief   sequence lock for one writer and many readers.
+ *          The writer never waits. A reader copies the data and repeats
+ *          the copy, if the writer has changed the data in the meantime.
+ * @example
+ *          writer:                             reader:
+ *          seqlock_write_begin (&lock);        do {
+ *          data.x = ...;                           seq = seqlock_read_begin (&lock);
+ *          seqlock_write_end (&lock);              copy = data;
+ *                                              } while (seqlock_read_retry (&lock, seq));
+ */
+
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <stdint.h>
+
+struct _seqlock_ {
+    uint32_t seq;                   /* odd = writer is active */
+};
+
+#define SEQLOCK_INIT { 0 }
+
+static inline void seqlock_write_begin (struct _seqlock_ *s)
+{
+    __atomic_store_n (&s->seq, s->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence (__ATOMIC_RELEASE);
+}
+
+static inline void seqlock_write_end (struct _seqlock_ *s)
+{
+    __atomic_store_n (&s->seq, s->seq + 1, __ATOMIC_RELEASE);
+}
+
+static inline uint32_t seqlock_read_begin (const struct _seqlock_ *s)
+{
+    uint32_t seq;
+
+    while ((seq = __atomic_load_n (&s->seq, __ATOMIC_ACQUIRE)) & 1)
+        ;
+    return seq;
+}
+
+static inline int seqlock_read_retry (const struct _seqlock_ *s, uint32_t seq)
+{
+    __atomic_thread_fence (__ATOMIC_ACQUIRE);
+    return __atomic_load_n (&s->seq, __ATOMIC_RELAXED) != seq;
+}
+
+#endif